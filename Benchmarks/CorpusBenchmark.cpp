@@ -0,0 +1,536 @@
+#include "BlockArchive.h"
+#include "CpuDispatch.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+/*
+  Corpus benchmark
+  Runs the block archive end to end over a standard corpus and reports, per
+  (kind, size, threads) case: compression ratio, compress and decompress
+  MB/s and the peak resident set size. Each case runs in its own child
+  process so the peak RSS (getrusage of that child) belongs to that case
+  alone. Results are written as JSON, one case per line, and can be compared
+  against a stored baseline: any throughput drop, ratio loss or RSS growth
+  beyond the threshold is reported and makes the exit status 1.
+
+  Generated kinds: text, logs, json, records (fixed-width binary), random, runs.
+  Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+
+  Usage: CorpusBenchmark [options]
+    --kinds text,logs,...    generated kinds to run (default all)
+    --sizes 1K,1M,64M,2G     input sizes (default 1K,64K,1M,16M)
+    --corpus DIR             benchmark the files in DIR instead of generated data
+    --threads 1,4,8          archive worker counts (default 1 and all hardware threads)
+    --min-time SECONDS       repeat small inputs until this much time is measured (default 0.3)
+    --out FILE               write the JSON results (default stdout only shows the table)
+    --baseline FILE          compare against earlier JSON results
+    --threshold PERCENT      allowed regression before failing (default 5)
+*/
+
+struct CaseSpec {
+    string kind;
+    string path;            // corpus file, empty for generated data
+    size_t bytes = 0;
+    unsigned int threads = 1;
+};
+
+struct CaseResult {
+    double ratio = 0;
+    double compressMBps = 0;
+    double decompressMBps = 0;
+    long peakRssKB = 0;
+    bool ok = false;
+};
+
+// ------------------------------------------------------------ generators
+
+// xorshift64*, so every run sees the same corpus
+class CorpusRandom {
+private:
+    unsigned long long state;
+
+public:
+    explicit CorpusRandom(unsigned long long seed) : state(seed * 0x9E3779B97F4A7C15ULL + 1) {}
+
+    unsigned long long next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1DULL;
+    }
+    unsigned int below(unsigned int bound) { return (unsigned int)(next() % bound); }
+
+    // Roughly Zipf-distributed index: small values are much more common
+    unsigned int skewed(unsigned int bound) {
+        double u = (double)(next() >> 11) / (double)(1ULL << 53);
+        return (unsigned int)(pow(u, 3.0) * bound) % bound;
+    }
+};
+
+static const char* const words[] = {
+    "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+    "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had",
+    "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if",
+    "more", "when", "will", "would", "who", "so", "no", "data", "file", "block", "table", "system",
+    "compression", "network", "message", "buffer", "request", "response", "memory", "thread",
+    "process", "value", "stream", "archive", "encoder", "decoder", "symbol", "frequency", "tree"};
+static const unsigned int wordCount = sizeof(words) / sizeof(words[0]);
+
+static void generateText(string& out, size_t bytes, CorpusRandom& random) {
+    while (out.size() < bytes) {
+        unsigned int sentence = 6 + random.below(14);
+        for (unsigned int w = 0; w < sentence; w++) {
+            string word = words[random.skewed(wordCount)];
+            if (w == 0) word[0] = (char)toupper(word[0]);
+            out += word;
+            out += (w + 1 == sentence) ? ". " : (random.below(12) == 0 ? ", " : " ");
+        }
+        if (random.below(6) == 0) out += "\n\n";
+    }
+}
+
+static void generateLogs(string& out, size_t bytes, CorpusRandom& random) {
+    static const char* const levels[] = {"INFO", "INFO", "INFO", "DEBUG", "WARN", "ERROR"};
+    static const char* const paths[] = {"/api/v1/users", "/api/v1/orders", "/api/v2/search", "/health",
+                                        "/static/app.js", "/api/v1/login"};
+    static const int statuses[] = {200, 200, 200, 201, 204, 304, 404, 500};
+    unsigned long long millis = 1760781600000ULL;
+    char line[256];
+    while (out.size() < bytes) {
+        millis += random.below(40);
+        unsigned long long seconds = millis / 1000;
+        int length = snprintf(line, sizeof(line),
+                              "2026-10-18T%02llu:%02llu:%02llu.%03lluZ %s [worker-%u] request id=%016llx "
+                              "path=%s status=%d latency_ms=%u\n",
+                              seconds / 3600 % 24, seconds / 60 % 60, seconds % 60, millis % 1000,
+                              levels[random.below(6)], random.below(16), random.next(), paths[random.skewed(6)],
+                              statuses[random.skewed(8)], random.skewed(2000));
+        out.append(line, (size_t)length);
+    }
+}
+
+static void generateJson(string& out, size_t bytes, CorpusRandom& random) {
+    static const char* const tags[] = {"new", "priority", "archived", "beta", "internal", "eu", "us"};
+    unsigned long long id = 100000;
+    char record[320];
+    out += "[\n";
+    while (out.size() < bytes) {
+        int length = snprintf(record, sizeof(record),
+                              "  {\"id\": %llu, \"name\": \"%s %s\", \"active\": %s, \"score\": %u.%02u, "
+                              "\"tags\": [\"%s\", \"%s\"], \"owner\": {\"team\": \"%s\", \"region\": %u}},\n",
+                              id++, words[random.skewed(wordCount)], words[random.skewed(wordCount)],
+                              random.below(4) ? "true" : "false", random.below(1000), random.below(100),
+                              tags[random.skewed(7)], tags[random.skewed(7)], words[49 + random.below(20)],
+                              random.below(12));
+        out.append(record, (size_t)length);
+    }
+}
+
+// 16-byte sensor records: timestamp(4) | sensor(2) | flags(2) | value(4, float) | counter(4), little-endian
+static void generateRecords(string& out, size_t bytes, CorpusRandom& random) {
+    unsigned int timestamp = 1760781600;
+    unsigned int counter = 0;
+    float value = 20.0f;
+    unsigned char record[16];
+    while (out.size() < bytes) {
+        timestamp += random.below(3);
+        unsigned short sensor = (unsigned short)random.below(64);
+        unsigned short flags = random.below(50) == 0 ? 1 : 0;
+        value += ((float)random.below(200) - 100.0f) / 1000.0f;
+        counter += 1 + random.below(2);
+        memcpy(record, &timestamp, 4);
+        memcpy(record + 4, &sensor, 2);
+        memcpy(record + 6, &flags, 2);
+        memcpy(record + 8, &value, 4);
+        memcpy(record + 12, &counter, 4);
+        out.append((const char*)record, sizeof(record));
+    }
+}
+
+static void generateRandom(string& out, size_t bytes, CorpusRandom& random) {
+    while (out.size() < bytes) {
+        unsigned long long word = random.next();
+        out.append((const char*)&word, sizeof(word));
+    }
+}
+
+static void generateRuns(string& out, size_t bytes, CorpusRandom& random) {
+    while (out.size() < bytes) {
+        unsigned char symbol = (unsigned char)random.skewed(32);
+        out.append(1 + random.skewed(4096), (char)symbol);
+    }
+}
+
+static const char* const generatedKinds[] = {"text", "logs", "json", "records", "random", "runs"};
+
+static bool generateCorpus(const string& kind, size_t bytes, string& out) {
+    CorpusRandom random(bytes ^ hash<string>()(kind));
+    out.clear();
+    out.reserve(bytes + 512);
+    if (kind == "text") generateText(out, bytes, random);
+    else if (kind == "logs") generateLogs(out, bytes, random);
+    else if (kind == "json") generateJson(out, bytes, random);
+    else if (kind == "records") generateRecords(out, bytes, random);
+    else if (kind == "random") generateRandom(out, bytes, random);
+    else if (kind == "runs") generateRuns(out, bytes, random);
+    else return false;
+    out.resize(bytes);
+    return true;
+}
+
+// ------------------------------------------------------------- measuring
+
+static double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Compress and decompress one input, repeating until minSeconds of each is measured
+ */
+static bool measureCase(const string& input, unsigned int threads, double minSeconds, CaseResult& result) {
+    ArchiveOptions options;
+    options.threads = threads;
+    string archive, restored;
+
+    double seconds = 0;
+    unsigned long long bytes = 0;
+    do {
+        archive.clear();
+        auto start = chrono::steady_clock::now();
+        if (!compressArchive(ArchiveEndpoint::memory((const unsigned char*)input.data(), input.size()),
+                             ArchiveEndpoint::memory(archive), options)) {
+            return false;
+        }
+        seconds += secondsSince(start);
+        bytes += input.size();
+    } while (seconds < minSeconds);
+    result.compressMBps = bytes / seconds / 1e6;
+    result.ratio = input.empty() ? 1.0 : (double)archive.size() / input.size();
+
+    seconds = 0;
+    bytes = 0;
+    do {
+        restored.clear();
+        auto start = chrono::steady_clock::now();
+        if (!decompressArchive(ArchiveEndpoint::memory((const unsigned char*)archive.data(), archive.size()),
+                               ArchiveEndpoint::memory(restored))) {
+            return false;
+        }
+        seconds += secondsSince(start);
+        bytes += input.size();
+    } while (seconds < minSeconds);
+    result.decompressMBps = bytes / seconds / 1e6;
+    return restored == input;
+}
+
+static bool loadFile(const string& path, string& out) {
+    ifstream file(path, ios::binary);
+    if (!file) return false;
+    ostringstream contents;
+    contents << file.rdbuf();
+    out = contents.str();
+    return true;
+}
+
+/**
+ * Run one case in a child process; the child's getrusage peak is the case's peak RSS
+ */
+static CaseResult runCase(const CaseSpec& spec, double minSeconds) {
+    CaseResult result;
+    int channel[2];
+    if (pipe(channel) != 0) return result;
+
+    pid_t child = fork();
+    if (child == 0) {
+        close(channel[0]);
+        string input;
+        bool loaded = spec.path.empty() ? generateCorpus(spec.kind, spec.bytes, input) : loadFile(spec.path, input);
+        CaseResult measured;
+        measured.ok = loaded && measureCase(input, spec.threads, minSeconds, measured);
+        ssize_t written = write(channel[1], &measured, sizeof(measured));
+        _exit(written == (ssize_t)sizeof(measured) ? 0 : 1);
+    }
+    close(channel[1]);
+    if (child < 0) {
+        close(channel[0]);
+        return result;
+    }
+
+    CaseResult measured;
+    ssize_t got = read(channel[0], &measured, sizeof(measured));
+    close(channel[0]);
+    int status = 0;
+    struct rusage usage;
+    if (wait4(child, &status, 0, &usage) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0
+        && got == (ssize_t)sizeof(measured)) {
+        result = measured;
+        result.peakRssKB = usage.ru_maxrss; // kilobytes on Linux
+    }
+    return result;
+}
+
+// ------------------------------------------------------------- JSON I/O
+
+static string resultLine(const CaseSpec& spec, const CaseResult& result) {
+    char line[512];
+    snprintf(line, sizeof(line),
+             "{\"kind\": \"%s\", \"bytes\": %zu, \"threads\": %u, \"ratio\": %.6f, \"compressMBps\": %.2f, "
+             "\"decompressMBps\": %.2f, \"peakRssKB\": %ld}",
+             spec.kind.c_str(), spec.bytes, spec.threads, result.ratio, result.compressMBps, result.decompressMBps,
+             result.peakRssKB);
+    return line;
+}
+
+static bool writeResults(const string& path, const vector<CaseSpec>& specs, const vector<CaseResult>& results) {
+    ofstream out(path);
+    if (!out) return false;
+    out << "{\n  \"benchmark\": \"CorpusBenchmark\",\n  \"kernels\": \"" << kernelLevelName(activeKernelLevel())
+        << "\",\n  \"results\": [\n";
+    for (size_t i = 0; i < specs.size(); i++) {
+        out << "    " << resultLine(specs[i], results[i]) << (i + 1 < specs.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+// Field lookups for the one-case-per-line format written above
+static bool jsonString(const string& line, const string& key, string& value) {
+    size_t at = line.find("\"" + key + "\": \"");
+    if (at == string::npos) return false;
+    at += key.size() + 5;
+    size_t end = line.find('"', at);
+    if (end == string::npos) return false;
+    value = line.substr(at, end - at);
+    return true;
+}
+
+static bool jsonNumber(const string& line, const string& key, double& value) {
+    size_t at = line.find("\"" + key + "\": ");
+    if (at == string::npos) return false;
+    value = strtod(line.c_str() + at + key.size() + 4, nullptr);
+    return true;
+}
+
+static bool readBaseline(const string& path, vector<CaseSpec>& specs, vector<CaseResult>& results) {
+    ifstream in(path);
+    if (!in) return false;
+    string line;
+    while (getline(in, line)) {
+        CaseSpec spec;
+        CaseResult result;
+        double bytes, threads, rss;
+        if (!jsonString(line, "kind", spec.kind) || !jsonNumber(line, "bytes", bytes)
+            || !jsonNumber(line, "threads", threads) || !jsonNumber(line, "ratio", result.ratio)
+            || !jsonNumber(line, "compressMBps", result.compressMBps)
+            || !jsonNumber(line, "decompressMBps", result.decompressMBps) || !jsonNumber(line, "peakRssKB", rss)) {
+            continue;
+        }
+        spec.bytes = (size_t)bytes;
+        spec.threads = (unsigned int)threads;
+        result.peakRssKB = (long)rss;
+        result.ok = true;
+        specs.push_back(spec);
+        results.push_back(result);
+    }
+    return true;
+}
+
+/**
+ * Report every metric that got worse than the baseline by more than threshold percent
+ */
+static int compareBaseline(const vector<CaseSpec>& specs, const vector<CaseResult>& results,
+                           const vector<CaseSpec>& baseSpecs, const vector<CaseResult>& baseResults, double threshold) {
+    int regressions = 0;
+    double allowed = threshold / 100.0;
+    auto report = [&](const CaseSpec& spec, const char* metric, double before, double after) {
+        printf("REGRESSION %s %zu bytes x%u: %s %.3f -> %.3f (%+.1f%%)\n", spec.kind.c_str(), spec.bytes,
+               spec.threads, metric, before, after, (after - before) / before * 100.0);
+        regressions++;
+    };
+    for (size_t i = 0; i < specs.size(); i++) {
+        if (!results[i].ok) continue;
+        for (size_t j = 0; j < baseSpecs.size(); j++) {
+            const CaseSpec& base = baseSpecs[j];
+            if (base.kind != specs[i].kind || base.bytes != specs[i].bytes || base.threads != specs[i].threads) {
+                continue;
+            }
+            const CaseResult& before = baseResults[j];
+            const CaseResult& after = results[i];
+            if (after.ratio > before.ratio * (1 + allowed)) report(specs[i], "ratio", before.ratio, after.ratio);
+            if (after.compressMBps < before.compressMBps * (1 - allowed)) {
+                report(specs[i], "compress MB/s", before.compressMBps, after.compressMBps);
+            }
+            if (after.decompressMBps < before.decompressMBps * (1 - allowed)) {
+                report(specs[i], "decompress MB/s", before.decompressMBps, after.decompressMBps);
+            }
+            if (after.peakRssKB > before.peakRssKB * (1 + allowed)) {
+                report(specs[i], "peak RSS KB", (double)before.peakRssKB, (double)after.peakRssKB);
+            }
+            break;
+        }
+    }
+    return regressions;
+}
+
+// ------------------------------------------------------------ arguments
+
+static vector<string> splitList(const string& list) {
+    vector<string> items;
+    stringstream stream(list);
+    string item;
+    while (getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+// "64K", "16M", "2G" (binary units) or plain bytes; 0 if malformed
+static size_t parseSize(const string& text) {
+    char* end = nullptr;
+    unsigned long long value = strtoull(text.c_str(), &end, 10);
+    if (end == text.c_str()) return 0;
+    switch (toupper(*end)) {
+        case 'K': return (size_t)(value << 10);
+        case 'M': return (size_t)(value << 20);
+        case 'G': return (size_t)(value << 30);
+        case '\0': return (size_t)value;
+        default: return 0;
+    }
+}
+
+static string sizeLabel(size_t bytes) {
+    const char* units[] = {"B", "K", "M", "G"};
+    int unit = 0;
+    while (unit < 3 && bytes >= 1024 && bytes % 1024 == 0) {
+        bytes /= 1024;
+        unit++;
+    }
+    return to_string(bytes) + units[unit];
+}
+
+int main(int argc, char** argv) {
+    vector<string> kinds(begin(generatedKinds), end(generatedKinds));
+    vector<size_t> sizes = {1 << 10, 64 << 10, 1 << 20, 16 << 20};
+    unsigned int hardware = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1;
+    vector<unsigned int> threadCounts = {1};
+    if (hardware > 1) threadCounts.push_back(hardware);
+    string corpusDir, outPath, baselinePath;
+    double minSeconds = 0.3, threshold = 5.0;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            cerr << "Missing value for " << arg << endl;
+            return 2;
+        }
+        string value = argv[++i];
+        if (arg == "--kinds") {
+            kinds = splitList(value);
+        } else if (arg == "--sizes") {
+            sizes.clear();
+            for (const string& item : splitList(value)) {
+                size_t bytes = parseSize(item);
+                if (bytes == 0) {
+                    cerr << "Bad size: " << item << endl;
+                    return 2;
+                }
+                sizes.push_back(bytes);
+            }
+        } else if (arg == "--threads") {
+            threadCounts.clear();
+            for (const string& item : splitList(value)) threadCounts.push_back((unsigned int)max(1, atoi(item.c_str())));
+        } else if (arg == "--corpus") {
+            corpusDir = value;
+        } else if (arg == "--min-time") {
+            minSeconds = atof(value.c_str());
+        } else if (arg == "--out") {
+            outPath = value;
+        } else if (arg == "--baseline") {
+            baselinePath = value;
+        } else if (arg == "--threshold") {
+            threshold = atof(value.c_str());
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            return 2;
+        }
+    }
+
+    vector<CaseSpec> specs;
+    if (!corpusDir.empty()) {
+        DIR* dir = opendir(corpusDir.c_str());
+        if (!dir) {
+            cerr << "Cannot open corpus directory: " << corpusDir << endl;
+            return 2;
+        }
+        while (dirent* entry = readdir(dir)) {
+            string path = corpusDir + "/" + entry->d_name;
+            struct stat info;
+            if (entry->d_name[0] == '.' || stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+            for (unsigned int threads : threadCounts) specs.push_back({entry->d_name, path, (size_t)info.st_size, threads});
+        }
+        closedir(dir);
+    } else {
+        for (const string& kind : kinds) {
+            string probe;
+            if (!generateCorpus(kind, 0, probe)) {
+                cerr << "Unknown corpus kind: " << kind << endl;
+                return 2;
+            }
+            for (size_t bytes : sizes) {
+                for (unsigned int threads : threadCounts) specs.push_back({kind, "", bytes, threads});
+            }
+        }
+    }
+
+    printf("kernels: %s\n", kernelLevelName(activeKernelLevel()));
+    printf("%-10s %8s %7s %8s %12s %12s %10s\n", "kind", "size", "threads", "ratio", "comp MB/s", "decomp MB/s",
+           "peak RSS");
+    vector<CaseResult> results;
+    bool allOk = true;
+    for (const CaseSpec& spec : specs) {
+        CaseResult result = runCase(spec, minSeconds);
+        results.push_back(result);
+        if (!result.ok) {
+            printf("%-10s %8s %7u   FAILED\n", spec.kind.c_str(), sizeLabel(spec.bytes).c_str(), spec.threads);
+            allOk = false;
+            continue;
+        }
+        printf("%-10s %8s %7u %8.4f %12.1f %12.1f %7ld MB\n", spec.kind.c_str(), sizeLabel(spec.bytes).c_str(),
+               spec.threads, result.ratio, result.compressMBps, result.decompressMBps, result.peakRssKB / 1024);
+        fflush(stdout);
+    }
+
+    if (!outPath.empty() && !writeResults(outPath, specs, results)) {
+        cerr << "Cannot write " << outPath << endl;
+        return 2;
+    }
+
+    if (!baselinePath.empty()) {
+        vector<CaseSpec> baseSpecs;
+        vector<CaseResult> baseResults;
+        if (!readBaseline(baselinePath, baseSpecs, baseResults)) {
+            cerr << "Cannot read baseline " << baselinePath << endl;
+            return 2;
+        }
+        int regressions = compareBaseline(specs, results, baseSpecs, baseResults, threshold);
+        printf("%d regression(s) beyond %.1f%% against %s\n", regressions, threshold, baselinePath.c_str());
+        if (regressions > 0) return 1;
+    }
+    return allOk ? 0 : 1;
+}
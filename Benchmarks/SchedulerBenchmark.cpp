@@ -0,0 +1,80 @@
+#include "WorkStealingPool.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+/*
+  Scheduler benchmark
+  Compares the work-stealing pool against static partitioning on a skewed
+  workload (a few very expensive items among many cheap ones, like a
+  directory with a handful of huge files), plus raw task spawn overhead.
+  Usage: SchedulerBenchmark [threads]
+*/
+
+// Simulated work: cost grows with the "file size"
+static double work(size_t units) {
+    double x = 0;
+    for (size_t i = 0; i < units; i++) {
+        x += sqrt((double)i + x);
+    }
+    return x;
+}
+
+// Skewed sizes: every 97th item is 200x more expensive
+static size_t itemCost(size_t i) {
+    return (i % 97 == 0) ? 200000 : 1000;
+}
+
+static double elapsedMs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    unsigned int threads = (argc > 1) ? (unsigned int)atoi(argv[1]) : thread::hardware_concurrency();
+    if (threads == 0) threads = 1;
+    const size_t items = 2000;
+    atomic<long long> sink(0);
+
+    // Static partitioning: thread t gets one contiguous slice
+    auto start = chrono::steady_clock::now();
+    {
+        thread* pool = new thread[threads];
+        for (unsigned int t = 0; t < threads; t++) {
+            pool[t] = thread([&, t]() {
+                size_t from = items * t / threads, to = items * (t + 1) / threads;
+                for (size_t i = from; i < to; i++) sink.fetch_add((long long)work(itemCost(i)));
+            });
+        }
+        for (unsigned int t = 0; t < threads; t++) pool[t].join();
+        delete[] pool;
+    }
+    double staticMs = elapsedMs(start);
+
+    WorkStealingPool pool(threads);
+    start = chrono::steady_clock::now();
+    parallelFor(pool, 0, items, 1, [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; i++) sink.fetch_add((long long)work(itemCost(i)));
+    });
+    double stealingMs = elapsedMs(start);
+
+    // Spawn overhead: many empty tasks
+    const int tasks = 200000;
+    start = chrono::steady_clock::now();
+    {
+        TaskGroup group(pool);
+        for (int i = 0; i < tasks; i++) group.run([&sink]() { sink.fetch_add(1); });
+        group.wait();
+    }
+    double spawnMs = elapsedMs(start);
+
+    cout << "threads: " << threads << endl;
+    cout << "skewed workload, static partitioning: " << staticMs << " ms" << endl;
+    cout << "skewed workload, work stealing:       " << stealingMs << " ms" << endl;
+    cout << "empty task spawn+run: " << (spawnMs * 1e6 / tasks) << " ns/task" << endl;
+    return sink.load() == 0; // keep the work from being optimized away
+}
@@ -0,0 +1,133 @@
+#include "AdaptiveHuffman.h"
+#include "BitIO.h"
+
+AdaptiveModel::AdaptiveModel(const AdaptiveOptions& adaptiveOptions) {
+    options = adaptiveOptions;
+    if (options.initialInterval == 0) options.initialInterval = 1;
+    if (options.maxInterval < options.initialInterval) options.maxInterval = options.initialInterval;
+    for (int i = 0; i < 256; i++) {
+        counts[i] = 1; // flat start: every byte has a code
+    }
+    total = 256;
+    interval = options.initialInterval;
+    untilRebuild = interval;
+    rebuildCount = 0;
+    table.buildFromCounts(counts, true);
+}
+
+void AdaptiveModel::rebuild() {
+    if (total > options.ageLimit) {
+        total = 0;
+        for (int i = 0; i < 256; i++) {
+            counts[i] = (counts[i] + 1) / 2; // stays >= 1
+            total += counts[i];
+        }
+    }
+    table.buildFromCounts(counts, true);
+    rebuildCount++;
+
+    if (interval < options.maxInterval) {
+        interval = interval * 2 < options.maxInterval ? interval * 2 : options.maxInterval;
+    }
+    untilRebuild = interval;
+}
+
+void AdaptiveModel::update(const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        counts[data[i]]++;
+    }
+    total += length;
+    untilRebuild -= (unsigned int)length;
+    if (untilRebuild == 0) {
+        rebuild();
+    }
+}
+
+void AdaptiveModel::save(Checkpoint& checkpoint) const {
+    for (int i = 0; i < 256; i++) {
+        checkpoint.counts[i] = counts[i];
+    }
+    checkpoint.total = total;
+    checkpoint.interval = interval;
+    checkpoint.untilRebuild = untilRebuild;
+    checkpoint.rebuildCount = rebuildCount;
+    checkpoint.tree.assign(table.getSerialized());
+}
+
+void AdaptiveModel::restore(const Checkpoint& checkpoint) {
+    if (rebuildCount != checkpoint.rebuildCount) {
+        table.load((const unsigned char*)checkpoint.tree.data(), checkpoint.tree.size());
+    }
+    for (int i = 0; i < 256; i++) {
+        counts[i] = checkpoint.counts[i];
+    }
+    total = checkpoint.total;
+    interval = checkpoint.interval;
+    untilRebuild = checkpoint.untilRebuild;
+    rebuildCount = checkpoint.rebuildCount;
+}
+
+void AdaptiveEncoder::encodeMessage(const unsigned char* data, size_t length, string& out) {
+    unsigned long long value = length;
+    while (value >= 0x80) {
+        out.push_back((char)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+
+    GrowingBufferSink sink(out);
+    BitWriter<GrowingBufferSink> writer(sink);
+    size_t done = 0;
+    while (done < length) {
+        // Code a run with the current table, then let the model catch up
+        size_t run = length - done;
+        if (run > model.symbolsUntilRebuild()) run = model.symbolsUntilRebuild();
+        const HuffmanTable& table = model.code();
+        encodeSymbols(data + done, run, table.getBits(), table.getLengths(), writer);
+        model.update(data + done, run);
+        done += run;
+    }
+    writer.flush();
+}
+
+bool AdaptiveDecoder::decodeMessage(const unsigned char* data, size_t length, string& out, size_t& consumed) {
+    unsigned long long messageLength = 0;
+    size_t position = 0;
+    int shift = 0;
+    while (true) {
+        if (position >= length || shift > 56) return false;
+        unsigned char byte = data[position++];
+        messageLength |= (unsigned long long)(byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) break;
+    }
+
+    // The frame is complete only if its bits are all here; the walk stops at the end of data.
+    // The model is updated as runs decode, so it is rolled back if the frame fails.
+    model.save(checkpoint);
+    MemorySpanSource source(data + position, length - position);
+    BitReader<MemorySpanSource> reader(source);
+    size_t start = out.size();
+    unsigned long long bitsRead = 0;
+    unsigned long long done = 0;
+    while (done < messageLength) {
+        unsigned long long run = messageLength - done;
+        if (run > model.symbolsUntilRebuild()) run = model.symbolsUntilRebuild();
+        GrowingBufferSink sink(out);
+        size_t before = out.size();
+        const HuffmanTable& table = model.code();
+        if (!decodeSymbols(table.getRoot(), reader, run, sink)) {
+            out.resize(start);
+            model.restore(checkpoint);
+            return false;
+        }
+        for (size_t i = before; i < out.size(); i++) {
+            bitsRead += table.codeLength((unsigned char)out[i]);
+        }
+        model.update((const unsigned char*)out.data() + before, (size_t)run);
+        done += run;
+    }
+
+    consumed = position + (size_t)((bitsRead + 7) / 8);
+    return true;
+}
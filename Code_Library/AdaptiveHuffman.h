@@ -0,0 +1,104 @@
+#ifndef MILESTONE_2_ADS_ADAPTIVEHUFFMAN_H
+#define MILESTONE_2_ADS_ADAPTIVEHUFFMAN_H
+
+#include <cstddef>
+#include <string>
+#include "HuffmanTable.h"
+
+using namespace std;
+
+/*
+  Adaptive Huffman for streams
+  One pass, no frequency table up front: encoder and decoder start from the
+  same flat model and rebuild the code (HuffmanNode tree via MinHeap) from
+  the counts seen so far after every 'interval' symbols. Both sides update
+  in lock step, so nothing but the message bits is sent. The interval starts
+  short so the code adapts quickly, then doubles up to maxInterval; counts
+  are halved once they pass ageLimit so old traffic fades out.
+
+  Each message is one frame: [length: LEB128][code bits, padded to a byte],
+  so every message can be sent and decoded as soon as it is encoded.
+  Frames must be decoded in the order they were encoded.
+*/
+
+struct AdaptiveOptions {
+    unsigned int initialInterval = 64;     // symbols before the first rebuild
+    unsigned int maxInterval = 4096;       // rebuild interval cap
+    unsigned long long ageLimit = 1 << 16; // halve counts once their total passes this
+};
+
+/**
+ * Model shared by the encoder and decoder logic: counts and current code
+ */
+class AdaptiveModel {
+private:
+    AdaptiveOptions options;
+    unsigned long long counts[256];
+    unsigned long long total;
+    unsigned int interval;
+    unsigned int untilRebuild;
+    HuffmanTable table;
+    unsigned int rebuildCount;
+
+    void rebuild();
+
+public:
+    // Model state saved before a frame is decoded, restored if the frame fails
+    struct Checkpoint {
+        unsigned long long counts[256];
+        unsigned long long total;
+        unsigned int interval;
+        unsigned int untilRebuild;
+        unsigned int rebuildCount;
+        string tree;    // serialized code, reloaded only if a rebuild happened since
+    };
+
+    explicit AdaptiveModel(const AdaptiveOptions& adaptiveOptions = AdaptiveOptions());
+
+    const HuffmanTable& code() const { return table; }
+
+    // Symbols that can be coded before the model changes
+    unsigned int symbolsUntilRebuild() const { return untilRebuild; }
+
+    // Count symbols that were just coded; rebuilds when the interval is used up
+    void update(const unsigned char* data, size_t length);
+
+    unsigned int getRebuildCount() const { return rebuildCount; }
+
+    void save(Checkpoint& checkpoint) const;
+    void restore(const Checkpoint& checkpoint);
+};
+
+class AdaptiveEncoder {
+private:
+    AdaptiveModel model;
+
+public:
+    explicit AdaptiveEncoder(const AdaptiveOptions& options = AdaptiveOptions()) : model(options) {}
+
+    /**
+     * Encode one message and append its frame to out
+     */
+    void encodeMessage(const unsigned char* data, size_t length, string& out);
+
+    const AdaptiveModel& getModel() const { return model; }
+};
+
+class AdaptiveDecoder {
+private:
+    AdaptiveModel model;
+    AdaptiveModel::Checkpoint checkpoint;   // kept so its tree buffer is reused
+
+public:
+    explicit AdaptiveDecoder(const AdaptiveOptions& options = AdaptiveOptions()) : model(options) {}
+
+    /**
+     * Decode the frame at the start of data and append the message to out.
+     * consumed receives the frame size. Returns false if the frame is
+     * incomplete or corrupt; the model is then left as it was, so the frame
+     * can be retried once the rest of it has arrived.
+     */
+    bool decodeMessage(const unsigned char* data, size_t length, string& out, size_t& consumed);
+};
+
+#endif //MILESTONE_2_ADS_ADAPTIVEHUFFMAN_H
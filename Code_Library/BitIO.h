@@ -0,0 +1,389 @@
+#ifndef MILESTONE_2_ADS_BITIO_H
+#define MILESTONE_2_ADS_BITIO_H
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <unistd.h>
+#include "HuffmanNode.h"
+
+/*
+  Compile-time specialized bit I/O.
+  BitWriter and BitReader are templates over where the bytes go or come
+  from, so each encoder/decoder loop is instantiated per sink or source and
+  inlines completely: no mode flag, no stream calls, no virtual dispatch
+  per bit. Bit order is MSB-first, the same as BitStream, so headers written
+  with BitStream and data written here share one format.
+
+  Sinks provide   void put(unsigned char) and bool flush()
+  Sources provide bool next(unsigned char&), false at the end
+*/
+
+/**
+ * One piece of a scattered buffer (like struct iovec)
+ */
+struct ByteSegment {
+    const unsigned char* data;
+    size_t length;
+};
+
+struct MutableSegment {
+    unsigned char* data;
+    size_t length;
+};
+
+/**
+ * Mask of the low 'bits' bits
+ */
+constexpr unsigned long long lowBitMask(int bits) {
+    return bits >= 64 ? ~0ULL : (1ULL << bits) - 1;
+}
+
+struct BitMaskTable {
+    unsigned long long values[65];
+
+    constexpr BitMaskTable() : values() {
+        for (int i = 0; i <= 64; i++) {
+            values[i] = lowBitMask(i);
+        }
+    }
+};
+
+inline constexpr BitMaskTable bitMasks;    // bitMasks.values[n] == lowBitMask(n), built at compile time
+
+// ---------------------------------------------------------------- sinks
+
+/**
+ * Appends to a std::string that grows as needed
+ */
+class GrowingBufferSink {
+private:
+    std::string& out;
+
+public:
+    explicit GrowingBufferSink(std::string& buffer) : out(buffer) {}
+
+    void put(unsigned char byte) { out.push_back((char)byte); }
+    void reserve(size_t bytes) { out.reserve(out.size() + bytes); }
+    bool flush() { return true; }
+};
+
+/**
+ * Writes into a fixed memory span; overflowing bytes are dropped and reported
+ */
+class MemorySpanSink {
+private:
+    unsigned char* data;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+
+public:
+    MemorySpanSink(unsigned char* span, size_t length) : data(span), capacity(length), used(0), overflow(false) {}
+
+    void put(unsigned char byte) {
+        if (used < capacity) {
+            data[used++] = byte;
+        } else {
+            overflow = true;
+        }
+    }
+    bool flush() { return !overflow; }
+    size_t size() const { return used; }
+};
+
+/**
+ * Buffered writes to a file descriptor
+ */
+class FdSink {
+private:
+    static const size_t bufferSize = 16 * 1024;
+    int fd;
+    unsigned char buffer[bufferSize];
+    size_t used;
+    bool error;
+
+public:
+    explicit FdSink(int descriptor) : fd(descriptor), used(0), error(false) {}
+
+    void put(unsigned char byte) {
+        buffer[used++] = byte;
+        if (used == bufferSize) flush();
+    }
+
+    bool flush() {
+        size_t done = 0;
+        while (!error && done < used) {
+            ssize_t written = ::write(fd, buffer + done, used - done);
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) error = true;
+            else done += (size_t)written;
+        }
+        used = 0;
+        return !error;
+    }
+};
+
+/**
+ * Counts bytes and drops them (verify mode)
+ */
+class DiscardSink {
+private:
+    size_t count;
+
+public:
+    DiscardSink() : count(0) {}
+
+    void put(unsigned char) { count++; }
+    bool flush() { return true; }
+    size_t size() const { return count; }
+};
+
+/**
+ * Writes across a list of memory segments in order; overflow is reported
+ */
+class SegmentSink {
+private:
+    const MutableSegment* segments;
+    size_t count;
+    size_t index;
+    size_t offset;
+    size_t written;
+    bool overflow;
+
+public:
+    SegmentSink(const MutableSegment* list, size_t listCount)
+        : segments(list), count(listCount), index(0), offset(0), written(0), overflow(false) {}
+
+    void put(unsigned char byte) {
+        while (index < count && offset == segments[index].length) {
+            index++;
+            offset = 0;
+        }
+        if (index == count) {
+            overflow = true;
+            return;
+        }
+        segments[index].data[offset++] = byte;
+        written++;
+    }
+    bool flush() { return !overflow; }
+    size_t size() const { return written; }
+};
+
+// -------------------------------------------------------------- sources
+
+/**
+ * Reads from a memory span
+ */
+class MemorySpanSource {
+private:
+    const unsigned char* data;
+    size_t length;
+    size_t position;
+
+public:
+    MemorySpanSource(const unsigned char* span, size_t spanLength) : data(span), length(spanLength), position(0) {}
+
+    bool next(unsigned char& byte) {
+        if (position == length) return false;
+        byte = data[position++];
+        return true;
+    }
+};
+
+/**
+ * Reads a list of memory segments as one stream
+ */
+class SegmentSource {
+private:
+    const ByteSegment* segments;
+    size_t count;
+    size_t index;
+    size_t offset;
+
+public:
+    SegmentSource(const ByteSegment* list, size_t listCount) : segments(list), count(listCount), index(0), offset(0) {}
+
+    bool next(unsigned char& byte) {
+        while (index < count && offset == segments[index].length) {
+            index++;
+            offset = 0;
+        }
+        if (index == count) return false;
+        byte = segments[index].data[offset++];
+        return true;
+    }
+};
+
+/**
+ * Buffered reads from a file descriptor
+ */
+class FdSource {
+private:
+    static const size_t bufferSize = 16 * 1024;
+    int fd;
+    unsigned char buffer[bufferSize];
+    size_t start;
+    size_t end;
+
+public:
+    explicit FdSource(int descriptor) : fd(descriptor), start(0), end(0) {}
+
+    bool next(unsigned char& byte) {
+        if (start == end) {
+            ssize_t got;
+            do {
+                got = ::read(fd, buffer, bufferSize);
+            } while (got < 0 && errno == EINTR);
+            if (got <= 0) return false;
+            start = 0;
+            end = (size_t)got;
+        }
+        byte = buffer[start++];
+        return true;
+    }
+};
+
+// ------------------------------------------------------- writer / reader
+
+template <class Sink>
+class BitWriter {
+private:
+    Sink& sink;
+    unsigned long long accumulator;
+    int pending; // bits in accumulator not yet written (always < 8 between calls)
+
+public:
+    explicit BitWriter(Sink& output) : sink(output), accumulator(0), pending(0) {}
+
+    /**
+     * Continue after a partially filled byte (e.g. the end of a BitStream header)
+     */
+    void resume(unsigned char partialByte, int bits) {
+        pending = bits;
+        accumulator = bits > 0 ? (partialByte >> (8 - bits)) : 0;
+    }
+
+    /**
+     * Append the low 'count' bits of value, most significant first
+     */
+    inline void writeBits(unsigned long long value, int count) {
+        if (count > 56) {
+            writeBits(value >> 32, count - 32);
+            count = 32;
+        }
+        accumulator = (accumulator << count) | (value & bitMasks.values[count]);
+        pending += count;
+        while (pending >= 8) {
+            pending -= 8;
+            sink.put((unsigned char)(accumulator >> pending));
+        }
+    }
+
+    void writeBit(bool bit) { writeBits(bit ? 1 : 0, 1); }
+    void writeByte(unsigned char value) { writeBits(value, 8); }
+
+    /**
+     * Pad the last byte with zeros and flush the sink
+     */
+    bool flush() {
+        if (pending > 0) {
+            sink.put((unsigned char)(accumulator << (8 - pending)));
+            pending = 0;
+        }
+        return sink.flush();
+    }
+};
+
+template <class Source>
+class BitReader {
+private:
+    Source& source;
+    unsigned long long buffer; // next bits, left-aligned
+    int available;
+
+public:
+    explicit BitReader(Source& input) : source(input), buffer(0), available(0) {}
+
+    /**
+     * Top up the bit buffer; returns false if no bits are left at all
+     */
+    inline bool refill() {
+        unsigned char byte;
+        while (available <= 56 && source.next(byte)) {
+            buffer |= (unsigned long long)byte << (56 - available);
+            available += 8;
+        }
+        return available > 0;
+    }
+
+    int bitsAvailable() const { return available; }
+
+    /**
+     * Next 'count' bits without consuming them (count <= bitsAvailable())
+     */
+    inline unsigned long long peekBits(int count) const {
+        return count == 0 ? 0 : buffer >> (64 - count);
+    }
+
+    inline void consumeBits(int count) {
+        buffer = count >= 64 ? 0 : buffer << count;
+        available -= count;
+    }
+
+    /**
+     * Read one bit; sets ok to false past the end
+     */
+    inline bool readBit(bool& ok) {
+        if (available == 0 && !refill()) {
+            ok = false;
+            return false;
+        }
+        bool bit = (buffer >> 63) != 0;
+        buffer <<= 1;
+        available--;
+        return bit;
+    }
+
+    bool skipBits(int count) {
+        while (count > 0) {
+            if (available == 0 && !refill()) return false;
+            int step = count < available ? count : available;
+            consumeBits(step);
+            count -= step;
+        }
+        return true;
+    }
+};
+
+/**
+ * Huffman-encode length bytes with packed codes
+ */
+template <class Sink>
+inline void encodeSymbols(const unsigned char* data, size_t length, const unsigned long long bits[256],
+                          const unsigned char lengths[256], BitWriter<Sink>& writer) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char symbol = data[i];
+        writer.writeBits(bits[symbol], lengths[symbol]);
+    }
+}
+
+/**
+ * Decode count symbols by walking the tree; false if the bits run out
+ */
+template <class Source, class Sink>
+inline bool decodeSymbols(HuffmanNode* root, BitReader<Source>& reader, unsigned long long count, Sink& out) {
+    bool ok = true;
+    for (unsigned long long n = 0; n < count; n++) {
+        HuffmanNode* current = root;
+        while (current->left || current->right) { // isLeaf(), inlined
+            current = reader.readBit(ok) ? current->right : current->left;
+            if (!ok || !current) return false;
+        }
+        out.put(current->data);
+    }
+    return true;
+}
+
+#endif //MILESTONE_2_ADS_BITIO_H
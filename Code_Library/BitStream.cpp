@@ -5,7 +5,7 @@
 
 
 // Initializes the bit stream with the given file and mode (read/write).
-BitStream::BitStream(std::fstream* fileStream, bool mode) {
+BitStream::BitStream(std::iostream* fileStream, bool mode) {
     file = fileStream;
     writingMode = mode;
     byteHolder = 0;
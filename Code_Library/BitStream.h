@@ -3,21 +3,23 @@
 #define MILESTONE_2_ADS_BITSTREAM_H
 
 #include <fstream>
+#include <iostream>
 
 /*
   BitStream class
   Handles reading and writing bits to a file instead of full bytes.
   Used for compression (like Huffman encoding).
+  Any iostream works, so in-memory headers can use a stringstream.
 */
 class BitStream {
 private:
     unsigned char byteHolder;    // holds up to 8 bits before writing/reading
     int bitPosition;             // current bit position inside the byte (0–7)
-    std::fstream* file;          // pointer to file stream
+    std::iostream* file;         // pointer to file (or memory) stream
     bool writingMode;            // true for write mode, false for read mode
 
 public:
-    BitStream(std::fstream* fileStream, bool mode);  // constructor
+    BitStream(std::iostream* fileStream, bool mode); // constructor
     ~BitStream();                                    // destructor
 
     // Writing functions
@@ -32,6 +34,8 @@ public:
 
     // Utility
     void resetStream();                              // reset buffer and bit position
+    int getBitPosition() const { return bitPosition; }            // bits used in the current byte
+    unsigned char getPendingByte() const { return byteHolder; }   // current partial byte
 };
 
 #endif //MILESTONE_2_ADS_BITSTREAM_H
\ No newline at end of file
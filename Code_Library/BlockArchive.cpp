@@ -0,0 +1,1242 @@
+#include "BlockArchive.h"
+#include "BlockCodec.h"
+#include "ByteOrder.h"
+#include "Checksum.h"
+#include "Chunker.h"
+#include "RingBuffer.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char archiveMagic[4] = {'H', 'Z', 'A', '1'};
+static const char trailerMagic[4] = {'H', 'Z', 'A', 'I'};
+static const size_t headerSize = 16;
+static const size_t indexEntrySize = 24;
+static const size_t trailerSize = 28;
+static const size_t maxBlockSize = maxBlockLength; // keeps Huffman code lengths well under 64 bits
+static const size_t encodeScratchBytes = 512 * 1024; // per encoder: histograms, trees, code tables
+static const size_t minPlannedBlockSize = 16 * 1024;  // the memory planner never cuts blocks below this
+
+/**
+ * Charge the growth of a buffer's capacity since the last call; charged keeps the running total
+ */
+static void chargeGrowth(MemoryBudget* budget, size_t capacity, size_t& charged) {
+    if (budget && capacity > charged) {
+        budget->charge(capacity - charged);
+        charged = capacity;
+    }
+}
+
+/**
+ * True, after reporting it, if a job's charges went past its memory limit
+ */
+static bool overMemoryLimit(const MemoryBudget& budget) {
+    if (!budget.exceeded()) return false;
+    cerr << "Error: Memory limit of " << budget.limit() << " bytes exceeded" << endl;
+    return true;
+}
+
+/**
+ * Hands out consecutive blocks of an input stream, either fixed-size or
+ * content-defined. Keeps at least one maximum-size block buffered so the
+ * chunker always sees enough data to find its boundary.
+ */
+class InputBlocks {
+private:
+    SequentialReader& in;
+    const ContentChunker* chunker;
+    MemoryBudget* budget;
+    size_t want;       // bytes needed in the buffer before cutting a block
+    string buffer;
+    size_t start;
+    size_t end;
+    bool inputDone;
+    bool readError;
+
+    void fill() {
+        if (inputDone || end - start >= want) return;
+        if (start > 0) {
+            memmove(&buffer[0], &buffer[start], end - start);
+            end -= start;
+            start = 0;
+        }
+        long long got = in.read((unsigned char*)&buffer[end], buffer.size() - end);
+        if (got > 0) end += (size_t)got;
+        if (end < buffer.size()) inputDone = true; // short read: end of file (or error, see failed())
+        if (got < 0) readError = true;
+    }
+
+public:
+    InputBlocks(SequentialReader& input, const ContentChunker* contentChunker, size_t blockSize,
+                MemoryBudget* memoryBudget = nullptr)
+        : in(input), chunker(contentChunker), budget(memoryBudget) {
+        want = chunker ? chunker->getMaxSize() : blockSize;
+        buffer.resize(want * 2);
+        if (budget) budget->charge(buffer.size());
+        start = 0;
+        end = 0;
+        inputDone = false;
+        readError = false;
+    }
+
+    ~InputBlocks() {
+        if (budget) budget->release(buffer.size());
+    }
+
+    bool failed() const { return readError; }
+
+    // Returns false once the input is exhausted
+    bool next(const unsigned char*& data, size_t& length) {
+        fill();
+        size_t available = end - start;
+        if (available == 0) return false;
+
+        data = (const unsigned char*)&buffer[start];
+        if (chunker) {
+            length = chunker->nextChunkLength(data, available);
+        } else {
+            length = (available < want) ? available : want;
+        }
+        start += length;
+        return true;
+    }
+};
+
+/**
+ * Open-addressing table from chunk hash to the first block with that content
+ */
+class FingerprintTable {
+private:
+    DynamicArray<unsigned long long> keys;
+    DynamicArray<int> blocks; // block index + 1, 0 marks an empty slot
+    size_t count;
+
+    void init(size_t slots) {
+        keys.clear();
+        blocks.clear();
+        keys.reserve(slots);
+        blocks.reserve(slots);
+        for (size_t i = 0; i < slots; i++) {
+            keys.pushBack(0);
+            blocks.pushBack(0);
+        }
+        count = 0;
+    }
+
+    void grow() {
+        DynamicArray<unsigned long long> oldKeys = std::move(keys);
+        DynamicArray<int> oldBlocks = std::move(blocks);
+        init(oldKeys.getSize() * 2);
+        for (size_t i = 0; i < oldKeys.getSize(); i++) {
+            if (oldBlocks[i] != 0) insert(oldKeys[i], oldBlocks[i] - 1);
+        }
+    }
+
+public:
+    explicit FingerprintTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : keys(10, resource), blocks(10, resource) {
+        init(1024);
+    }
+
+    // Returns the block index for hash, or -1
+    int find(unsigned long long hash) const {
+        size_t mask = keys.getSize() - 1;
+        for (size_t i = hash & mask; blocks[i] != 0; i = (i + 1) & mask) {
+            if (keys[i] == hash) return blocks[i] - 1;
+        }
+        return -1;
+    }
+
+    void insert(unsigned long long hash, int block) {
+        if ((count + 1) * 2 > keys.getSize()) grow(); // stay under half full
+        size_t mask = keys.getSize() - 1;
+        size_t i = hash & mask;
+        while (blocks[i] != 0) {
+            if (keys[i] == hash) return; // keep the first occurrence
+            i = (i + 1) & mask;
+        }
+        keys[i] = hash;
+        blocks[i] = block + 1;
+        count++;
+    }
+};
+
+/**
+ * Writes an archive: header, payloads as they come, then index and trailer.
+ * Blocks are either encoded here, copied from an older archive, or
+ * stored as a reference to a payload that is already in the output.
+ */
+class ArchiveWriter {
+private:
+    unique_ptr<SequentialWriter> out;
+    bool writeError;
+    DynamicArray<ArchiveBlock> blocks;
+    DynamicArray<unsigned long long> rawOffsets; // where each block starts in the original
+    unsigned long long offset;
+    unsigned long long rawOffset;
+    string payload;
+    MemoryBudget* budget;
+    size_t payloadCharged;
+
+public:
+    ArchiveStats stats;
+
+    // The index arrays come from resource, so a BudgetResource there counts them too
+    explicit ArchiveWriter(MemoryBudget* memoryBudget = nullptr,
+                           std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : blocks(64, resource), rawOffsets(64, resource), budget(memoryBudget) {
+        offset = 0;
+        rawOffset = 0;
+        writeError = false;
+        payloadCharged = 0;
+    }
+
+    ~ArchiveWriter() {
+        if (budget) budget->release(payloadCharged);
+    }
+
+    BlockEncodeOptions encodeOptions;
+
+    bool open(unique_ptr<SequentialWriter> output, unsigned int flags, unsigned int blockSize,
+              const string& sharedTable = string()) {
+        out = std::move(output);
+        if (!out) {
+            cerr << "Error: Cannot create output file" << endl;
+            return false;
+        }
+
+        string header(archiveMagic, 4);
+        header.push_back(1);              // version
+        header.push_back((char)flags);
+        appendU16(header, 0);
+        appendU32(header, blockSize);
+        appendU32(header, (unsigned int)sharedTable.size());
+        header += sharedTable;
+        write(header.data(), header.size());
+        offset = header.size();
+        return true;
+    }
+
+    void write(const char* bytes, size_t length) {
+        if (!writeError && !out->write((const unsigned char*)bytes, length)) writeError = true;
+    }
+
+    size_t blockCount() const { return blocks.getSize(); }
+    const ArchiveBlock& block(size_t i) const { return blocks[i]; }
+    unsigned long long blockRawOffset(size_t i) const { return rawOffsets[i]; }
+
+    // Encode a new block
+    void addEncoded(const unsigned char* data, size_t length, unsigned long long hash) {
+        payload.clear();
+        encodeBlock(data, length, payload, encodeOptions);
+        chargeGrowth(budget, payload.capacity(), payloadCharged);
+        addPayload(payload.data(), payload.size(), (unsigned int)length, hash);
+    }
+
+    // Store an already-encoded payload byte-for-byte
+    void addPayload(const char* bytes, size_t length, unsigned int rawLength, unsigned long long hash) {
+        write(bytes, length);
+        if (length > 0 && (unsigned char)bytes[0] == BLOCK_HUFFMAN_SHARED) stats.sharedTableBlocks++;
+        ArchiveBlock block;
+        block.payloadOffset = offset;
+        block.payloadLength = (unsigned int)length;
+        block.rawLength = rawLength;
+        block.hash = hash;
+        offset += length;
+        push(block);
+    }
+
+    // Point at the payload of an earlier block with the same content
+    void addReference(size_t earlier) {
+        ArchiveBlock block = blocks[earlier];
+        push(block);
+        stats.duplicateBlocks++;
+    }
+
+    void push(const ArchiveBlock& block) {
+        blocks.pushBack(block);
+        rawOffsets.pushBack(rawOffset);
+        rawOffset += block.rawLength;
+    }
+
+    bool finish(const string& outputFile) {
+        string index;
+        for (size_t i = 0; i < blocks.getSize(); i++) {
+            appendU64(index, blocks[i].payloadOffset);
+            appendU32(index, blocks[i].payloadLength);
+            appendU32(index, blocks[i].rawLength);
+            appendU64(index, blocks[i].hash);
+        }
+        appendU64(index, offset);
+        appendU64(index, blocks.getSize());
+        appendU64(index, rawOffset);
+        index.append(trailerMagic, 4);
+        write(index.data(), index.size());
+        if (!out->finish() || writeError) {
+            cerr << "Error: Failed writing " << outputFile << endl;
+            return false;
+        }
+
+        stats.bytesIn = rawOffset;
+        stats.bytesOut = offset + index.size();
+        stats.blockCount = blocks.getSize();
+        return true;
+    }
+};
+
+/**
+ * True if the earlier block really holds the same bytes (guards against hash collisions)
+ */
+static bool sameContent(RandomAccessReader& original, unsigned long long offset, const unsigned char* data,
+                        size_t length) {
+    string earlier(length, '\0');
+    return original.readAt(offset, (unsigned char*)&earlier[0], length) && memcmp(earlier.data(), data, length) == 0;
+}
+
+/**
+ * Read one block's payload, decode it and check its length and hash
+ */
+static bool readBlock(RandomAccessReader& in, const ArchiveBlock& block, const HuffmanTable* sharedTable,
+                      string& payload, string& decoded) {
+    payload.resize(block.payloadLength);
+    decoded.clear();
+    decoded.reserve(block.rawLength);
+    return in.readAt(block.payloadOffset, (unsigned char*)&payload[0], block.payloadLength)
+           && decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded, sharedTable, block.rawLength)
+           && decoded.size() == block.rawLength
+           && hash64((const unsigned char*)decoded.data(), decoded.size()) == block.hash;
+}
+
+static string describe(const ArchiveEndpoint& endpoint) {
+    if (endpoint.kind == ENDPOINT_FD) return "descriptor " + to_string(endpoint.fd);
+    if (endpoint.kind == ENDPOINT_MEMORY) return "memory buffer";
+    return endpoint.path;
+}
+
+static unique_ptr<SequentialReader> openSource(const ArchiveEndpoint& source, const IoOptions& io) {
+    if (source.kind == ENDPOINT_FD) return openSequentialReader(source.fd, io);
+    if (source.kind == ENDPOINT_MEMORY) return openMemoryReader(source.data, source.length);
+    return openSequentialReader(source.path, io);
+}
+
+static unique_ptr<RandomAccessReader> openSourceAt(const ArchiveEndpoint& source) {
+    if (source.kind == ENDPOINT_FD) return openRandomAccessReader(source.fd);
+    if (source.kind == ENDPOINT_MEMORY) return openRandomAccessReader(source.data, source.length);
+    return openRandomAccessReader(source.path);
+}
+
+static unique_ptr<SequentialWriter> openSink(const ArchiveEndpoint& sink, const IoOptions& io) {
+    if (sink.kind == ENDPOINT_FD) return openSequentialWriter(sink.fd, io);
+    if (sink.kind == ENDPOINT_MEMORY) return sink.buffer ? openStringWriter(*sink.buffer) : nullptr;
+    return openSequentialWriter(sink.path, io);
+}
+
+/**
+ * Undo the output of a cancelled job: remove a file, or cut a memory buffer
+ * back to where the job started appending. Descriptors belong to the caller.
+ */
+static void discardOutput(const ArchiveEndpoint& sink, size_t bufferStart) {
+    if (sink.kind == ENDPOINT_PATH) {
+        std::error_code ec;
+        std::filesystem::remove(sink.path, ec);
+    } else if (sink.kind == ENDPOINT_MEMORY && sink.buffer && sink.buffer->size() > bufferStart) {
+        sink.buffer->resize(bufferStart);
+    }
+}
+
+/**
+ * Input size if it is known up front (files and memory), else 0
+ */
+static unsigned long long sourceSize(const ArchiveEndpoint& source) {
+    if (source.kind == ENDPOINT_MEMORY) return source.length;
+    struct stat info;
+    if (source.kind == ENDPOINT_FD) {
+        off_t position = lseek(source.fd, 0, SEEK_CUR);
+        if (fstat(source.fd, &info) != 0 || !S_ISREG(info.st_mode) || position < 0 || position > info.st_size) {
+            return 0;
+        }
+        return (unsigned long long)(info.st_size - position);
+    }
+    std::error_code ec;
+    unsigned long long size = std::filesystem::file_size(source.path, ec);
+    return ec ? 0 : size;
+}
+
+/**
+ * Check the block size and set up the chunker the same way for compress and update
+ */
+static bool chooseBlockSize(bool contentDefined, size_t requested, ContentChunker& chunker, size_t& blockSize) {
+    blockSize = (requested == 0) ? ArchiveOptions().blockSize : requested;
+    if (contentDefined) {
+        chunker = ContentChunker(blockSize);
+        blockSize = chunker.getAverageSize();
+        if (chunker.getMaxSize() > maxBlockSize) {
+            cerr << "Error: Chunk size too large" << endl;
+            return false;
+        }
+    } else if (blockSize > maxBlockSize) {
+        cerr << "Error: Block size too large" << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * One block travelling through the pipeline. The buffers are recycled, so
+ * after warm-up raw and payload keep their capacity and nothing is allocated.
+ */
+struct PipelineBlock {
+    size_t sequence;
+    string raw;
+    string payload;
+    unsigned long long hash;
+    long long reference; // earlier block with the same content, or -1
+    size_t charged = 0;  // capacity of raw + payload charged to the memory budget
+};
+
+/**
+ * Three-stage compression pipeline:
+ *   reader thread  -> encode workers -> writer (the calling thread)
+ * The reader cuts, hashes and deduplicates blocks, workers encode them in
+ * any order, and the writer puts them back in sequence before writing, so
+ * disk reads, encoding and disk writes all overlap.
+ */
+static void runPipeline(InputBlocks& input, RandomAccessReader* original, bool dedup,
+                        ArchiveWriter& writer, unsigned int workerCount,
+                        size_t scratchBytes, MemoryBudget* budget, std::pmr::memory_resource* indexResource,
+                        JobTracker& tracker) {
+    const size_t inFlight = workerCount * 2 + 2;
+    PipelineBlock* buffers = new PipelineBlock[inFlight];
+    SpscRing<PipelineBlock*> freeBuffers(inFlight); // writer -> reader
+    MpmcRing<PipelineBlock*> toEncode(inFlight);    // reader -> workers
+    MpmcRing<PipelineBlock*> toWrite(inFlight);     // workers (and reader, for references) -> writer
+    for (size_t i = 0; i < inFlight; i++) {
+        freeBuffers.push(&buffers[i]);
+    }
+
+    std::atomic<size_t> totalBlocks(0);
+    std::atomic<bool> readerDone(false);
+
+    if (budget) budget->charge(workerCount * scratchBytes);
+
+    std::thread reader([&]() {
+        FingerprintTable seen(indexResource);
+        DynamicArray<unsigned long long> rawOffsets(64, indexResource);
+        DynamicArray<unsigned long long> rawLengths(64, indexResource);
+        unsigned long long rawOffset = 0;
+        size_t sequence = 0;
+
+        const unsigned char* data;
+        size_t length;
+        // On cancellation or an exceeded budget the reader stops cutting blocks and the ones in flight drain
+        while (!tracker.cancelled() && !(budget && budget->exceeded()) && input.next(data, length)) {
+            PipelineBlock* block;
+            freeBuffers.pop(block);
+            block->sequence = sequence;
+            block->raw.assign((const char*)data, length);
+            block->reference = -1;
+            chargeGrowth(budget, block->raw.capacity() + block->payload.capacity(), block->charged);
+
+            if (dedup) {
+                block->hash = hash64(data, length);
+                int earlier = seen.find(block->hash);
+                if (earlier >= 0 && rawLengths[earlier] == length
+                    && sameContent(*original, rawOffsets[earlier], data, length)) {
+                    block->reference = earlier;
+                } else {
+                    seen.insert(block->hash, (int)sequence);
+                }
+                rawOffsets.pushBack(rawOffset);
+                rawLengths.pushBack(length);
+                rawOffset += length;
+            }
+
+            if (block->reference >= 0) {
+                toWrite.push(block); // nothing to encode
+            } else {
+                toEncode.push(block);
+            }
+            sequence++;
+        }
+
+        totalBlocks.store(sequence);
+        readerDone.store(true, std::memory_order_release);
+        for (unsigned int i = 0; i < workerCount; i++) {
+            toEncode.push(nullptr); // one stop marker per worker
+        }
+    });
+
+    std::thread* workers = new std::thread[workerCount];
+    for (unsigned int w = 0; w < workerCount; w++) {
+        workers[w] = std::thread([&]() {
+            while (true) {
+                PipelineBlock* block;
+                toEncode.pop(block);
+                if (!block) break;
+
+                const unsigned char* data = (const unsigned char*)block->raw.data();
+                if (!dedup) block->hash = hash64(data, block->raw.size());
+                block->payload.clear();
+                encodeBlock(data, block->raw.size(), block->payload, writer.encodeOptions);
+                chargeGrowth(budget, block->raw.capacity() + block->payload.capacity(), block->charged);
+                toWrite.push(block);
+            }
+        });
+    }
+
+    // Writer: restore order with a window indexed by sequence number.
+    // At most inFlight blocks exist, so their slots never collide.
+    PipelineBlock** window = new PipelineBlock*[inFlight]();
+    size_t next = 0;
+    int attempts = 0;
+    while (!(readerDone.load(std::memory_order_acquire) && next == totalBlocks.load())) {
+        PipelineBlock* block;
+        if (!toWrite.tryPop(block)) {
+            pipelineBackoff(attempts);
+            continue;
+        }
+        attempts = 0;
+        window[block->sequence % inFlight] = block;
+
+        while (window[next % inFlight] && window[next % inFlight]->sequence == next) {
+            PipelineBlock* ready = window[next % inFlight];
+            window[next % inFlight] = nullptr;
+            if (ready->reference >= 0) {
+                writer.addReference((size_t)ready->reference);
+            } else {
+                writer.addPayload(ready->payload.data(), ready->payload.size(),
+                                  (unsigned int)ready->raw.size(), ready->hash);
+            }
+            tracker.advance(ready->raw.size());
+            freeBuffers.push(ready);
+            next++;
+        }
+    }
+
+    reader.join();
+    for (unsigned int w = 0; w < workerCount; w++) {
+        workers[w].join();
+    }
+    delete[] workers;
+    delete[] window;
+    if (budget) {
+        for (size_t i = 0; i < inFlight; i++) {
+            budget->release(buffers[i].charged);
+        }
+        budget->release(workerCount * scratchBytes);
+    }
+    delete[] buffers;
+}
+
+/**
+ * What a compression job will run with once it fits its memory limit
+ */
+struct MemoryPlan {
+    size_t blockSize;   // fixed block size, or average chunk size with dedup
+    unsigned int threads;
+    IoOptions io;
+};
+
+/**
+ * Working memory of one encoder for blocks up to the largest chunk
+ */
+static size_t encoderScratch(const ArchiveOptions& options, size_t blockSize) {
+    size_t want = options.dedup ? blockSize * 4 : blockSize;
+    return encodeScratchBytes + transformScratchBytes(options.transform, want);
+}
+
+/**
+ * Worst-case bytes for a compression job: input window, I/O buffers, index
+ * and the blocks and scratch of the encoders
+ */
+static size_t estimateCompressMemory(const MemoryPlan& plan, const ArchiveOptions& options,
+                                     unsigned long long inputSize) {
+    bool dedup = options.dedup;
+    size_t scratch = encoderScratch(options, plan.blockSize);
+    size_t want = dedup ? plan.blockSize * 4 : plan.blockSize; // chunks reach 4x the average
+    size_t perBlock = 2 * (sizeof(ArchiveBlock) + sizeof(unsigned long long)); // index arrays, with growth slack
+    if (dedup) perBlock += 2 * 2 * (sizeof(unsigned long long) + sizeof(int)) + 4 * sizeof(unsigned long long);
+    unsigned long long blockCount = inputSize / plan.blockSize + 1;
+
+    unsigned long long total = 2 * want + 2 * ioBufferBytes(plan.io) + blockCount * perBlock;
+    if (plan.threads > 0) {
+        size_t inFlight = plan.threads * 2 + 2;
+        total += inFlight * (2 * want + 64) + plan.threads * scratch;
+    } else {
+        total += want + 64 + scratch;
+    }
+    if (dedup) total += want; // sameContent re-reads one chunk
+    return total > SIZE_MAX ? SIZE_MAX : (size_t)total;
+}
+
+/**
+ * Shrink the job until its estimate fits the limit: fewer encode threads
+ * first (each holds two blocks in flight plus scratch), then smaller I/O
+ * buffers and a shallower queue, then smaller blocks. False if even the
+ * smallest configuration does not fit.
+ */
+static bool planCompressMemory(const ArchiveOptions& options, size_t blockSize, unsigned long long inputSize,
+                               MemoryPlan& plan) {
+    plan.blockSize = blockSize;
+    plan.threads = options.threads;
+    plan.io = options.io;
+    if (options.memoryLimit == 0) return true;
+
+    size_t smallestBlock = options.dedup ? minPlannedBlockSize / 4 : minPlannedBlockSize;
+    while (estimateCompressMemory(plan, options, inputSize) > options.memoryLimit) {
+        if (plan.threads > 0) {
+            plan.threads--;
+            continue;
+        }
+        if (shrinkIoBuffers(plan.io)) continue;
+        if (plan.blockSize / 2 < smallestBlock) return false;
+        plan.blockSize /= 2;
+    }
+    return true;
+}
+
+bool compressArchive(const string& inputFile, const string& outputFile,
+                     const ArchiveOptions& options, ArchiveStats* stats) {
+    return compressArchive(ArchiveEndpoint::file(inputFile), ArchiveEndpoint::file(outputFile), options, stats);
+}
+
+bool compressArchive(const ArchiveEndpoint& source, const ArchiveEndpoint& sink,
+                     const ArchiveOptions& options, ArchiveStats* stats) {
+    ContentChunker chunker;
+    size_t blockSize;
+    if (!chooseBlockSize(options.dedup, options.blockSize, chunker, blockSize)) {
+        return false;
+    }
+
+    // Second view of the input to re-read earlier chunks when hashes match.
+    // Opened before reading starts: a descriptor's offsets count from its current position.
+    unique_ptr<RandomAccessReader> original;
+    if (options.dedup) {
+        original = openSourceAt(source);
+        if (!original) {
+            cerr << "Error: Dedup needs a regular file or memory input, not " << describe(source) << endl;
+            return false;
+        }
+    }
+
+    MemoryPlan plan;
+    if (!planCompressMemory(options, blockSize, sourceSize(source), plan)) {
+        cerr << "Error: Memory limit of " << options.memoryLimit << " bytes is too small" << endl;
+        return false;
+    }
+    if (plan.blockSize != blockSize) {
+        chooseBlockSize(options.dedup, plan.blockSize, chunker, blockSize);
+    }
+
+    unique_ptr<SequentialReader> in = openSource(source, plan.io);
+    if (!in) {
+        cerr << "Error: Cannot open file " << describe(source) << endl;
+        return false;
+    }
+
+    // Buffers we cannot see into (the I/O backends) are charged at their configured size
+    MemoryBudget budget(options.memoryLimit);
+    BudgetResource indexResource(budget);
+    budget.charge(2 * ioBufferBytes(plan.io));
+
+    ArchiveWriter writer(&budget, &indexResource);
+    size_t bufferStart = sink.kind == ENDPOINT_MEMORY && sink.buffer ? sink.buffer->size() : 0;
+    unsigned int flags = options.dedup ? ARCHIVE_FLAG_CONTENT_DEFINED : 0;
+    writer.encodeOptions.presetId = options.tableId;
+    writer.encodeOptions.coder = options.coder;
+    writer.encodeOptions.transform = options.transform;
+    writer.encodeOptions.recordStride = options.recordStride;
+    HuffmanTable sharedTable;
+    if (options.sampling.enabled && source.kind == ENDPOINT_PATH) {
+        // One table for the whole archive, estimated without reading all of the input
+        unsigned long long counts[256];
+        unsigned long long totalBytes;
+        sampleFrequencies(source.path, options.sampling, counts, totalBytes);
+        if (sharedTable.buildFromCounts(counts, true)) {
+            flags |= ARCHIVE_FLAG_SHARED_TABLE;
+            writer.encodeOptions.sharedTable = &sharedTable;
+            writer.encodeOptions.sharedTolerance = options.sampling.tolerance;
+        }
+    }
+    if (!writer.open(openSink(sink, plan.io), flags, (unsigned int)blockSize, sharedTable.getSerialized())) {
+        return false;
+    }
+
+    InputBlocks input(*in, options.dedup ? &chunker : nullptr, blockSize, &budget);
+    JobTracker tracker(options.control, sourceSize(source));
+
+    size_t scratch = encoderScratch(options, blockSize);
+    if (plan.threads > 0) {
+        runPipeline(input, original.get(), options.dedup, writer, plan.threads, scratch, &budget, &indexResource,
+                    tracker);
+    } else {
+        budget.charge(scratch);
+        FingerprintTable seen(&indexResource);
+        const unsigned char* data;
+        size_t length;
+        while (input.next(data, length)) {
+            unsigned long long hash = hash64(data, length);
+
+            int earlier = options.dedup ? seen.find(hash) : -1;
+            if (earlier >= 0 && writer.block(earlier).rawLength == length
+                && sameContent(*original, writer.blockRawOffset(earlier), data, length)) {
+                // Repeated chunk: reference the existing payload, write nothing
+                writer.addReference(earlier);
+            } else {
+                if (options.dedup) seen.insert(hash, (int)writer.blockCount());
+                writer.addEncoded(data, length, hash);
+            }
+            if (!tracker.advance(length) || budget.exceeded()) break;
+        }
+        budget.release(scratch);
+    }
+
+    if (tracker.cancelled()) {
+        discardOutput(sink, bufferStart);
+        cerr << "Compression of " << describe(source) << " cancelled" << endl;
+        return false;
+    }
+    if (overMemoryLimit(budget)) {
+        discardOutput(sink, bufferStart);
+        return false;
+    }
+
+    if (input.failed()) {
+        cerr << "Error: Cannot read file " << describe(source) << endl;
+        return false;
+    }
+    if (!writer.finish(describe(sink))) {
+        return false;
+    }
+    tracker.finish();
+    if (stats) {
+        *stats = writer.stats;
+        stats->estimatedPeakMemory = budget.peak();
+        stats->peakResidentMemory = peakResidentBytes();
+    }
+    return true;
+}
+
+bool updateArchive(const string& oldArchive, const string& inputFile, const string& outputFile,
+                   const ArchiveOptions& options, ArchiveStats* stats) {
+    std::error_code ec;
+    if (std::filesystem::equivalent(oldArchive, outputFile, ec)) {
+        cerr << "Error: Output must not overwrite the archive being updated" << endl;
+        return false;
+    }
+
+    ArchiveInfo old;
+    unique_ptr<RandomAccessReader> oldIn = openRandomAccessReader(oldArchive);
+    if (!oldIn) {
+        cerr << "Error: Cannot open archive " << oldArchive << endl;
+        return false;
+    }
+    if (!readArchiveInfo(*oldIn, old)) {
+        return false;
+    }
+
+    // Cut the new input exactly the way the old archive was cut
+    bool contentDefined = (old.flags & ARCHIVE_FLAG_CONTENT_DEFINED) != 0;
+    ContentChunker chunker;
+    size_t blockSize;
+    if (!chooseBlockSize(contentDefined, old.blockSize, chunker, blockSize)) {
+        return false;
+    }
+
+    // The block size is fixed by the old archive, so only the I/O buffers can shrink to fit the limit
+    ArchiveOptions planned = options;
+    planned.dedup = contentDefined;
+    planned.threads = 0;
+    MemoryPlan plan;
+    plan.blockSize = blockSize;
+    plan.threads = 0;
+    plan.io = options.io;
+    std::error_code sizeError;
+    unsigned long long inputSize = std::filesystem::file_size(inputFile, sizeError);
+    if (sizeError) inputSize = 0;
+    // Plus the old index and the decoded copy of an old block being compared
+    size_t oldIndexBytes = old.blocks.getCapacity() * sizeof(ArchiveBlock) + old.sharedTable.size()
+                           + old.blocks.getSize() * 2 * 2 * (sizeof(unsigned long long) + sizeof(int))
+                           + (contentDefined ? blockSize * 4 : blockSize);
+    while (options.memoryLimit > 0
+           && estimateCompressMemory(plan, planned, inputSize) + oldIndexBytes > options.memoryLimit) {
+        if (!shrinkIoBuffers(plan.io)) {
+            cerr << "Error: Memory limit of " << options.memoryLimit << " bytes is too small" << endl;
+            return false;
+        }
+    }
+
+    unique_ptr<SequentialReader> in = openSequentialReader(inputFile, plan.io);
+    if (!in) {
+        cerr << "Error: Cannot open file " << inputFile << endl;
+        return false;
+    }
+
+    // Copied payloads may depend on the old shared table, so it carries over unchanged
+    HuffmanTable sharedTable;
+    if (!old.sharedTable.empty()
+        && !sharedTable.load((const unsigned char*)old.sharedTable.data(), old.sharedTable.size())) {
+        cerr << "Error: Corrupt shared table" << endl;
+        return false;
+    }
+
+    MemoryBudget budget(options.memoryLimit);
+    BudgetResource indexResource(budget);
+    budget.charge(2 * ioBufferBytes(plan.io) + old.blocks.getCapacity() * sizeof(ArchiveBlock)
+                  + old.sharedTable.size());
+
+    ArchiveWriter writer(&budget, &indexResource);
+    if (!writer.open(openSequentialWriter(outputFile, plan.io), old.flags, (unsigned int)blockSize,
+                     old.sharedTable)) {
+        return false;
+    }
+    if (!sharedTable.empty()) writer.encodeOptions.sharedTable = &sharedTable;
+    writer.encodeOptions.presetId = options.tableId;
+    writer.encodeOptions.coder = options.coder;
+    writer.encodeOptions.transform = options.transform;
+    writer.encodeOptions.recordStride = options.recordStride;
+
+    // Old blocks by content hash
+    FingerprintTable oldBlocks(&indexResource);
+    for (size_t i = 0; i < old.blocks.getSize(); i++) {
+        oldBlocks.insert(old.blocks[i].hash, (int)i);
+    }
+    FingerprintTable written(&indexResource); // new blocks whose payload is already in the output
+
+    InputBlocks input(*in, contentDefined ? &chunker : nullptr, blockSize, &budget);
+    size_t scratch = encoderScratch(planned, blockSize);
+    budget.charge(scratch);
+    unique_ptr<RandomAccessReader> original;
+    if (contentDefined) original = openRandomAccessReader(inputFile);
+    string payload;
+    string decoded;
+    size_t payloadCharged = 0;
+    size_t decodedCharged = 0;
+    unsigned long long copiedBlocks = 0;
+
+    const unsigned char* data;
+    size_t length;
+    while (!budget.exceeded() && input.next(data, length)) {
+        unsigned long long hash = hash64(data, length);
+
+        int earlier = (contentDefined && original) ? written.find(hash) : -1;
+        if (earlier >= 0 && writer.block(earlier).rawLength == length
+            && sameContent(*original, writer.blockRawOffset(earlier), data, length)) {
+            writer.addReference(earlier);
+            continue;
+        }
+        if (contentDefined) written.insert(hash, (int)writer.blockCount());
+
+        // Unchanged block: copy the old payload byte-for-byte, once it decodes to exactly these bytes
+        int match = oldBlocks.find(hash);
+        if (match >= 0 && old.blocks[match].rawLength == length) {
+            const ArchiveBlock& source = old.blocks[match];
+            bool same = readBlock(*oldIn, source, sharedTable.empty() ? nullptr : &sharedTable, payload, decoded)
+                        && memcmp(decoded.data(), data, length) == 0;
+            chargeGrowth(&budget, payload.capacity(), payloadCharged);
+            chargeGrowth(&budget, decoded.capacity(), decodedCharged);
+            if (same) {
+                writer.addPayload(payload.data(), payload.size(), source.rawLength, hash);
+                copiedBlocks++;
+                continue;
+            }
+        }
+        writer.addEncoded(data, length, hash);
+    }
+    budget.release(scratch + payloadCharged + decodedCharged);
+
+    if (overMemoryLimit(budget)) {
+        discardOutput(ArchiveEndpoint::file(outputFile), 0);
+        return false;
+    }
+    if (input.failed()) {
+        cerr << "Error: Cannot read file " << inputFile << endl;
+        return false;
+    }
+    if (!writer.finish(outputFile)) {
+        return false;
+    }
+    if (stats) {
+        *stats = writer.stats;
+        stats->copiedBlocks = copiedBlocks;
+        stats->estimatedPeakMemory = budget.peak();
+        stats->peakResidentMemory = peakResidentBytes();
+    }
+    return true;
+}
+
+bool compressDirectory(const string& inputDir, const string& outputDir, WorkStealingPool& pool,
+                       const ArchiveOptions& options, ArchiveStats* stats) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (!fs::is_directory(inputDir, ec)) {
+        cerr << "Error: " << inputDir << " is not a directory" << endl;
+        return false;
+    }
+
+    ArchiveStats total;
+    bool ok = true;
+    std::mutex totalMutex;
+    TaskGroup group(pool);
+
+    // Up to one file per worker runs at a time, so each gets an equal share of the limit
+    ArchiveOptions fileOptions = options;
+    if (options.memoryLimit > 0) {
+        fileOptions.memoryLimit = options.memoryLimit / (pool.threadCount() > 0 ? pool.threadCount() : 1);
+    }
+
+    // ec belongs to the walk; each entry's own failures are reported and skipped
+    auto fail = [&ok, &totalMutex](const fs::path& path, const std::error_code& error) {
+        std::lock_guard<std::mutex> lock(totalMutex);
+        cerr << "Error: Cannot compress " << path.string() << ": " << error.message() << endl;
+        ok = false;
+    };
+    for (fs::recursive_directory_iterator it(inputDir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code typeError;
+        bool regular = it->is_regular_file(typeError);
+        if (typeError) {
+            fail(it->path(), typeError);
+            continue;
+        }
+        if (!regular) continue;
+
+        fs::path source = it->path();
+        std::error_code pathError;
+        fs::path relative = fs::relative(source, inputDir, pathError);
+        if (pathError) {
+            fail(source, pathError);
+            continue;
+        }
+        fs::path target = fs::path(outputDir) / relative;
+        target += ".hza";
+        group.run([source, target, &fileOptions, &total, &ok, &totalMutex, &fail]() {
+            std::error_code dirError;
+            fs::create_directories(target.parent_path(), dirError);
+            if (dirError) {
+                fail(source, dirError);
+                return;
+            }
+            ArchiveStats fileStats;
+            bool done = compressArchive(source.string(), target.string(), fileOptions, &fileStats);
+
+            std::lock_guard<std::mutex> lock(totalMutex);
+            ok = ok && done;
+            total.bytesIn += fileStats.bytesIn;
+            total.bytesOut += fileStats.bytesOut;
+            total.blockCount += fileStats.blockCount;
+            total.duplicateBlocks += fileStats.duplicateBlocks;
+            total.sharedTableBlocks += fileStats.sharedTableBlocks;
+        });
+    }
+    group.wait();
+
+    if (ec) {
+        cerr << "Error: Cannot walk " << inputDir << ": " << ec.message() << endl;
+        ok = false;
+    }
+    if (stats) {
+        *stats = total;
+        stats->peakResidentMemory = peakResidentBytes();
+    }
+    return ok;
+}
+
+bool readArchiveInfo(const string& archiveFile, ArchiveInfo& info) {
+    unique_ptr<RandomAccessReader> in = openRandomAccessReader(archiveFile);
+    if (!in) {
+        cerr << "Error: Cannot open archive " << archiveFile << endl;
+        return false;
+    }
+    return readArchiveInfo(*in, info);
+}
+
+bool readArchiveInfo(RandomAccessReader& in, ArchiveInfo& info) {
+    unsigned long long fileSize = in.size();
+    if (fileSize < headerSize + trailerSize) {
+        cerr << "Error: Not a block archive" << endl;
+        return false;
+    }
+
+    unsigned char header[headerSize];
+    unsigned char trailer[trailerSize];
+    if (!in.readAt(0, header, headerSize) || !in.readAt(fileSize - trailerSize, trailer, trailerSize)
+        || memcmp(header, archiveMagic, 4) != 0 || memcmp(trailer + 24, trailerMagic, 4) != 0) {
+        cerr << "Error: Not a block archive" << endl;
+        return false;
+    }
+
+    info.flags = header[5];
+    info.blockSize = readU32(header + 8);
+    unsigned long long tableLength = (info.flags & ARCHIVE_FLAG_SHARED_TABLE) ? readU32(header + 12) : 0;
+    unsigned long long payloadStart = headerSize + tableLength;
+    info.largestBlock = (info.flags & ARCHIVE_FLAG_CONTENT_DEFINED) ? ContentChunker(info.blockSize).getMaxSize()
+                                                                     : info.blockSize;
+    if (info.blockSize == 0 || info.largestBlock > maxBlockSize) {
+        cerr << "Error: Corrupt archive header" << endl;
+        return false;
+    }
+    info.indexOffset = readU64(trailer);
+    unsigned long long blockCount = readU64(trailer + 8);
+    info.originalSize = readU64(trailer + 16);
+    if (info.indexOffset < payloadStart || info.indexOffset > fileSize - trailerSize
+        || blockCount != (fileSize - trailerSize - info.indexOffset) / indexEntrySize) {
+        cerr << "Error: Corrupt archive index" << endl;
+        return false;
+    }
+
+    info.sharedTable.assign(tableLength, '\0');
+    string index(blockCount * indexEntrySize, '\0');
+    if ((tableLength > 0 && !in.readAt(headerSize, (unsigned char*)&info.sharedTable[0], tableLength))
+        || (!index.empty() && !in.readAt(info.indexOffset, (unsigned char*)&index[0], index.size()))) {
+        cerr << "Error: Corrupt archive index" << endl;
+        return false;
+    }
+
+    info.blocks.clear();
+    info.blocks.reserve(blockCount);
+    unsigned long long total = 0;
+    for (unsigned long long i = 0; i < blockCount; i++) {
+        const unsigned char* entry = (const unsigned char*)index.data() + i * indexEntrySize;
+        ArchiveBlock block;
+        block.payloadOffset = readU64(entry);
+        block.payloadLength = readU32(entry + 8);
+        block.rawLength = readU32(entry + 12);
+        block.hash = readU64(entry + 16);
+        // rawLength sizes the decode buffers: bound it before anything trusts it
+        if (block.payloadOffset < payloadStart || block.payloadOffset + block.payloadLength > info.indexOffset
+            || block.rawLength > info.largestBlock) {
+            cerr << "Error: Corrupt archive index" << endl;
+            return false;
+        }
+        total += block.rawLength;
+        info.blocks.pushBack(block);
+    }
+    if (total != info.originalSize) {
+        cerr << "Error: Corrupt archive index" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool decompressArchive(const string& inputFile, const string& outputFile, const IoOptions& io) {
+    ExtractOptions options;
+    options.io = io;
+    return decompressArchive(inputFile, outputFile, options);
+}
+
+bool decompressArchive(const string& inputFile, const string& outputFile, const ExtractOptions& options,
+                       ArchiveStats* stats) {
+    return decompressArchive(ArchiveEndpoint::file(inputFile), ArchiveEndpoint::file(outputFile), options, stats);
+}
+
+bool decompressArchive(const ArchiveEndpoint& source, const ArchiveEndpoint& sink, const ExtractOptions& options,
+                       ArchiveStats* stats) {
+    // Payloads are read by offset (references can point backwards); output is sequential
+    unique_ptr<RandomAccessReader> in = openSourceAt(source);
+    if (!in) {
+        cerr << "Error: Cannot open archive " << describe(source) << endl;
+        return false;
+    }
+    ArchiveInfo info;
+    if (!readArchiveInfo(*in, info)) {
+        return false;
+    }
+
+    // One payload and one decoded block at a time, plus the index, the decoder's scratch and the I/O buffers
+    size_t largestBlock = 0;
+    for (size_t i = 0; i < info.blocks.getSize(); i++) {
+        size_t need = (size_t)info.blocks[i].payloadLength + info.blocks[i].rawLength;
+        if (need > largestBlock) largestBlock = need;
+    }
+    size_t fixedBytes = largestBlock + info.blocks.getCapacity() * sizeof(ArchiveBlock)
+                        + info.sharedTable.size() + encodeScratchBytes;
+    IoOptions io = options.io;
+    if (options.memoryLimit > 0) {
+        while (fixedBytes + ioBufferBytes(io) > options.memoryLimit) {
+            if (!shrinkIoBuffers(io)) {
+                cerr << "Error: Memory limit of " << options.memoryLimit << " bytes is too small" << endl;
+                return false;
+            }
+        }
+    }
+
+    unique_ptr<SequentialWriter> out = openSink(sink, io);
+    if (!out) {
+        cerr << "Error: Cannot create output file" << endl;
+        return false;
+    }
+
+    MemoryBudget budget(options.memoryLimit);
+    budget.charge(ioBufferBytes(io) + encodeScratchBytes);
+    budget.charge(info.blocks.getCapacity() * sizeof(ArchiveBlock) + info.sharedTable.size());
+
+    HuffmanTable sharedTable;
+    if (!info.sharedTable.empty()
+        && !sharedTable.load((const unsigned char*)info.sharedTable.data(), info.sharedTable.size())) {
+        cerr << "Error: Corrupt shared table" << endl;
+        return false;
+    }
+
+    unsigned long long originalSize = 0;
+    for (size_t i = 0; i < info.blocks.getSize(); i++) {
+        originalSize += info.blocks[i].rawLength;
+    }
+    JobTracker tracker(options.control, originalSize);
+    size_t bufferStart = sink.kind == ENDPOINT_MEMORY && sink.buffer ? sink.buffer->size() : 0;
+
+    string payload;
+    string decoded;
+    size_t payloadCharged = 0;
+    size_t decodedCharged = 0;
+    unsigned long long written = 0;
+    for (size_t i = 0; i < info.blocks.getSize(); i++) {
+        bool ok = readBlock(*in, info.blocks[i], &sharedTable, payload, decoded);
+        chargeGrowth(&budget, payload.capacity(), payloadCharged);
+        chargeGrowth(&budget, decoded.capacity(), decodedCharged);
+        if (overMemoryLimit(budget)) {
+            out.reset();
+            discardOutput(sink, bufferStart);
+            return false;
+        }
+        // A corrupt block leaves no partial output behind, as with cancellation
+        if (!ok) {
+            out.reset();
+            discardOutput(sink, bufferStart);
+            cerr << "Error: Block " << i << " is corrupt" << endl;
+            return false;
+        }
+        if (!out->write((const unsigned char*)decoded.data(), decoded.size())) {
+            break;
+        }
+        written += decoded.size();
+        if (!tracker.advance(decoded.size())) {
+            out.reset();
+            discardOutput(sink, bufferStart);
+            cerr << "Decompression of " << describe(source) << " cancelled" << endl;
+            return false;
+        }
+    }
+
+    if (!out->finish()) {
+        out.reset();
+        discardOutput(sink, bufferStart);
+        cerr << "Error: Failed writing " << describe(sink) << endl;
+        return false;
+    }
+    tracker.finish();
+    if (stats) {
+        *stats = ArchiveStats();
+        stats->bytesIn = written;
+        stats->bytesOut = written;
+        stats->blockCount = info.blocks.getSize();
+        stats->estimatedPeakMemory = budget.peak();
+        stats->peakResidentMemory = peakResidentBytes();
+    }
+    return true;
+}
+
+bool verifyArchive(const ArchiveEndpoint& source, WorkStealingPool* pool, VerifyStats* stats) {
+    auto begin = chrono::steady_clock::now();
+    unique_ptr<RandomAccessReader> in = openSourceAt(source);
+    if (!in) {
+        cerr << "Error: Cannot open archive " << describe(source) << endl;
+        return false;
+    }
+    ArchiveInfo info;
+    if (!readArchiveInfo(*in, info)) {
+        return false;
+    }
+    HuffmanTable sharedTable;
+    if (!info.sharedTable.empty()
+        && !sharedTable.load((const unsigned char*)info.sharedTable.data(), info.sharedTable.size())) {
+        cerr << "Error: Corrupt shared table" << endl;
+        return false;
+    }
+
+    std::atomic<unsigned long long> corrupt(0);
+    std::atomic<size_t> firstCorrupt(SIZE_MAX);
+    auto markCorrupt = [&](size_t i) {
+        corrupt++;
+        size_t seen = firstCorrupt.load();
+        while (i < seen && !firstCorrupt.compare_exchange_weak(seen, i)) {
+        }
+    };
+
+    // Payloads are written in order, so one that starts before the end of the
+    // last new payload is a dedup reference: it is not decoded again, but its
+    // entry must be an exact copy of the unique entry at that offset
+    DynamicArray<unsigned long long> unique(info.blocks.getSize() + 1);
+    unsigned long long newEnd = 0;
+    unsigned long long payloadBytes = 0;
+    for (size_t i = 0; i < info.blocks.getSize(); i++) {
+        const ArchiveBlock& block = info.blocks[i];
+        if (block.payloadOffset >= newEnd) {
+            unique.pushBack(i);
+            newEnd = block.payloadOffset + block.payloadLength;
+            payloadBytes += block.payloadLength;
+            continue;
+        }
+        // Unique offsets increase, so binary search them
+        size_t low = 0;
+        size_t high = unique.getSize();
+        while (low < high) {
+            size_t middle = low + (high - low) / 2;
+            if (info.blocks[(size_t)unique[middle]].payloadOffset < block.payloadOffset) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        const ArchiveBlock* target = low < unique.getSize() ? &info.blocks[(size_t)unique[low]] : nullptr;
+        if (!target || target->payloadOffset != block.payloadOffset || target->payloadLength != block.payloadLength
+            || target->rawLength != block.rawLength || target->hash != block.hash) {
+            markCorrupt(i);
+        }
+    }
+
+    std::atomic<unsigned long long> decodedBytes(0);
+    auto check = [&](size_t from, size_t to) {
+        string payload;   // reused across the blocks of this range
+        string decoded;
+        for (size_t u = from; u < to; u++) {
+            size_t i = (size_t)unique[u];
+            bool ok = readBlock(*in, info.blocks[i], &sharedTable, payload, decoded);
+            decodedBytes += decoded.size();
+            if (!ok) {
+                markCorrupt(i);
+            }
+        }
+    };
+    if (pool && unique.getSize() > 1) {
+        parallelFor(*pool, 0, unique.getSize(), 4, check);
+    } else {
+        check(0, unique.getSize());
+    }
+
+    if (stats) {
+        *stats = VerifyStats();
+        stats->archiveBytes = in->size();
+        stats->payloadBytesRead = payloadBytes;
+        stats->bytesDecoded = decodedBytes.load();
+        stats->blockCount = info.blocks.getSize();
+        stats->corruptBlocks = corrupt.load();
+        stats->seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+    }
+    if (corrupt.load() > 0) {
+        cerr << "Error: Block " << firstCorrupt.load() << " is corrupt (" << corrupt.load() << " corrupt blocks)"
+             << endl;
+        return false;
+    }
+    return true;
+}
+
+bool verifyArchive(const string& archiveFile, WorkStealingPool* pool, VerifyStats* stats) {
+    return verifyArchive(ArchiveEndpoint::file(archiveFile), pool, stats);
+}
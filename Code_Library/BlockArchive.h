@@ -0,0 +1,211 @@
+#ifndef MILESTONE_2_ADS_BLOCKARCHIVE_H
+#define MILESTONE_2_ADS_BLOCKARCHIVE_H
+
+#include <string>
+#include "DynamicArray.h"
+#include "WorkStealingPool.h"
+#include "IoBackend.h"
+#include "FrequencySampler.h"
+#include "BlockCodec.h"
+#include "MemoryResource.h"
+#include "JobControl.h"
+
+using namespace std;
+
+/*
+  Block archive format
+  The input is cut into blocks (fixed size, or content-defined chunks in
+  dedup mode) and every block is encoded on its own by the block codec.
+  An index at the end records where each block's payload lives and a hash
+  of its original content. In dedup mode a repeated chunk is not encoded
+  again: its index entry simply points at the payload of the first copy.
+  With sampling, one Huffman table estimated from a sample of the input is
+  stored after the header and blocks that it codes well enough use it
+  instead of carrying their own tree.
+
+  Layout:
+    header  (16 bytes): "HZA1" | version | flags | reserved(2) | block size(4) | shared table length(4)
+    shared table (only with ARCHIVE_FLAG_SHARED_TABLE): serialized tree
+    payloads
+    index   (24 bytes per block): payload offset(8) | payload length(4) | raw length(4) | hash(8)
+    trailer (28 bytes): index offset(8) | block count(8) | original size(8) | "HZAI"
+*/
+
+const unsigned int ARCHIVE_FLAG_CONTENT_DEFINED = 1; // blocks are content-defined chunks
+const unsigned int ARCHIVE_FLAG_SHARED_TABLE = 2;    // a shared Huffman table follows the header
+
+struct ArchiveOptions {
+    size_t blockSize = 256 * 1024;  // fixed block size, or average chunk size with dedup
+    bool dedup = false;             // content-defined chunking + store repeated chunks once
+    unsigned int threads = 0;       // encode workers; > 0 runs the reader/encoder/writer pipeline
+    IoOptions io;                   // file I/O backend for reading the input and writing the archive
+    SamplingOptions sampling;       // estimate one shared table from a sample of the input
+    unsigned char tableId = 0;      // preset table for every block (TablePresetId), 0 for none
+    EntropyCoder coder = CODER_HUFFMAN; // entropy coder choice for each block
+    BlockTransform transform = TRANSFORM_NONE; // e.g. TRANSFORM_BWT for text; blocks stay independent
+    unsigned int recordStride = 0;  // TRANSFORM_TRANSPOSE record size, 0 to detect per block
+    size_t memoryLimit = 0;         // hard cap in bytes, 0 for none; shrinks threads, I/O buffers and blocks to fit
+    const JobControl* control = nullptr; // progress per block and cancellation, see JobControl.h
+};
+
+struct ExtractOptions {
+    IoOptions io;                   // file I/O backend for writing the output
+    size_t memoryLimit = 0;         // hard cap in bytes, 0 for none
+    const JobControl* control = nullptr; // progress per block and cancellation, see JobControl.h
+};
+
+enum EndpointKind {
+    ENDPOINT_PATH,
+    ENDPOINT_FD,      // a descriptor the caller keeps; used from its current position, never closed
+    ENDPOINT_MEMORY   // data/length to read, or buffer to append to
+};
+
+/**
+ * Where a job reads its input or writes its output
+ * Dedup and decompression read their input by offset, so they need a path,
+ * a regular-file descriptor or memory rather than a pipe or socket.
+ */
+struct ArchiveEndpoint {
+    EndpointKind kind = ENDPOINT_PATH;
+    string path;
+    int fd = -1;
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+    string* buffer = nullptr;
+
+    static ArchiveEndpoint file(const string& path) {
+        ArchiveEndpoint endpoint;
+        endpoint.path = path;
+        return endpoint;
+    }
+    static ArchiveEndpoint descriptor(int fd) {
+        ArchiveEndpoint endpoint;
+        endpoint.kind = ENDPOINT_FD;
+        endpoint.fd = fd;
+        return endpoint;
+    }
+    static ArchiveEndpoint memory(const unsigned char* data, size_t length) {
+        ArchiveEndpoint endpoint;
+        endpoint.kind = ENDPOINT_MEMORY;
+        endpoint.data = data;
+        endpoint.length = length;
+        return endpoint;
+    }
+    static ArchiveEndpoint memory(string& buffer) {
+        ArchiveEndpoint endpoint;
+        endpoint.kind = ENDPOINT_MEMORY;
+        endpoint.buffer = &buffer;
+        return endpoint;
+    }
+};
+
+struct ArchiveBlock {
+    unsigned long long payloadOffset; // where the encoded block starts in the archive
+    unsigned int payloadLength;       // encoded size
+    unsigned int rawLength;           // original size
+    unsigned long long hash;          // hash64 of the original bytes
+};
+
+struct ArchiveInfo {
+    unsigned int flags = 0;
+    unsigned int blockSize = 0;
+    size_t largestBlock = 0;        // no block's raw length may exceed this (blockSize, or the chunker's maximum)
+    unsigned long long originalSize = 0;
+    unsigned long long indexOffset = 0;
+    string sharedTable;             // serialized shared tree, empty without ARCHIVE_FLAG_SHARED_TABLE
+    DynamicArray<ArchiveBlock> blocks;
+};
+
+struct ArchiveStats {
+    unsigned long long bytesIn = 0;        // original bytes processed
+    unsigned long long bytesOut = 0;       // archive bytes written
+    unsigned long long blockCount = 0;
+    unsigned long long duplicateBlocks = 0; // blocks stored as references
+    unsigned long long copiedBlocks = 0;    // blocks reused unchanged from an older archive
+    unsigned long long sharedTableBlocks = 0; // blocks coded with the shared table
+    // Highest total charged to the job's MemoryBudget: the planner's estimates for
+    // scratch and I/O plus the capacities of the buffers it tracks. Going over
+    // memoryLimit fails the job.
+    size_t estimatedPeakMemory = 0;
+    // Measured resident high-water mark of the process when the job ended (getrusage);
+    // covers every job the process ran, so it is exact only for one job per process
+    size_t peakResidentMemory = 0;
+};
+
+struct VerifyStats {
+    unsigned long long archiveBytes = 0;     // size of the archive
+    unsigned long long payloadBytesRead = 0; // bytes actually read (each stored payload once)
+    unsigned long long bytesDecoded = 0;     // bytes decoded (each stored payload once)
+    unsigned long long blockCount = 0;
+    unsigned long long corruptBlocks = 0;
+    double seconds = 0;
+
+    double megabytesPerSecond() const { return seconds > 0 ? bytesDecoded / seconds / 1e6 : 0; }
+};
+
+/**
+ * Compress a file into a block archive
+ */
+bool compressArchive(const string& inputFile, const string& outputFile,
+                     const ArchiveOptions& options = ArchiveOptions(), ArchiveStats* stats = nullptr);
+
+/**
+ * Compress between any endpoints (files, descriptors, memory).
+ * Sampling needs a path input and is skipped for the others.
+ * A cancelled job returns false and removes its output file or the bytes it
+ * appended to a memory buffer; what went to a descriptor stays.
+ */
+bool compressArchive(const ArchiveEndpoint& source, const ArchiveEndpoint& sink,
+                     const ArchiveOptions& options = ArchiveOptions(), ArchiveStats* stats = nullptr);
+
+/**
+ * Incremental recompression
+ * Cuts the new input the same way as oldArchive and copies the payload of
+ * every old block that decodes to the same bytes (found by hash and length,
+ * then compared); only the blocks that changed are encoded. oldArchive and
+ * outputFile must be different files. Block size, chunking and the shared
+ * table come from oldArchive; options supply memoryLimit, io and the encode
+ * settings for changed blocks (tableId, coder, transform, recordStride),
+ * which the archive does not record, so pass the ones it was written with.
+ */
+bool updateArchive(const string& oldArchive, const string& inputFile, const string& outputFile,
+                   const ArchiveOptions& options = ArchiveOptions(), ArchiveStats* stats = nullptr);
+
+/**
+ * Decompress a block archive, checking every block against its stored hash
+ */
+bool decompressArchive(const string& inputFile, const string& outputFile, const IoOptions& io = IoOptions());
+
+/**
+ * Decompress within options.memoryLimit; fails up front if the largest block cannot fit
+ */
+bool decompressArchive(const string& inputFile, const string& outputFile, const ExtractOptions& options,
+                       ArchiveStats* stats = nullptr);
+bool decompressArchive(const ArchiveEndpoint& source, const ArchiveEndpoint& sink,
+                       const ExtractOptions& options = ExtractOptions(), ArchiveStats* stats = nullptr);
+
+/**
+ * Check an archive without writing anything: every stored payload is read
+ * once, decoded into a scratch buffer and checked against its length and
+ * hash; dedup references must match the entry they point at exactly.
+ * With a pool the blocks are checked on all of its workers.
+ */
+bool verifyArchive(const string& archiveFile, WorkStealingPool* pool = nullptr, VerifyStats* stats = nullptr);
+bool verifyArchive(const ArchiveEndpoint& source, WorkStealingPool* pool = nullptr, VerifyStats* stats = nullptr);
+
+/**
+ * Compress every regular file under inputDir into outputDir, mirroring the
+ * tree and adding ".hza" to each name. One pool task per file, so a few huge
+ * files and many tiny ones still keep every worker busy. options.memoryLimit
+ * covers the whole job: each worker's file gets an equal share of it.
+ */
+bool compressDirectory(const string& inputDir, const string& outputDir, WorkStealingPool& pool,
+                       const ArchiveOptions& options = ArchiveOptions(), ArchiveStats* stats = nullptr);
+
+/**
+ * Read the header, trailer and block index of an archive
+ */
+bool readArchiveInfo(const string& archiveFile, ArchiveInfo& info);
+bool readArchiveInfo(RandomAccessReader& archive, ArchiveInfo& info);
+
+#endif //MILESTONE_2_ADS_BLOCKARCHIVE_H
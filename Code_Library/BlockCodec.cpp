@@ -0,0 +1,510 @@
+#include "BlockCodec.h"
+#include "ByteOrder.h"
+#include "BitIO.h"
+#include "DecodeTable.h"
+#include "FseCoder.h"
+#include "ContextModel.h"
+#include "CpuDispatch.h"
+#include "BurrowsWheeler.h"
+#include "RecordTranspose.h"
+
+/**
+ * Append the code bits of a block, MSB-first (same bit order as BitStream)
+ */
+static void appendCodes(const unsigned char* data, size_t length, const HuffmanTable& table, string& out) {
+    appendPackedCodes(data, length, table.getBits(), table.getLengths(), out);
+}
+
+/**
+ * Huffman-code a block with its own tree
+ */
+static void encodeHuffmanBlock(const unsigned char* data, size_t length,
+                               const unsigned long long counts[256], string& out) {
+    out.push_back((char)BLOCK_HUFFMAN);
+    appendU32(out, (unsigned int)length);
+
+    HuffmanTable table;
+    if (length == 0 || !table.buildFromCounts(counts, false)) {
+        appendU16(out, 0); // empty block: no tree, no bits
+        return;
+    }
+
+    const string& tree = table.getSerialized();
+    appendU16(out, (unsigned int)tree.size());
+    out += tree;
+    appendCodes(data, length, table, out);
+}
+
+// Below this many symbols building the 4096-entry table costs more than it saves
+static const unsigned int multiSymbolMinLength = 8192;
+
+/**
+ * Decode rawLength symbols: multi-symbol table lookups for larger blocks,
+ * a plain tree walk for small ones
+ */
+static bool decodeBits(HuffmanNode* root, const unsigned char* bits, size_t bitLength,
+                       unsigned int rawLength, string& out) {
+    // Every code is at least one bit: a larger claim is corrupt, and must not size the output
+    if (rawLength > (unsigned long long)bitLength * 8) {
+        return false;
+    }
+    size_t start = out.size();
+    out.resize(start + rawLength);
+
+    MemorySpanSource source(bits, bitLength);
+    BitReader<MemorySpanSource> reader(source);
+    MemorySpanSink sink((unsigned char*)&out[start], rawLength);
+    bool ok;
+    if (rawLength >= multiSymbolMinLength) {
+        MultiSymbolTable table(root);
+        ok = decodeSymbolsMulti(table, reader, rawLength, sink);
+    } else {
+        ok = decodeSymbols(root, reader, rawLength, sink);
+    }
+    if (!ok) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Decode a Huffman block with its own tree
+ */
+static bool decodeHuffmanBlock(const unsigned char* payload, size_t payloadLength, string& out) {
+    if (payloadLength < 7) {
+        return false;
+    }
+    unsigned int rawLength = readU32(payload + 1);
+    unsigned int treeLength = readU16(payload + 5);
+    if (rawLength == 0) {
+        return treeLength == 0;
+    }
+    if (treeLength == 0 || 7 + (size_t)treeLength > payloadLength) {
+        return false;
+    }
+
+    HuffmanTable table;
+    if (!table.load(payload + 7, treeLength)) {
+        return false;
+    }
+    return decodeBits(table.getRoot(), payload + 7 + treeLength, payloadLength - 7 - treeLength,
+                      rawLength, out);
+}
+
+/**
+ * Decode a block coded with the container's shared table
+ */
+static bool decodeSharedBlock(const unsigned char* payload, size_t payloadLength, string& out,
+                              const HuffmanTable* sharedTable) {
+    if (payloadLength < 5 || !sharedTable || sharedTable->empty()) {
+        return false;
+    }
+    unsigned int rawLength = readU32(payload + 1);
+    return decodeBits(sharedTable->getRoot(), payload + 5, payloadLength - 5, rawLength, out);
+}
+
+/**
+ * Huffman-code a block with a preset table: no histogram, no tree
+ */
+static void encodePresetBlock(const unsigned char* data, size_t length, unsigned char id,
+                              const HuffmanTable& table, string& out) {
+    out.push_back((char)BLOCK_HUFFMAN_PRESET);
+    out.push_back((char)id);
+    appendU32(out, (unsigned int)length);
+    appendCodes(data, length, table, out);
+}
+
+/**
+ * Decode a block coded with a preset table
+ */
+static bool decodePresetBlock(const unsigned char* payload, size_t payloadLength, string& out) {
+    if (payloadLength < 6) {
+        return false;
+    }
+    const HuffmanTable* table = findPresetTable(payload[1]);
+    if (!table || table->empty()) {
+        return false;
+    }
+    unsigned int rawLength = readU32(payload + 2);
+    return decodeBits(table->getRoot(), payload + 6, payloadLength - 6, rawLength, out);
+}
+
+/**
+ * Store a block as it is
+ */
+static void encodeRawBlock(const unsigned char* data, size_t length, string& out) {
+    out.push_back((char)BLOCK_RAW);
+    appendU32(out, (unsigned int)length);
+    out.append((const char*)data, length);
+}
+
+static bool decodeRawBlock(const unsigned char* payload, size_t payloadLength, string& out) {
+    if (payloadLength < 5 || payloadLength - 5 != readU32(payload + 1)) {
+        return false;
+    }
+    out.append((const char*)payload + 5, payloadLength - 5);
+    return true;
+}
+
+// Bytes of a LEB128 run length
+static size_t varintLength(unsigned long long value) {
+    size_t bytes = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        bytes++;
+    }
+    return bytes;
+}
+
+/**
+ * Size of the RLE payload for a block, counted without writing it
+ */
+static size_t rleSize(const unsigned char* data, size_t length) {
+    size_t size = 5;
+    size_t i = 0;
+    while (i < length) {
+        size_t run = 1;
+        while (i + run < length && data[i + run] == data[i]) run++;
+        size += 1 + varintLength(run);
+        i += run;
+    }
+    return size;
+}
+
+/**
+ * Run-length encode a block as (byte, LEB128 run length) pairs
+ */
+static void encodeRleBlock(const unsigned char* data, size_t length, string& out) {
+    out.push_back((char)BLOCK_RLE);
+    appendU32(out, (unsigned int)length);
+    size_t i = 0;
+    while (i < length) {
+        size_t run = 1;
+        while (i + run < length && data[i + run] == data[i]) run++;
+        out.push_back((char)data[i]);
+        unsigned long long value = run;
+        while (value >= 0x80) {
+            out.push_back((char)((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char)value);
+        i += run;
+    }
+}
+
+static bool decodeRleBlock(const unsigned char* payload, size_t payloadLength, string& out) {
+    if (payloadLength < 5) {
+        return false;
+    }
+    unsigned int rawLength = readU32(payload + 1);
+    size_t start = out.size();
+    size_t position = 5;
+    unsigned long long written = 0;
+    while (position < payloadLength) {
+        unsigned char value = payload[position++];
+        unsigned long long run = 0;
+        int shift = 0;
+        while (true) {
+            if (position >= payloadLength || shift > 28) {
+                out.resize(start);
+                return false;
+            }
+            unsigned char byte = payload[position++];
+            run |= (unsigned long long)(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) break;
+        }
+        if (run == 0 || written + run > rawLength) {
+            out.resize(start);
+            return false;
+        }
+        out.append((size_t)run, (char)value);
+        written += run;
+    }
+    if (written != rawLength) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * BWT, move-to-front and zero-run code a block; symbols gets the stream
+ * that the Huffman stage codes, counts its histogram
+ */
+static unsigned int bwtSymbols(const unsigned char* data, size_t length, string& symbols,
+                               unsigned long long counts[256]) {
+    unsigned char* transformed = new unsigned char[length];
+    unsigned int primary = bwtEncode(data, length, transformed);
+    symbols.clear();
+    symbols.reserve(length / 2);
+    mtfZeroRunEncode(transformed, length, symbols);
+    delete[] transformed;
+    countBytes((const unsigned char*)symbols.data(), symbols.size(), counts);
+    return primary;
+}
+
+static void encodeBwtBlock(size_t length, unsigned int primary, const string& symbols,
+                           const unsigned long long counts[256], string& out) {
+    out.push_back((char)BLOCK_BWT);
+    appendU32(out, (unsigned int)length);
+    appendU32(out, primary);
+    appendU32(out, (unsigned int)symbols.size());
+
+    HuffmanTable table;
+    table.buildFromCounts(counts, false);
+    const string& tree = table.getSerialized();
+    appendU16(out, (unsigned int)tree.size());
+    out += tree;
+    appendCodes((const unsigned char*)symbols.data(), symbols.size(), table, out);
+}
+
+static bool decodeBwtBlock(const unsigned char* payload, size_t payloadLength, string& out) {
+    if (payloadLength < 15) {
+        return false;
+    }
+    unsigned int rawLength = readU32(payload + 1);
+    unsigned int primary = readU32(payload + 5);
+    unsigned int symbolCount = readU32(payload + 9);
+    unsigned int treeLength = readU16(payload + 13);
+    // Every symbol stands for at least one byte; an escape is two symbols for one byte
+    if (rawLength == 0 || rawLength > bwtMaxLength || symbolCount == 0 || symbolCount > 2 * (size_t)rawLength
+        || treeLength == 0 || 15 + (size_t)treeLength > payloadLength) {
+        return false;
+    }
+
+    HuffmanTable table;
+    if (!table.load(payload + 15, treeLength)) {
+        return false;
+    }
+    string symbols;
+    if (!decodeBits(table.getRoot(), payload + 15 + treeLength, payloadLength - 15 - treeLength, symbolCount,
+                    symbols)) {
+        return false;
+    }
+
+    unsigned char* transformed = new unsigned char[rawLength];
+    size_t start = out.size();
+    out.resize(start + rawLength);
+    bool ok = mtfZeroRunDecode((const unsigned char*)symbols.data(), symbols.size(), rawLength, transformed)
+              && bwtDecode(transformed, rawLength, primary, (unsigned char*)&out[start]);
+    delete[] transformed;
+    if (!ok) {
+        out.resize(start);
+    }
+    return ok;
+}
+
+size_t transformScratchBytes(BlockTransform transform, size_t length) {
+    if (transform == TRANSFORM_TRANSPOSE) return length + 64 * 1024; // one lane plus its codes
+    if (transform != TRANSFORM_BWT || length > bwtMaxLength) return 0;
+    // Suffix array and shifted text (4 + 4 bytes), transformed block, symbol stream
+    return 10 * length + 64 * 1024;
+}
+
+// CODER_AUTO only tries the order-1 model from this size on (its header is ~300+ bytes)
+static const size_t order1MinLength = 16 * 1024;
+
+// Blocks at least this big get a quick sampled entropy check first
+static const size_t quickCheckSize = 64 * 1024;
+
+/**
+ * Cheap test for compressed or random data: histogram of a few windows
+ * spread over the block. Near 8 bits per byte means Huffman cannot win.
+ */
+static bool looksIncompressible(const unsigned char* data, size_t length) {
+    const size_t windows = 16;
+    const size_t window = 1024;
+    unsigned long long counts[256] = {0};
+    size_t stride = length / windows;
+    for (size_t w = 0; w < windows; w++) {
+        const unsigned char* piece = data + w * stride;
+        for (size_t i = 0; i < window; i++) {
+            counts[piece[i]]++;
+        }
+    }
+    return entropyBits(counts) / (windows * window) > 7.9;
+}
+
+/**
+ * Lower bound for a block with its own tree: header, tree and entropy
+ */
+static double ownTreeEstimate(const unsigned long long counts[256]) {
+    int distinct = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) distinct++;
+    }
+    double treeBytes = (distinct * 10 - 1 + 7) / 8;
+    double symbols = 0;
+    for (int i = 0; i < 256; i++) {
+        symbols += (double)counts[i];
+    }
+    // A Huffman code never spends less than one bit per symbol
+    double bits = entropyBits(counts);
+    return 7 + treeBytes + (bits > symbols ? bits : symbols) / 8;
+}
+
+/**
+ * Built-in preset that beats bestBytes by the most, or TABLE_NONE.
+ * bestBytes is lowered to the size of the chosen preset.
+ */
+static unsigned char bestPreset(const unsigned long long counts[256], double& bestBytes) {
+    unsigned char best = TABLE_NONE;
+    for (unsigned char id = TABLE_ENGLISH_TEXT; id <= TABLE_BINARY; id++) {
+        double bytes = 6 + (double)((findPresetTable(id)->encodedBits(counts) + 7) / 8);
+        if (bytes < bestBytes) {
+            best = id;
+            bestBytes = bytes;
+        }
+    }
+    return best;
+}
+
+/**
+ * Guard for shared tables: the shared code must cover the block and stay
+ * within tolerance of what the block's own tree would cost. The estimate
+ * is a lower bound for the own tree, so the check never favours the shared table.
+ */
+static bool sharedTableFits(const HuffmanTable& shared, const unsigned long long counts[256], double tolerance) {
+    if (shared.empty() || !shared.covers(counts)) {
+        return false;
+    }
+    double sharedBytes = 5 + (double)((shared.encodedBits(counts) + 7) / 8);
+    return sharedBytes <= ownTreeEstimate(counts) * (1 + tolerance);
+}
+
+void encodeBlock(const unsigned char* data, size_t length, string& out, const BlockEncodeOptions& options) {
+    size_t start = out.size();
+    if (length > 0 && options.presetId != TABLE_NONE && options.presetId != TABLE_AUTO
+        && findPresetTable(options.presetId)) {
+        encodePresetBlock(data, length, options.presetId, *findPresetTable(options.presetId), out);
+    } else if (length >= quickCheckSize && looksIncompressible(data, length)) {
+        encodeRawBlock(data, length, out); // compressed media: pass through untouched
+        return;
+    } else if (length == 0) {
+        encodeHuffmanBlock(data, length, nullptr, out);
+        return;
+    } else {
+        // Classify from the histogram: estimated sizes decide the mode
+        unsigned long long counts[256];
+        countBytes(data, length, counts);
+        double huffmanBytes = ownTreeEstimate(counts);
+        unsigned char preset = TABLE_NONE;
+        if (options.presetId == TABLE_AUTO) {
+            preset = bestPreset(counts, huffmanBytes);
+        }
+        double entropyBytes = huffmanBytes;
+        bool useFse = false;
+        if (options.coder == CODER_FSE || (options.coder == CODER_AUTO && preset == TABLE_NONE)) {
+            double fseBytes = 5 + fseEstimateBytes(counts);
+            if (options.coder == CODER_FSE || fseBytes < huffmanBytes) {
+                useFse = true;
+                entropyBytes = fseBytes;
+            }
+        }
+        ContextClusters* clusters = nullptr;
+        if (options.coder == CODER_ORDER1 || (options.coder == CODER_AUTO && length >= order1MinLength)) {
+            clusters = new ContextClusters();
+            clusterContexts(data, length, *clusters);
+            double order1Bytes = 5 + order1EstimateBytes(*clusters);
+            if (options.coder == CODER_ORDER1 || order1Bytes < entropyBytes) {
+                useFse = false;
+                entropyBytes = order1Bytes;
+            } else {
+                delete clusters;
+                clusters = nullptr;
+            }
+        }
+        double rawBytes = 5 + (double)length;
+        double runBytes = (double)rleSize(data, length);
+
+        string bwtStream;
+        unsigned long long bwtCounts[256];
+        unsigned int primary = 0;
+        unsigned int stride = 1;
+        double transformBytes = -1;
+        if (options.transform == TRANSFORM_BWT && length <= bwtMaxLength) {
+            primary = bwtSymbols(data, length, bwtStream, bwtCounts);
+            transformBytes = 8 + ownTreeEstimate(bwtCounts);
+        } else if (options.transform == TRANSFORM_TRANSPOSE) {
+            stride = options.recordStride > 0 ? options.recordStride : detectRecordStride(data, length);
+            if (stride > 1 && stride <= maxRecordStride) {
+                transformBytes = 5 + transposeEstimateBytes(data, length, stride);
+            }
+        }
+        bool useTransform = transformBytes >= 0 && transformBytes < entropyBytes && transformBytes < runBytes
+                            && transformBytes < rawBytes;
+
+        if (useTransform && options.transform == TRANSFORM_BWT) {
+            encodeBwtBlock(length, primary, bwtStream, bwtCounts, out);
+        } else if (useTransform) {
+            out.push_back((char)BLOCK_TRANSPOSED);
+            appendU32(out, (unsigned int)length);
+            transposeEncode(data, length, stride, out);
+        } else if (runBytes < entropyBytes && runBytes < rawBytes) {
+            encodeRleBlock(data, length, out);
+        } else if (rawBytes <= entropyBytes) {
+            encodeRawBlock(data, length, out);
+        } else if (clusters) {
+            out.push_back((char)BLOCK_HUFFMAN_ORDER1);
+            appendU32(out, (unsigned int)length);
+            order1Encode(data, length, *clusters, out);
+        } else if (useFse) {
+            out.push_back((char)BLOCK_FSE);
+            appendU32(out, (unsigned int)length);
+            fseEncode(data, length, counts, out);
+        } else if (preset != TABLE_NONE) {
+            encodePresetBlock(data, length, preset, *findPresetTable(preset), out);
+        } else if (options.sharedTable && sharedTableFits(*options.sharedTable, counts, options.sharedTolerance)) {
+            out.push_back((char)BLOCK_HUFFMAN_SHARED);
+            appendU32(out, (unsigned int)length);
+            appendCodes(data, length, *options.sharedTable, out);
+        } else {
+            encodeHuffmanBlock(data, length, counts, out);
+        }
+        delete clusters;
+    }
+
+    // The estimates are lower bounds; never let a block grow past raw size
+    if (out.size() - start > 5 + length) {
+        out.resize(start);
+        encodeRawBlock(data, length, out);
+    }
+}
+
+bool decodeBlock(const unsigned char* payload, size_t payloadLength, string& out, const HuffmanTable* sharedTable,
+                 size_t maxRawLength) {
+    if (payloadLength == 0) {
+        return false;
+    }
+    // Every mode stores the raw length up front (after the table ID for presets)
+    size_t lengthAt = payload[0] == BLOCK_HUFFMAN_PRESET ? 2 : 1;
+    if (payloadLength < lengthAt + 4 || readU32(payload + lengthAt) > maxRawLength) {
+        return false;
+    }
+
+    switch (payload[0]) {
+    case BLOCK_HUFFMAN:
+        return decodeHuffmanBlock(payload, payloadLength, out);
+    case BLOCK_HUFFMAN_SHARED:
+        return decodeSharedBlock(payload, payloadLength, out, sharedTable);
+    case BLOCK_HUFFMAN_PRESET:
+        return decodePresetBlock(payload, payloadLength, out);
+    case BLOCK_RAW:
+        return decodeRawBlock(payload, payloadLength, out);
+    case BLOCK_RLE:
+        return decodeRleBlock(payload, payloadLength, out);
+    case BLOCK_FSE:
+        return payloadLength >= 5
+               && fseDecode(payload + 5, payloadLength - 5, readU32(payload + 1), maxRawLength, out);
+    case BLOCK_HUFFMAN_ORDER1:
+        return payloadLength >= 5 && order1Decode(payload + 5, payloadLength - 5, readU32(payload + 1), out);
+    case BLOCK_BWT:
+        return decodeBwtBlock(payload, payloadLength, out);
+    case BLOCK_TRANSPOSED:
+        return payloadLength >= 5 && transposeDecode(payload + 5, payloadLength - 5, readU32(payload + 1), out);
+    default:
+        return false;
+    }
+}
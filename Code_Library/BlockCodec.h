@@ -0,0 +1,94 @@
+#ifndef MILESTONE_2_ADS_BLOCKCODEC_H
+#define MILESTONE_2_ADS_BLOCKCODEC_H
+
+#include <cstddef>
+#include <string>
+#include "HuffmanTable.h"
+#include "TablePreset.h"
+
+using namespace std;
+
+/*
+  Block codec
+  Encodes one in-memory block into a self-contained payload, so blocks can be
+  stored, copied, skipped or decoded independently of each other.
+
+  Every payload starts with a mode byte. Payload layouts:
+    Huffman:        [mode][raw length: 4 bytes][tree length: 2 bytes][serialized tree][code bits]
+    shared Huffman: [mode][raw length: 4 bytes][code bits]   (tree is stored once by the container)
+    preset Huffman: [mode][table ID][raw length: 4 bytes][code bits]
+    raw:            [mode][raw length: 4 bytes][original bytes]
+    RLE:            [mode][raw length: 4 bytes]([byte][run length: LEB128])...
+    FSE:            [mode][raw length: 4 bytes][tANS stream, see FseCoder.h]
+    order-1:        [mode][raw length: 4 bytes][context groups, trees and bits, see ContextModel.h]
+    BWT:            [mode][raw length: 4 bytes][primary index: 4 bytes][symbol count: 4 bytes]
+                    [tree length: 2 bytes][serialized tree][code bits]   (see BurrowsWheeler.h)
+    transposed:     [mode][raw length: 4 bytes][stride and one tree per lane, see RecordTranspose.h]
+*/
+
+enum BlockMode : unsigned char {
+    BLOCK_HUFFMAN = 0,          // own tree, built from this block's histogram
+    BLOCK_HUFFMAN_SHARED = 1,   // container-wide table, e.g. estimated from a sample
+    BLOCK_HUFFMAN_PRESET = 2,   // predefined table referenced by ID (see TablePreset.h)
+    BLOCK_RAW = 3,              // stored: incompressible data
+    BLOCK_RLE = 4,              // run-length encoded: long single-byte runs
+    BLOCK_FSE = 5,              // tANS entropy coded: fractional bits for skewed data
+    BLOCK_HUFFMAN_ORDER1 = 6,   // one tree per group of previous-byte contexts
+    BLOCK_BWT = 7,              // BWT + move-to-front + zero runs, then Huffman with its own tree
+    BLOCK_TRANSPOSED = 8        // fixed-size records split into byte lanes, one tree per lane
+};
+
+enum EntropyCoder : unsigned char {
+    CODER_HUFFMAN,   // Huffman family only (own, shared or preset table)
+    CODER_FSE,       // tANS for every entropy-coded block
+    CODER_AUTO,      // whichever is estimated smaller per block (order-1 only for larger blocks)
+    CODER_ORDER1     // order-1 context-modeled Huffman for every entropy-coded block
+};
+
+enum BlockTransform : unsigned char {
+    TRANSFORM_NONE,  // code the bytes as they are
+    TRANSFORM_BWT,       // also try the BWT stage; kept when estimated smaller (costs ~10 bytes of scratch per byte)
+    TRANSFORM_TRANSPOSE  // also try record lanes (binary records); kept when estimated smaller
+};
+
+struct BlockEncodeOptions {
+    const HuffmanTable* sharedTable = nullptr; // used when it codes the block well enough
+    double sharedTolerance = 0.05;             // allowed size overshoot versus a block's own tree
+    unsigned char presetId = TABLE_NONE;       // preset to code with, or TABLE_AUTO to pick one
+    EntropyCoder coder = CODER_HUFFMAN;        // entropy coder for blocks that are not raw or RLE
+    BlockTransform transform = TRANSFORM_NONE; // reversible transform tried before entropy coding
+    unsigned int recordStride = 0;             // TRANSFORM_TRANSPOSE: bytes per record, 0 to detect per block
+};
+
+/**
+ * Extra working memory encodeBlock needs for a block of this length
+ */
+size_t transformScratchBytes(BlockTransform transform, size_t length);
+
+/**
+ * Encode a block and append the payload to out
+ * The block is classified from its histogram and stored raw, run-length
+ * encoded or Huffman-coded, whichever is estimated smallest. Large blocks
+ * that look random from a quick sample are stored raw without counting.
+ * A named preset is used directly, without counting the block. With
+ * TABLE_AUTO the smallest of the built-in presets and the block's own tree
+ * wins. With a shared table the block only gets its own tree if the shared
+ * one misses a symbol or would be more than sharedTolerance larger.
+ * With TRANSFORM_BWT the transformed block competes with all of these.
+ */
+void encodeBlock(const unsigned char* data, size_t length, string& out,
+                 const BlockEncodeOptions& options = BlockEncodeOptions());
+
+// Largest block the codec is used for (an archive's blocks and chunks stay within it)
+const size_t maxBlockLength = 16 * 1024 * 1024;
+
+/**
+ * Decode a payload and append the original bytes to out
+ * Returns false if the payload is corrupt, uses an unknown mode, needs a
+ * shared table that was not given, or claims more than maxRawLength bytes
+ * (checked before any output is allocated)
+ */
+bool decodeBlock(const unsigned char* payload, size_t payloadLength, string& out,
+                 const HuffmanTable* sharedTable = nullptr, size_t maxRawLength = maxBlockLength);
+
+#endif //MILESTONE_2_ADS_BLOCKCODEC_H
@@ -0,0 +1,317 @@
+#include "BurrowsWheeler.h"
+
+// ------------------------------------------------------------------ SA-IS
+
+/**
+ * Start (or one past the end) of each character's bucket in the suffix array
+ */
+static void bucketBounds(const int* text, int n, int alphabet, int* buckets, bool ends) {
+    for (int c = 0; c < alphabet; c++) {
+        buckets[c] = 0;
+    }
+    for (int i = 0; i < n; i++) {
+        buckets[text[i]]++;
+    }
+    int sum = 0;
+    for (int c = 0; c < alphabet; c++) {
+        sum += buckets[c];
+        buckets[c] = ends ? sum : sum - buckets[c];
+    }
+}
+
+// S-type: suffix smaller than the next one; LMS: S-type right after an L-type
+static inline bool isLms(const unsigned char* sType, int i) {
+    return i > 0 && sType[i] && !sType[i - 1];
+}
+
+/**
+ * From the placed LMS suffixes, induce the L-type suffixes left to right,
+ * then the S-type suffixes right to left
+ */
+static void induceSort(const int* text, const unsigned char* sType, int* suffixes, int n, int alphabet,
+                       int* buckets) {
+    bucketBounds(text, n, alphabet, buckets, false);
+    for (int i = 0; i < n; i++) {
+        int j = suffixes[i] - 1;
+        if (suffixes[i] > 0 && !sType[j]) suffixes[buckets[text[j]]++] = j;
+    }
+    bucketBounds(text, n, alphabet, buckets, true);
+    for (int i = n - 1; i >= 0; i--) {
+        int j = suffixes[i] - 1;
+        if (suffixes[i] > 0 && sType[j]) suffixes[--buckets[text[j]]] = j;
+    }
+}
+
+/**
+ * SA-IS over text[0..n), whose last character is a unique smallest sentinel
+ */
+static void suffixArrayIs(const int* text, int* suffixes, int n, int alphabet) {
+    unsigned char* sType = new unsigned char[n];
+    sType[n - 1] = 1;
+    for (int i = n - 2; i >= 0; i--) {
+        sType[i] = text[i] < text[i + 1] || (text[i] == text[i + 1] && sType[i + 1]);
+    }
+
+    // Step 1: sort the LMS substrings by placing LMS positions at bucket ends and inducing
+    int* buckets = new int[alphabet];
+    bucketBounds(text, n, alphabet, buckets, true);
+    for (int i = 0; i < n; i++) {
+        suffixes[i] = -1;
+    }
+    for (int i = 1; i < n; i++) {
+        if (isLms(sType, i)) suffixes[--buckets[text[i]]] = i;
+    }
+    induceSort(text, sType, suffixes, n, alphabet, buckets);
+
+    // Compact the sorted LMS positions into the front
+    int lmsCount = 0;
+    for (int i = 0; i < n; i++) {
+        if (isLms(sType, suffixes[i])) suffixes[lmsCount++] = suffixes[i];
+    }
+
+    // Name the LMS substrings; equal substrings share a name
+    for (int i = lmsCount; i < n; i++) {
+        suffixes[i] = -1;
+    }
+    int names = 0;
+    int previous = -1;
+    for (int i = 0; i < lmsCount; i++) {
+        int position = suffixes[i];
+        bool different = false;
+        for (int d = 0; d < n; d++) {
+            if (previous == -1 || text[position + d] != text[previous + d]
+                || sType[position + d] != sType[previous + d]) {
+                different = true;
+                break;
+            }
+            if (d > 0 && (isLms(sType, position + d) || isLms(sType, previous + d))) break;
+        }
+        if (different) {
+            names++;
+            previous = position;
+        }
+        suffixes[lmsCount + position / 2] = names - 1; // LMS positions are at least 2 apart
+    }
+    for (int i = n - 1, j = n - 1; i >= lmsCount; i--) {
+        if (suffixes[i] >= 0) suffixes[j--] = suffixes[i];
+    }
+
+    // Step 2: sort the reduced string, recursing only if names repeat
+    int* reduced = suffixes + n - lmsCount;
+    if (names < lmsCount) {
+        suffixArrayIs(reduced, suffixes, lmsCount, names);
+    } else {
+        for (int i = 0; i < lmsCount; i++) {
+            suffixes[reduced[i]] = i;
+        }
+    }
+
+    // Step 3: place the LMS suffixes in their final order and induce everything else
+    bucketBounds(text, n, alphabet, buckets, true);
+    for (int i = 1, j = 0; i < n; i++) {
+        if (isLms(sType, i)) reduced[j++] = i;
+    }
+    for (int i = 0; i < lmsCount; i++) {
+        suffixes[i] = reduced[suffixes[i]];
+    }
+    for (int i = lmsCount; i < n; i++) {
+        suffixes[i] = -1;
+    }
+    for (int i = lmsCount - 1; i >= 0; i--) {
+        int j = suffixes[i];
+        suffixes[i] = -1;
+        suffixes[--buckets[text[j]]] = j;
+    }
+    induceSort(text, sType, suffixes, n, alphabet, buckets);
+
+    delete[] buckets;
+    delete[] sType;
+}
+
+void buildSuffixArray(const unsigned char* data, size_t length, int* suffixes) {
+    // Shift bytes up by one so 0 is free for the sentinel
+    int n = (int)length + 1;
+    int* text = new int[n];
+    for (size_t i = 0; i < length; i++) {
+        text[i] = data[i] + 1;
+    }
+    text[length] = 0;
+    if (n == 1) {
+        suffixes[0] = 0;
+    } else {
+        suffixArrayIs(text, suffixes, n, 257);
+    }
+    delete[] text;
+}
+
+// -------------------------------------------------------------------- BWT
+
+unsigned int bwtEncode(const unsigned char* data, size_t length, unsigned char* out) {
+    if (length == 0) {
+        return 0;
+    }
+    int* suffixes = new int[length + 1];
+    buildSuffixArray(data, length, suffixes);
+
+    // Row i ends with the byte before suffix i; the row of suffix 0 ends with the marker and is skipped
+    unsigned int primary = 0;
+    size_t used = 0;
+    for (size_t i = 0; i <= length; i++) {
+        if (suffixes[i] == 0) {
+            primary = (unsigned int)i;
+        } else {
+            out[used++] = data[suffixes[i] - 1];
+        }
+    }
+    delete[] suffixes;
+    return primary;
+}
+
+bool bwtDecode(const unsigned char* data, size_t length, unsigned int primary, unsigned char* out) {
+    if (length == 0) {
+        return primary == 0;
+    }
+    // Row 0 is the marker suffix, so the marker itself is never in row 0
+    if (primary == 0 || primary > length) {
+        return false;
+    }
+
+    // First row of each byte in the sorted first column; the marker takes row 0
+    size_t first[256];
+    size_t counts[256] = {0};
+    for (size_t i = 0; i < length; i++) {
+        counts[data[i]]++;
+    }
+    size_t sum = 1;
+    for (int c = 0; c < 256; c++) {
+        first[c] = sum;
+        sum += counts[c];
+    }
+
+    // LF mapping: the row that starts with the last byte of row i
+    unsigned int* previousRow = new unsigned int[length + 1];
+    previousRow[primary] = 0;
+    for (size_t row = 0; row <= length; row++) {
+        if (row == primary) continue;
+        unsigned char c = data[row < primary ? row : row - 1];
+        previousRow[row] = (unsigned int)first[c]++;
+    }
+
+    // Walk backwards from the marker's suffix, emitting the text from its end
+    size_t row = 0;
+    bool ok = true;
+    for (size_t k = length; k-- > 0;) {
+        if (row == primary) {
+            ok = false; // reached the start too early: corrupt
+            break;
+        }
+        out[k] = data[row < primary ? row : row - 1];
+        row = previousRow[row];
+    }
+    delete[] previousRow;
+    return ok && row == primary;
+}
+
+// ------------------------------------------------------ move-to-front / runs
+
+static const unsigned char runA = 0;
+static const unsigned char runB = 1;
+static const unsigned char escape = 255;
+
+/**
+ * Write a zero run of length run >= 1 in bijective base 2
+ */
+static void appendZeroRun(size_t run, string& out) {
+    while (run > 0) {
+        if (run & 1) {
+            out.push_back((char)runA);
+            run = (run - 1) / 2;
+        } else {
+            out.push_back((char)runB);
+            run = (run - 2) / 2;
+        }
+    }
+}
+
+void mtfZeroRunEncode(const unsigned char* data, size_t length, string& out) {
+    unsigned char order[256];
+    for (int i = 0; i < 256; i++) {
+        order[i] = (unsigned char)i;
+    }
+
+    size_t zeros = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char byte = data[i];
+        if (order[0] == byte) {
+            zeros++;
+            continue;
+        }
+        if (zeros > 0) {
+            appendZeroRun(zeros, out);
+            zeros = 0;
+        }
+
+        int rank = 1;
+        while (order[rank] != byte) rank++;
+        for (int j = rank; j > 0; j--) {
+            order[j] = order[j - 1];
+        }
+        order[0] = byte;
+
+        if (rank < 254) {
+            out.push_back((char)(rank + 1));
+        } else {
+            out.push_back((char)escape);
+            out.push_back((char)(rank - 254));
+        }
+    }
+    if (zeros > 0) {
+        appendZeroRun(zeros, out);
+    }
+}
+
+bool mtfZeroRunDecode(const unsigned char* stream, size_t streamLength, size_t rawLength, unsigned char* out) {
+    unsigned char order[256];
+    for (int i = 0; i < 256; i++) {
+        order[i] = (unsigned char)i;
+    }
+
+    size_t written = 0;
+    size_t position = 0;
+    while (position < streamLength) {
+        unsigned char symbol = stream[position++];
+        if (symbol == runA || symbol == runB) {
+            // Collect the whole run
+            size_t run = 0;
+            size_t weight = 1;
+            position--;
+            while (position < streamLength && (stream[position] == runA || stream[position] == runB)) {
+                run += weight * (stream[position] == runA ? 1 : 2);
+                if (run > rawLength - written) return false;
+                weight *= 2;
+                position++;
+            }
+            for (size_t i = 0; i < run; i++) {
+                out[written++] = order[0];
+            }
+            continue;
+        }
+
+        int rank;
+        if (symbol == escape) {
+            if (position == streamLength || stream[position] > 1) return false;
+            rank = 254 + stream[position++];
+        } else {
+            rank = symbol - 1;
+        }
+        if (written == rawLength) return false;
+
+        unsigned char byte = order[rank];
+        for (int j = rank; j > 0; j--) {
+            order[j] = order[j - 1];
+        }
+        order[0] = byte;
+        out[written++] = byte;
+    }
+    return written == rawLength;
+}
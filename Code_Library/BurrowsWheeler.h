@@ -0,0 +1,56 @@
+#ifndef MILESTONE_2_ADS_BURROWSWHEELER_H
+#define MILESTONE_2_ADS_BURROWSWHEELER_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/*
+  Burrows-Wheeler transform stage
+  The BWT sorts all rotations of a block so bytes that precede similar
+  contexts end up next to each other. Move-to-front then turns that
+  locality into many small values, mostly zeros, and zero-run coding folds
+  the zero runs into a few symbols, leaving a skewed histogram for the
+  block's own Huffman tree. Each block is transformed on its own.
+
+  The suffix array is built with SA-IS (induced sorting, linear time).
+  The text gets a virtual end marker that sorts first; the marker's row is
+  left out of the output and its position is stored as the primary index.
+
+  Zero-run stream symbols:
+    0, 1     RUNA / RUNB: digits of a zero-run length in bijective base 2, least significant first
+    2..254   move-to-front values 1..253
+    255 b    move-to-front value 254 + b (b is 0 or 1)
+*/
+
+// Blocks longer than this are not transformed (int suffix indices, ~10 bytes of scratch per byte)
+const size_t bwtMaxLength = 64 * 1024 * 1024;
+
+/**
+ * Suffix array of data plus its end marker: suffixes gets length + 1
+ * entries and suffixes[0] == length (the marker alone)
+ */
+void buildSuffixArray(const unsigned char* data, size_t length, int* suffixes);
+
+/**
+ * Transform length bytes into out (length bytes); returns the primary index
+ */
+unsigned int bwtEncode(const unsigned char* data, size_t length, unsigned char* out);
+
+/**
+ * Invert bwtEncode; false if the primary index or the data is inconsistent
+ */
+bool bwtDecode(const unsigned char* data, size_t length, unsigned int primary, unsigned char* out);
+
+/**
+ * Move-to-front and zero-run code length bytes, appending the symbols to out
+ */
+void mtfZeroRunEncode(const unsigned char* data, size_t length, string& out);
+
+/**
+ * Undo mtfZeroRunEncode into exactly rawLength bytes; false if the stream is corrupt
+ */
+bool mtfZeroRunDecode(const unsigned char* stream, size_t streamLength, size_t rawLength, unsigned char* out);
+
+#endif //MILESTONE_2_ADS_BURROWSWHEELER_H
@@ -0,0 +1,44 @@
+#ifndef MILESTONE_2_ADS_BYTEORDER_H
+#define MILESTONE_2_ADS_BYTEORDER_H
+
+#include <string>
+
+/*
+  Big-endian integer helpers for the binary formats.
+  Same byte order as the 4-byte size header written by compressFile.
+*/
+
+inline void appendU16(std::string& out, unsigned int value) {
+    out.push_back((char)((value >> 8) & 0xFF));
+    out.push_back((char)(value & 0xFF));
+}
+
+inline void appendU32(std::string& out, unsigned int value) {
+    for (int i = 3; i >= 0; i--) {
+        out.push_back((char)((value >> (i * 8)) & 0xFF));
+    }
+}
+
+inline void appendU64(std::string& out, unsigned long long value) {
+    for (int i = 7; i >= 0; i--) {
+        out.push_back((char)((value >> (i * 8)) & 0xFF));
+    }
+}
+
+inline unsigned int readU16(const unsigned char* p) {
+    return ((unsigned int)p[0] << 8) | p[1];
+}
+
+inline unsigned int readU32(const unsigned char* p) {
+    return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+}
+
+inline unsigned long long readU64(const unsigned char* p) {
+    unsigned long long value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+#endif //MILESTONE_2_ADS_BYTEORDER_H
@@ -0,0 +1,154 @@
+#include "Checksum.h"
+#include "CpuDispatch.h"
+#ifdef HUFFZIP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// XXH64 primes
+static const unsigned long long prime1 = 0x9E3779B185EBCA87ULL;
+static const unsigned long long prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const unsigned long long prime3 = 0x165667B19E3779F9ULL;
+static const unsigned long long prime4 = 0x85EBCA77C2B2AE63ULL;
+static const unsigned long long prime5 = 0x27D4EB2F165667C5ULL;
+
+static inline unsigned long long rotateLeft(unsigned long long x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian loads so the hash is the same on every host
+static inline unsigned long long load64(const unsigned char* p) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    unsigned long long v;
+    __builtin_memcpy(&v, p, 8); // one load instead of eight
+    return v;
+#else
+    unsigned long long v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+#endif
+}
+
+static inline unsigned int load32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static inline unsigned long long round64(unsigned long long acc, unsigned long long input) {
+    acc += input * prime2;
+    acc = rotateLeft(acc, 31);
+    return acc * prime1;
+}
+
+static inline unsigned long long mergeRound(unsigned long long acc, unsigned long long val) {
+    acc ^= round64(0, val);
+    return acc * prime1 + prime4;
+}
+
+unsigned long long hash64(const unsigned char* data, size_t length, unsigned long long seed) {
+    return codecKernels().hash64(data, length, seed);
+}
+
+/**
+ * Combine the four stripe lanes
+ */
+static inline unsigned long long mergeLanes(unsigned long long v1, unsigned long long v2, unsigned long long v3,
+                                            unsigned long long v4) {
+    unsigned long long h = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+    h = mergeRound(h, v1);
+    h = mergeRound(h, v2);
+    h = mergeRound(h, v3);
+    return mergeRound(h, v4);
+}
+
+/**
+ * Length, the bytes after the last full stripe, and the final avalanche
+ */
+static unsigned long long finishHash(unsigned long long h, const unsigned char* p, const unsigned char* end,
+                                     size_t length) {
+    h += (unsigned long long)length;
+
+    // Tail: 8, then 4, then 1 byte at a time
+    while (p + 8 <= end) {
+        h ^= round64(0, load64(p));
+        h = rotateLeft(h, 27) * prime1 + prime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (unsigned long long)load32(p) * prime1;
+        h = rotateLeft(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * prime5;
+        h = rotateLeft(h, 11) * prime1;
+        p++;
+    }
+
+    // Final avalanche
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+unsigned long long hash64Scalar(const unsigned char* data, size_t length, unsigned long long seed) {
+    const unsigned char* p = data;
+    const unsigned char* end = data + length;
+    unsigned long long h;
+
+    // Four independent lanes over 32-byte stripes
+    if (length >= 32) {
+        unsigned long long v1 = seed + prime1 + prime2;
+        unsigned long long v2 = seed + prime2;
+        unsigned long long v3 = seed;
+        unsigned long long v4 = seed - prime1;
+
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = round64(v1, load64(p));
+            v2 = round64(v2, load64(p + 8));
+            v3 = round64(v3, load64(p + 16));
+            v4 = round64(v4, load64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = mergeLanes(v1, v2, v3, v4);
+    } else {
+        h = seed + prime5;
+    }
+    return finishHash(h, p, end, length);
+}
+
+#ifdef HUFFZIP_X86_KERNELS
+/**
+ * The four lanes of a stripe are the four 64-bit lanes of one AVX register;
+ * AVX-512 DQ/VL add the 64-bit multiply and rotate AVX2 lacks
+ */
+__attribute__((target("avx512f,avx512vl,avx512dq")))
+unsigned long long hash64Avx512(const unsigned char* data, size_t length, unsigned long long seed) {
+    if (length < 32) {
+        return hash64Scalar(data, length, seed);
+    }
+    const unsigned char* p = data;
+    const unsigned char* end = data + length;
+    __m256i lanes = _mm256_set_epi64x((long long)(seed - prime1), (long long)seed, (long long)(seed + prime2),
+                                      (long long)(seed + prime1 + prime2));
+    const __m256i multiplier1 = _mm256_set1_epi64x((long long)prime1);
+    const __m256i multiplier2 = _mm256_set1_epi64x((long long)prime2);
+
+    const unsigned char* limit = end - 32;
+    do {
+        __m256i input = _mm256_loadu_si256((const __m256i*)p); // x86 loads are little-endian, like load64
+        lanes = _mm256_add_epi64(lanes, _mm256_mullo_epi64(input, multiplier2));
+        lanes = _mm256_rol_epi64(lanes, 31);
+        lanes = _mm256_mullo_epi64(lanes, multiplier1);
+        p += 32;
+    } while (p <= limit);
+
+    unsigned long long v[4];
+    _mm256_storeu_si256((__m256i*)v, lanes);
+    return finishHash(mergeLanes(v[0], v[1], v[2], v[3]), p, end, length);
+}
+#endif
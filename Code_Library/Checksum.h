@@ -0,0 +1,12 @@
+#ifndef MILESTONE_2_ADS_CHECKSUM_H
+#define MILESTONE_2_ADS_CHECKSUM_H
+
+#include <cstddef>
+
+/**
+ * 64-bit content hash (XXH64 algorithm, seed 0)
+ * Used to fingerprint blocks and chunks in the block archive
+ */
+unsigned long long hash64(const unsigned char* data, size_t length, unsigned long long seed = 0);
+
+#endif //MILESTONE_2_ADS_CHECKSUM_H
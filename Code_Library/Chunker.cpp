@@ -0,0 +1,81 @@
+#include "Chunker.h"
+
+/**
+ * Gear table: one pseudo-random 64-bit value per byte.
+ * Generated with splitmix64 from a fixed seed so every build chunks the same way.
+ */
+struct GearTable {
+    unsigned long long values[256];
+
+    GearTable() {
+        unsigned long long state = 0x2F6B5A1C3D4E8F09ULL;
+        for (int i = 0; i < 256; i++) {
+            state += 0x9E3779B97F4A7C15ULL;
+            unsigned long long z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            values[i] = z ^ (z >> 31);
+        }
+    }
+};
+
+static const unsigned long long* gearTable() {
+    static const GearTable table; // thread-safe one-time initialization
+    return table.values;
+}
+
+// Mask with 'bits' one-bits spread over the high half of the hash (FastCDC padding)
+static unsigned long long spreadMask(int bits) {
+    unsigned long long mask = 0;
+    int position = 63;
+    for (int i = 0; i < bits && position >= 0; i++) {
+        mask |= 1ULL << position;
+        position -= 2;
+    }
+    return mask;
+}
+
+ContentChunker::ContentChunker(size_t averageChunkSize) {
+    // Round the average to a power of two so the mask bit count is exact
+    size_t avg = 256;
+    while (avg < averageChunkSize) {
+        avg *= 2;
+    }
+    int bits = 0;
+    while ((1ULL << bits) < avg) {
+        bits++;
+    }
+
+    averageSize = avg;
+    minSize = avg / 4;
+    maxSize = avg * 4;
+    maskStrict = spreadMask(bits + 2); // normalization level 2
+    maskLoose = spreadMask(bits - 2);
+}
+
+size_t ContentChunker::nextChunkLength(const unsigned char* data, size_t available) const {
+    if (available <= minSize) {
+        return available;
+    }
+
+    const unsigned long long* gear = gearTable();
+    size_t limit = (available < maxSize) ? available : maxSize;
+    size_t normal = (limit < averageSize) ? limit : averageSize;
+    unsigned long long hash = 0;
+    size_t i = minSize; // cut-point skipping: bytes before minSize never matter
+
+    // Before the average size use the strict mask, after it the loose one
+    for (; i < normal; i++) {
+        hash = (hash << 1) + gear[data[i]];
+        if (!(hash & maskStrict)) {
+            return i + 1;
+        }
+    }
+    for (; i < limit; i++) {
+        hash = (hash << 1) + gear[data[i]];
+        if (!(hash & maskLoose)) {
+            return i + 1;
+        }
+    }
+    return limit;
+}
@@ -0,0 +1,35 @@
+#ifndef MILESTONE_2_ADS_CHUNKER_H
+#define MILESTONE_2_ADS_CHUNKER_H
+
+#include <cstddef>
+
+/*
+  ContentChunker class
+  Content-defined chunking with a Gear rolling hash (FastCDC style).
+  Chunk boundaries depend only on nearby content, so an insertion early in a
+  file only changes the chunks around it and the rest still deduplicate.
+*/
+class ContentChunker {
+private:
+    size_t minSize;               // no boundary before this many bytes
+    size_t averageSize;           // target (normalization point)
+    size_t maxSize;               // forced boundary
+    unsigned long long maskStrict; // more bits: harder to cut before the average
+    unsigned long long maskLoose;  // fewer bits: easier to cut after the average
+
+public:
+    explicit ContentChunker(size_t averageChunkSize = 64 * 1024);
+
+    /**
+     * Length of the next chunk starting at data.
+     * available should be at least getMaxSize() unless the input ends sooner;
+     * the whole remainder is returned when no boundary is found.
+     */
+    size_t nextChunkLength(const unsigned char* data, size_t available) const;
+
+    size_t getMinSize() const { return minSize; }
+    size_t getAverageSize() const { return averageSize; }
+    size_t getMaxSize() const { return maxSize; }
+};
+
+#endif //MILESTONE_2_ADS_CHUNKER_H
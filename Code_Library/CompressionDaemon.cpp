@@ -0,0 +1,340 @@
+#include "CompressionDaemon.h"
+#include "ByteOrder.h"
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char requestMagic[4] = {'H', 'Z', 'Q', '1'};
+static const char responseMagic[4] = {'H', 'Z', 'R', '1'};
+static const size_t requestHeaderSize = 20;
+static const size_t responseHeaderSize = 64;
+static const size_t maxPathLength = 4096;
+static const int maxPassedFds = 2;
+
+static bool writeFully(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+static bool readFully(int fd, char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = recv(fd, data, length, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * Read the request header, collecting any descriptors that ride on it
+ */
+static bool readHeader(int fd, unsigned char* header, int* fds, int& fdCount) {
+    size_t got = 0;
+    while (got < requestHeaderSize) {
+        char control[CMSG_SPACE(sizeof(int) * maxPassedFds)];
+        iovec io = {header + got, requestHeaderSize - got};
+        msghdr message = {};
+        message.msg_iov = &io;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        for (cmsghdr* c = CMSG_FIRSTHDR(&message); c; c = CMSG_NXTHDR(&message, c)) {
+            if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+            int count = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            for (int i = 0; i < count; i++) {
+                int passed;
+                memcpy(&passed, CMSG_DATA(c) + i * sizeof(int), sizeof(int));
+                if (fdCount < maxPassedFds) fds[fdCount++] = passed;
+                else close(passed);
+            }
+        }
+        got += (size_t)n;
+    }
+    return true;
+}
+
+static void appendResponseHeader(string& out, bool ok, const ArchiveStats& stats, unsigned long long micros,
+                                 unsigned long long bodyLength) {
+    out.append(responseMagic, 4);
+    out.push_back(ok ? 0 : 1);
+    out.append(3, '\0');
+    appendU64(out, stats.bytesIn);
+    appendU64(out, stats.bytesOut);
+    appendU64(out, stats.blockCount);
+    appendU64(out, stats.duplicateBlocks);
+    appendU64(out, stats.estimatedPeakMemory);
+    appendU64(out, micros);
+    appendU64(out, bodyLength);
+}
+
+CompressionDaemon::CompressionDaemon(const DaemonOptions& daemonOptions)
+    : options(daemonOptions), pool(daemonOptions.workers), listenFd(-1), stopping(false), connections(16),
+      requestCount(0), failureCount(0), totalIn(0), totalOut(0) {
+}
+
+CompressionDaemon::~CompressionDaemon() {
+    stop();
+}
+
+bool CompressionDaemon::start() {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.empty() || options.socketPath.size() >= sizeof(address.sun_path)) {
+        cerr << "Error: Bad socket path " << options.socketPath << endl;
+        return false;
+    }
+    memcpy(address.sun_path, options.socketPath.c_str(), options.socketPath.size() + 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        cerr << "Error: Cannot create socket" << endl;
+        return false;
+    }
+    unlink(options.socketPath.c_str()); // stale socket from an earlier run
+    if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 64) != 0) {
+        cerr << "Error: Cannot listen on " << options.socketPath << endl;
+        close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    stopping.store(false);
+    acceptor = std::thread([this]() { acceptLoop(); });
+    return true;
+}
+
+void CompressionDaemon::stop() {
+    if (listenFd < 0) return;
+    stopping.store(true);
+    shutdown(listenFd, SHUT_RDWR); // wakes accept()
+    acceptor.join();
+    close(listenFd);
+    listenFd = -1;
+    unlink(options.socketPath.c_str());
+
+    // Wake connections blocked on a read; a running job finishes first
+    std::unique_lock<std::mutex> lock(connectionsMutex);
+    for (size_t i = 0; i < connections.getSize(); i++) {
+        shutdown(connections[i], SHUT_RDWR);
+    }
+    connectionsDone.wait(lock, [this]() { return connections.isEmpty(); });
+}
+
+DaemonStats CompressionDaemon::stats() const {
+    DaemonStats result;
+    result.requests = requestCount.load();
+    result.failures = failureCount.load();
+    result.bytesIn = totalIn.load();
+    result.bytesOut = totalOut.load();
+    return result;
+}
+
+void CompressionDaemon::acceptLoop() {
+    while (!stopping.load()) {
+        int client = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break; // shut down
+        }
+        {
+            std::lock_guard<std::mutex> lock(connectionsMutex);
+            connections.pushBack(client);
+        }
+        // One light thread per connection waits on the socket; the jobs run on the pool
+        std::thread([this, client]() { serve(client); }).detach();
+    }
+}
+
+void CompressionDaemon::forget(int client) {
+    close(client);
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    for (size_t i = 0; i < connections.getSize(); i++) {
+        if (connections[i] == client) {
+            connections[i] = connections[connections.getSize() - 1];
+            connections.popBack();
+            break;
+        }
+    }
+    connectionsDone.notify_all();
+}
+
+void CompressionDaemon::serve(int client) {
+    // Reused for every request on this connection, so steady traffic stops allocating
+    string input;
+    string output;
+    string path;
+    string response;
+
+    while (!stopping.load()) {
+        unsigned char header[requestHeaderSize];
+        int fds[maxPassedFds];
+        int fdCount = 0;
+        if (!readHeader(client, header, fds, fdCount)) {
+            for (int i = 0; i < fdCount; i++) close(fds[i]);
+            break;
+        }
+
+        DaemonOp op = (DaemonOp)header[4];
+        DaemonData inputKind = (DaemonData)header[5];
+        DaemonData outputKind = (DaemonData)header[6];
+        unsigned long long inputLength = readU64(header + 8);
+        unsigned int pathLength = readU32(header + 16);
+
+        string error;
+        bool inputIsPath = (inputKind == DAEMON_DATA_PATH);
+        size_t inputLimit = inputIsPath ? maxPathLength : options.maxInlineBytes;
+        if (memcmp(header, requestMagic, 4) != 0 || inputLength > inputLimit || pathLength > maxPathLength) {
+            for (int i = 0; i < fdCount; i++) close(fds[i]);
+            break; // not our protocol or absurd sizes: drop the connection
+        }
+        input.resize(inputLength);
+        path.resize(pathLength);
+        if ((inputLength > 0 && !readFully(client, &input[0], inputLength))
+            || (pathLength > 0 && !readFully(client, &path[0], pathLength))) {
+            for (int i = 0; i < fdCount; i++) close(fds[i]);
+            break;
+        }
+
+        // Where the job reads and writes
+        int nextFd = 0;
+        ArchiveEndpoint source;
+        ArchiveEndpoint sink;
+        output.clear();
+        if (inputKind == DAEMON_DATA_PATH) source = ArchiveEndpoint::file(input);
+        else if (inputKind == DAEMON_DATA_INLINE) source = ArchiveEndpoint::memory((const unsigned char*)input.data(), input.size());
+        else if (inputKind == DAEMON_DATA_FD && nextFd < fdCount) source = ArchiveEndpoint::descriptor(fds[nextFd++]);
+        else error = "Missing input";
+        if (outputKind == DAEMON_DATA_PATH) sink = ArchiveEndpoint::file(path);
+        else if (outputKind == DAEMON_DATA_INLINE) sink = ArchiveEndpoint::memory(output);
+        else if (outputKind == DAEMON_DATA_FD && nextFd < fdCount) sink = ArchiveEndpoint::descriptor(fds[nextFd++]);
+        else if (error.empty()) error = "Missing output";
+        if (error.empty() && op != DAEMON_COMPRESS && op != DAEMON_DECOMPRESS) error = "Unknown operation";
+
+        ArchiveStats stats;
+        auto begin = chrono::steady_clock::now();
+        if (error.empty()) {
+            bool ok = false;
+            TaskGroup job(pool);
+            job.run([&]() {
+                if (op == DAEMON_COMPRESS) {
+                    ok = compressArchive(source, sink, options.archive, &stats);
+                } else {
+                    ExtractOptions extract;
+                    extract.io = options.archive.io;
+                    extract.memoryLimit = options.archive.memoryLimit;
+                    ok = decompressArchive(source, sink, extract, &stats);
+                }
+            });
+            job.wait();
+            if (!ok) error = op == DAEMON_COMPRESS ? "Compression failed" : "Decompression failed";
+        }
+        unsigned long long micros =
+            (unsigned long long)chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - begin).count();
+        for (int i = 0; i < fdCount; i++) close(fds[i]);
+
+        requestCount++;
+        if (error.empty()) {
+            totalIn += stats.bytesIn;
+            totalOut += stats.bytesOut;
+        } else {
+            failureCount++;
+        }
+
+        const string& body = error.empty() ? output : error;
+        response.clear();
+        appendResponseHeader(response, error.empty(), stats, micros, body.size());
+        if (!writeFully(client, response.data(), response.size()) || !writeFully(client, body.data(), body.size())) {
+            break;
+        }
+    }
+    forget(client);
+}
+
+int connectDaemon(const string& socketPath) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) return -1;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendDaemonRequest(int socket, const DaemonRequest& request, DaemonResponse& response) {
+    string header(requestMagic, 4);
+    header.push_back((char)request.op);
+    header.push_back((char)request.inputKind);
+    header.push_back((char)request.outputKind);
+    header.push_back(0);
+    appendU64(header, request.input.size());
+    appendU32(header, (unsigned int)request.outputPath.size());
+
+    int fds[maxPassedFds];
+    int fdCount = 0;
+    if (request.inputKind == DAEMON_DATA_FD) fds[fdCount++] = request.inputFd;
+    if (request.outputKind == DAEMON_DATA_FD) fds[fdCount++] = request.outputFd;
+
+    // The header goes out with sendmsg so descriptors can ride on it
+    char control[CMSG_SPACE(sizeof(int) * maxPassedFds)] = {};
+    iovec io = {&header[0], header.size()};
+    msghdr message = {};
+    message.msg_iov = &io;
+    message.msg_iovlen = 1;
+    if (fdCount > 0) {
+        message.msg_control = control;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * fdCount);
+        cmsghdr* c = CMSG_FIRSTHDR(&message);
+        c->cmsg_level = SOL_SOCKET;
+        c->cmsg_type = SCM_RIGHTS;
+        c->cmsg_len = CMSG_LEN(sizeof(int) * fdCount);
+        memcpy(CMSG_DATA(c), fds, sizeof(int) * fdCount);
+    }
+    ssize_t sent;
+    do {
+        sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent <= 0 || !writeFully(socket, header.data() + sent, header.size() - (size_t)sent)
+        || !writeFully(socket, request.input.data(), request.input.size())
+        || !writeFully(socket, request.outputPath.data(), request.outputPath.size())) {
+        return false;
+    }
+
+    unsigned char reply[responseHeaderSize];
+    if (!readFully(socket, (char*)reply, responseHeaderSize) || memcmp(reply, responseMagic, 4) != 0) {
+        return false;
+    }
+    response.ok = reply[4] == 0;
+    response.stats = ArchiveStats();
+    response.stats.bytesIn = readU64(reply + 8);
+    response.stats.bytesOut = readU64(reply + 16);
+    response.stats.blockCount = readU64(reply + 24);
+    response.stats.duplicateBlocks = readU64(reply + 32);
+    response.stats.estimatedPeakMemory = (size_t)readU64(reply + 40);
+    response.microseconds = readU64(reply + 48);
+    string& body = response.ok ? response.output : response.error;
+    response.output.clear();
+    response.error.clear();
+    body.resize(readU64(reply + 56));
+    return body.empty() || readFully(socket, &body[0], body.size());
+}
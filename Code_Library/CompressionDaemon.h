@@ -0,0 +1,129 @@
+#ifndef MILESTONE_2_ADS_COMPRESSIONDAEMON_H
+#define MILESTONE_2_ADS_COMPRESSIONDAEMON_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "BlockArchive.h"
+#include "DynamicArray.h"
+#include "WorkStealingPool.h"
+
+using namespace std;
+
+/*
+  Compression daemon
+  A long-running process that serves block-archive jobs over a Unix domain
+  socket, so callers skip process startup and reuse warm state: the worker
+  pool, per-connection buffers and the decode-table cache. A connection
+  carries any number of requests, one at a time.
+
+  Wire format (integers big-endian, see ByteOrder.h):
+    request  (20 bytes): "HZQ1" | op(1) | input kind(1) | output kind(1) | reserved(1)
+                         | input length(8) | output path length(4)
+                         then the input bytes (a path or inline data) and the output path
+    response (64 bytes): "HZR1" | status(1) | reserved(3) | bytes in(8) | bytes out(8)
+                         | blocks(8) | duplicate blocks(8) | estimated peak memory(8) | microseconds(8)
+                         | body length(8)
+                         then the body: inline output, or the error message if status != 0
+  Descriptors for DAEMON_DATA_FD travel as SCM_RIGHTS on the request
+  header, input first. The daemon closes its copies when the job is done.
+*/
+
+enum DaemonOp : unsigned char {
+    DAEMON_COMPRESS = 1,
+    DAEMON_DECOMPRESS = 2
+};
+
+enum DaemonData : unsigned char {
+    DAEMON_DATA_PATH = 0,    // a file path on the daemon's side
+    DAEMON_DATA_FD = 1,      // a passed descriptor
+    DAEMON_DATA_INLINE = 2   // bytes in the request / response itself
+};
+
+struct DaemonRequest {
+    DaemonOp op = DAEMON_COMPRESS;
+    DaemonData inputKind = DAEMON_DATA_PATH;
+    DaemonData outputKind = DAEMON_DATA_PATH;
+    string input;            // path, or the data for DAEMON_DATA_INLINE
+    string outputPath;
+    int inputFd = -1;
+    int outputFd = -1;
+};
+
+struct DaemonResponse {
+    bool ok = false;
+    string error;
+    string output;           // result for DAEMON_DATA_INLINE
+    ArchiveStats stats;      // bytesIn, bytesOut, blockCount, duplicateBlocks, estimatedPeakMemory
+    unsigned long long microseconds = 0;
+};
+
+struct DaemonOptions {
+    string socketPath;
+    unsigned int workers = 0;                       // job pool size, 0 = one per hardware thread
+    ArchiveOptions archive;                         // used for every compress request
+    size_t maxInlineBytes = 256 * 1024 * 1024;      // larger inline requests are refused
+};
+
+struct DaemonStats {
+    unsigned long long requests = 0;
+    unsigned long long failures = 0;
+    unsigned long long bytesIn = 0;
+    unsigned long long bytesOut = 0;
+};
+
+class CompressionDaemon {
+public:
+    explicit CompressionDaemon(const DaemonOptions& daemonOptions);
+    ~CompressionDaemon();
+
+    CompressionDaemon(const CompressionDaemon&) = delete;
+    CompressionDaemon& operator=(const CompressionDaemon&) = delete;
+
+    /**
+     * Bind the socket (replacing a stale one) and serve in the background
+     */
+    bool start();
+
+    /**
+     * Stop accepting, close open connections and wait for running jobs
+     */
+    void stop();
+
+    DaemonStats stats() const;
+
+private:
+    DaemonOptions options;
+    WorkStealingPool pool;
+    int listenFd;
+    std::thread acceptor;
+    std::atomic<bool> stopping;
+
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsDone;
+    DynamicArray<int> connections;    // open client sockets, shut down on stop()
+
+    std::atomic<unsigned long long> requestCount;
+    std::atomic<unsigned long long> failureCount;
+    std::atomic<unsigned long long> totalIn;
+    std::atomic<unsigned long long> totalOut;
+
+    void acceptLoop();
+    void serve(int client);
+    void forget(int client);
+};
+
+/**
+ * Connect to a daemon; returns the socket or -1
+ */
+int connectDaemon(const string& socketPath);
+
+/**
+ * Send one request and wait for its response; false if the connection failed
+ * (a failed job still returns true, with response.ok false)
+ */
+bool sendDaemonRequest(int socket, const DaemonRequest& request, DaemonResponse& response);
+
+#endif //MILESTONE_2_ADS_COMPRESSIONDAEMON_H
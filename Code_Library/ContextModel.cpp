@@ -0,0 +1,205 @@
+#include "ContextModel.h"
+#include "HuffmanTable.h"
+#include "DecodeTable.h"
+#include "ByteOrder.h"
+#include <cmath>
+
+// Refinement passes after seeding the groups
+static const int clusterPasses = 2;
+
+/**
+ * Cost in bits of coding a context's counts with a group's statistics
+ * (smoothed, so symbols the group has not seen are expensive but finite)
+ */
+static double crossCost(const unsigned int* context, const unsigned long long* group, double groupTotal) {
+    double cost = 0;
+    for (int s = 0; s < 256; s++) {
+        if (context[s] == 0) continue;
+        cost -= context[s] * log2(((double)group[s] + 0.5) / (groupTotal + 128));
+    }
+    return cost;
+}
+
+void clusterContexts(const unsigned char* data, size_t length, ContextClusters& clusters) {
+    // Order-1 histogram (heap: 256 x 256 counts)
+    unsigned int* order1 = new unsigned int[256 * 256]();
+    unsigned long long contextTotal[256] = {0};
+    unsigned char previous = 0;
+    for (size_t i = 0; i < length; i++) {
+        order1[previous * 256 + data[i]]++;
+        contextTotal[previous]++;
+        previous = data[i];
+    }
+
+    // Seed one group per busiest context
+    int seeds[maxContextClusters];
+    int seedCount = 0;
+    bool taken[256] = {false};
+    while (seedCount < maxContextClusters) {
+        int best = -1;
+        for (int c = 0; c < 256; c++) {
+            if (!taken[c] && contextTotal[c] > 0 && (best < 0 || contextTotal[c] > contextTotal[best])) best = c;
+        }
+        if (best < 0) break;
+        taken[best] = true;
+        seeds[seedCount++] = best;
+    }
+    if (seedCount == 0) {
+        seeds[seedCount++] = 0; // empty block: one (unused) group
+    }
+    clusters.clusterCount = seedCount;
+    for (int k = 0; k < seedCount; k++) {
+        for (int s = 0; s < 256; s++) {
+            clusters.counts[k][s] = order1[seeds[k] * 256 + s];
+        }
+    }
+
+    // Assign every context to the group that codes it cheapest, then re-sum the groups
+    for (int pass = 0; pass < clusterPasses; pass++) {
+        double groupTotal[maxContextClusters];
+        for (int k = 0; k < seedCount; k++) {
+            groupTotal[k] = 0;
+            for (int s = 0; s < 256; s++) groupTotal[k] += (double)clusters.counts[k][s];
+        }
+        for (int c = 0; c < 256; c++) {
+            int best = 0;
+            double bestCost = 0;
+            for (int k = 0; k < seedCount && contextTotal[c] > 0; k++) {
+                double cost = crossCost(order1 + c * 256, clusters.counts[k], groupTotal[k]);
+                if (k == 0 || cost < bestCost) {
+                    best = k;
+                    bestCost = cost;
+                }
+            }
+            clusters.clusterOf[c] = (unsigned char)best;
+        }
+        for (int k = 0; k < seedCount; k++) {
+            for (int s = 0; s < 256; s++) clusters.counts[k][s] = 0;
+        }
+        for (int c = 0; c < 256; c++) {
+            for (int s = 0; s < 256; s++) {
+                clusters.counts[clusters.clusterOf[c]][s] += order1[c * 256 + s];
+            }
+        }
+    }
+    delete[] order1;
+}
+
+double order1EstimateBytes(const ContextClusters& clusters) {
+    double bytes = 1 + 256;
+    for (int k = 0; k < clusters.clusterCount; k++) {
+        int distinct = 0;
+        double symbols = 0;
+        for (int s = 0; s < 256; s++) {
+            if (clusters.counts[k][s] > 0) distinct++;
+            symbols += (double)clusters.counts[k][s];
+        }
+        double bits = entropyBits(clusters.counts[k]);
+        bytes += 2 + (distinct * 10 + 7) / 8 + (bits > symbols ? bits : symbols) / 8;
+    }
+    return bytes;
+}
+
+void order1Encode(const unsigned char* data, size_t length, const ContextClusters& clusters, string& out) {
+    out.push_back((char)clusters.clusterCount);
+    out.append((const char*)clusters.clusterOf, 256);
+
+    HuffmanTable* tables = new HuffmanTable[clusters.clusterCount];
+    for (int k = 0; k < clusters.clusterCount; k++) {
+        tables[k].buildFromCounts(clusters.counts[k], false);
+        const string& tree = tables[k].getSerialized();
+        appendU16(out, (unsigned int)tree.size());
+        out += tree;
+    }
+
+    // Per-context code arrays so the loop is one lookup per byte
+    const unsigned long long* bits[256];
+    const unsigned char* lengths[256];
+    for (int c = 0; c < 256; c++) {
+        bits[c] = tables[clusters.clusterOf[c]].getBits();
+        lengths[c] = tables[clusters.clusterOf[c]].getLengths();
+    }
+
+    GrowingBufferSink sink(out);
+    BitWriter<GrowingBufferSink> writer(sink);
+    unsigned char previous = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char symbol = data[i];
+        writer.writeBits(bits[previous][symbol], lengths[previous][symbol]);
+        previous = symbol;
+    }
+    writer.flush();
+    delete[] tables;
+}
+
+bool order1Decode(const unsigned char* stream, size_t streamLength, unsigned int rawLength, string& out) {
+    if (streamLength < 257) {
+        return false;
+    }
+    int groupCount = stream[0];
+    const unsigned char* clusterOf = stream + 1;
+    if (groupCount < 1 || groupCount > maxContextClusters) {
+        return false;
+    }
+    for (int c = 0; c < 256; c++) {
+        if (clusterOf[c] >= groupCount) return false;
+    }
+
+    HuffmanTable* tables = new HuffmanTable[groupCount];
+    MultiSymbolTable* lookups[maxContextClusters] = {nullptr};
+    size_t position = 257;
+    bool ok = true;
+    for (int k = 0; k < groupCount && ok; k++) {
+        if (position + 2 > streamLength) {
+            ok = false;
+            break;
+        }
+        unsigned int treeLength = readU16(stream + position);
+        position += 2;
+        if (treeLength == 0) continue; // group without symbols
+        if (position + treeLength > streamLength || !tables[k].load(stream + position, treeLength)) {
+            ok = false;
+            break;
+        }
+        lookups[k] = new MultiSymbolTable(tables[k].getRoot());
+        position += treeLength;
+    }
+
+    // Every code is at least one bit, so the bits after the trees bound the length
+    if (ok && rawLength > (unsigned long long)(streamLength - position) * 8) {
+        ok = false;
+    }
+    size_t start = out.size();
+    if (ok) {
+        out.resize(start + rawLength);
+        unsigned char* dest = (unsigned char*)&out[start];
+        MemorySpanSource source(stream + position, streamLength - position);
+        BitReader<MemorySpanSource> reader(source);
+        unsigned char previous = 0;
+        for (unsigned int i = 0; i < rawLength && ok; i++) {
+            MultiSymbolTable* lookup = lookups[clusterOf[previous]];
+            if (!lookup) {
+                ok = false;
+                break;
+            }
+            // One symbol per lookup: the next one depends on this one's context
+            if (reader.bitsAvailable() < MultiSymbolTable::windowBits) reader.refill();
+            const MultiSymbolEntry& entry = lookup->lookup((unsigned int)reader.peekBits(MultiSymbolTable::windowBits));
+            if (reader.bitsAvailable() >= MultiSymbolTable::windowBits && entry.count > 0) {
+                dest[i] = entry.symbols[0];
+                reader.consumeBits(entry.firstBits);
+            } else {
+                MemorySpanSink one(dest + i, 1);
+                ok = decodeSymbols(lookup->getRoot(), reader, 1, one);
+            }
+            previous = dest[i];
+        }
+        if (!ok) out.resize(start);
+    }
+
+    for (int k = 0; k < groupCount; k++) {
+        delete lookups[k];
+    }
+    delete[] tables;
+    return ok;
+}
@@ -0,0 +1,53 @@
+#ifndef MILESTONE_2_ADS_CONTEXTMODEL_H
+#define MILESTONE_2_ADS_CONTEXTMODEL_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/*
+  Order-1 context model for Huffman coding
+  Each byte is coded with a table chosen by the byte before it. One table
+  per previous byte would cost 256 trees of header, so contexts with
+  similar statistics are clustered into at most maxContextClusters groups
+  and each group gets one tree. The header is a 256-byte context-to-group
+  map plus one tree per group.
+
+  Encoded layout (after the block codec's mode byte and raw length):
+    [group count: 1][group of each context: 256]
+    ([tree length: 2][serialized tree]) per group
+    [code bits, MSB-first]
+  The first byte is coded in the context of byte 0.
+*/
+
+const int maxContextClusters = 16;
+
+struct ContextClusters {
+    int clusterCount = 0;
+    unsigned char clusterOf[256];                           // previous byte -> group
+    unsigned long long counts[maxContextClusters][256];     // byte counts per group
+};
+
+/**
+ * Count order-1 statistics of a block and group its contexts
+ */
+void clusterContexts(const unsigned char* data, size_t length, ContextClusters& clusters);
+
+/**
+ * Estimated size in bytes of order1Encode's output
+ */
+double order1EstimateBytes(const ContextClusters& clusters);
+
+/**
+ * Encode a block with the grouped context tables and append the stream to out
+ */
+void order1Encode(const unsigned char* data, size_t length, const ContextClusters& clusters, string& out);
+
+/**
+ * Decode rawLength bytes of an order-1 stream and append them to out
+ * Returns false if the stream is corrupt
+ */
+bool order1Decode(const unsigned char* stream, size_t streamLength, unsigned int rawLength, string& out);
+
+#endif //MILESTONE_2_ADS_CONTEXTMODEL_H
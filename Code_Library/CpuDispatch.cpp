@@ -0,0 +1,195 @@
+#include "CpuDispatch.h"
+#include <atomic>
+#include <cstdlib>
+#ifdef HUFFZIP_X86_KERNELS
+#include <cpuid.h>
+#endif
+
+#ifdef HUFFZIP_X86_KERNELS
+/**
+ * Register state the OS saves on context switches (XCR0)
+ */
+static unsigned long long enabledRegisterState() {
+    unsigned int low, high;
+    __asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((unsigned long long)high << 32) | low;
+}
+#endif
+
+static CpuFeatures detectFeatures() {
+    CpuFeatures features;
+#ifdef HUFFZIP_X86_KERNELS
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) {
+        return features;
+    }
+    // AVX-512 state must be enabled by the OS, not just present in the CPU
+    unsigned long long state = (c & bit_OSXSAVE) ? enabledRegisterState() : 0;
+    bool zmmSaved = (state & 0xE6) == 0xE6;
+
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+        features.avx512 = zmmSaved && (b & bit_AVX512F) && (b & bit_AVX512BW) && (b & bit_AVX512DQ)
+                          && (b & bit_AVX512VL);
+    }
+#endif
+    return features;
+}
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detectFeatures();
+    return features;
+}
+
+KernelLevel detectedKernelLevel() {
+    return cpuFeatures().avx512 ? KERNEL_AVX512 : KERNEL_SCALAR;
+}
+
+const char* kernelLevelName(KernelLevel level) {
+    switch (level) {
+    case KERNEL_AVX512:
+        return "avx512";
+    default:
+        return "scalar";
+    }
+}
+
+bool parseKernelLevel(const string& name, KernelLevel& level) {
+    for (int l = KERNEL_SCALAR; l <= KERNEL_AVX512; l++) {
+        if (name == kernelLevelName((KernelLevel)l)) {
+            level = (KernelLevel)l;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Detected level, capped by HUFFZIP_KERNELS if it is set
+ */
+static KernelLevel defaultKernelLevel() {
+    KernelLevel level = detectedKernelLevel();
+    const char* cap = getenv("HUFFZIP_KERNELS");
+    KernelLevel wanted;
+    if (cap && parseKernelLevel(cap, wanted) && wanted < level) {
+        level = wanted;
+    }
+    return level;
+}
+
+static std::atomic<int>& activeLevel() {
+    static std::atomic<int> level(defaultKernelLevel());
+    return level;
+}
+
+KernelLevel activeKernelLevel() {
+    return (KernelLevel)activeLevel().load(std::memory_order_relaxed);
+}
+
+bool forceKernelLevel(KernelLevel level) {
+    if (level < KERNEL_SCALAR || level > detectedKernelLevel()) {
+        return false;
+    }
+    activeLevel().store(level, std::memory_order_relaxed);
+    return true;
+}
+
+void resetKernelLevel() {
+    activeLevel().store(defaultKernelLevel(), std::memory_order_relaxed);
+}
+
+// ------------------------------------------------------------ bit packing
+
+static inline void storeBigEndian32(unsigned char* out, unsigned int value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+/**
+ * Bits collect in a 64-bit accumulator and leave it 32 at a time; a code
+ * longer than 32 bits goes in as two pieces, so pending + code length never
+ * exceeds 63.
+ */
+size_t packSymbols(const unsigned char* data, size_t length, const unsigned long long bits[256],
+                   const unsigned char lengths[256], BitPackState& state, unsigned char* out, size_t capacity,
+                   size_t& written) {
+    unsigned long long accumulator = state.accumulator;
+    int pending = state.pending;
+    size_t used = 0;
+    size_t i = 0;
+    while (i < length && capacity - used >= maxPackedSymbolBytes) {
+        unsigned char symbol = data[i++];
+        int count = lengths[symbol];
+        unsigned long long code = bits[symbol];
+        if (count > 32) {
+            count -= 32;
+            accumulator = (accumulator << count) | (code >> 32);
+            pending += count;
+            if (pending >= 32) {
+                pending -= 32;
+                storeBigEndian32(out + used, (unsigned int)(accumulator >> pending));
+                used += 4;
+            }
+            code &= 0xFFFFFFFFULL;
+            count = 32;
+        }
+        accumulator = (accumulator << count) | code;
+        pending += count;
+        if (pending >= 32) {
+            pending -= 32;
+            storeBigEndian32(out + used, (unsigned int)(accumulator >> pending));
+            used += 4;
+        }
+    }
+    state.accumulator = accumulator;
+    state.pending = pending;
+    written = used;
+    return i;
+}
+
+size_t flushPackedBits(BitPackState& state, unsigned char* out) {
+    size_t used = 0;
+    while (state.pending >= 8) {
+        state.pending -= 8;
+        out[used++] = (unsigned char)(state.accumulator >> state.pending);
+    }
+    if (state.pending > 0) {
+        out[used++] = (unsigned char)(state.accumulator << (8 - state.pending));
+    }
+    state.accumulator = 0;
+    state.pending = 0;
+    return used;
+}
+
+void appendPackedCodes(const unsigned char* data, size_t length, const unsigned long long bits[256],
+                       const unsigned char lengths[256], string& out) {
+    BitPackState state;
+    size_t done = 0;
+    while (done < length) {
+        // Most blocks that get here code below 4 bits a symbol; grow again if not
+        size_t start = out.size();
+        size_t room = (length - done) / 2 + 64;
+        out.resize(start + room);
+        size_t written;
+        done += packSymbols(data + done, length - done, bits, lengths, state, (unsigned char*)&out[start], room,
+                            written);
+        out.resize(start + written);
+    }
+    size_t start = out.size();
+    out.resize(start + 8);
+    out.resize(start + flushPackedBits(state, (unsigned char*)&out[start]));
+}
+
+// --------------------------------------------------------- kernel tables
+
+static const CodecKernels kernelTables[] = {
+    {hash64Scalar},
+#ifdef HUFFZIP_X86_KERNELS
+    {hash64Avx512},
+#endif
+};
+
+const CodecKernels& codecKernels() {
+    return kernelTables[activeLevel().load(std::memory_order_relaxed)];
+}
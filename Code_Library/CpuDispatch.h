@@ -0,0 +1,123 @@
+#ifndef MILESTONE_2_ADS_CPUDISPATCH_H
+#define MILESTONE_2_ADS_CPUDISPATCH_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HUFFZIP_X86_KERNELS 1   // GCC/Clang can build per-function x86 targets
+#endif
+
+/*
+  Runtime CPU feature dispatch
+  The same binary runs on every x86-64 host; the block checksum is picked on
+  first use from the builds the CPU supports. There are two levels:
+    KERNEL_SCALAR   portable C++, also the only level on other architectures
+    KERNEL_AVX512   x86-64-v4 (AVX-512 F/BW/DQ/VL): the checksum runs its
+                    four lanes in one vector register
+  Only the checksum is dispatched. The byte histogram and the Huffman bit
+  packer are plain C++ at every level: an AVX2 histogram with a fast path
+  for 32-byte runs, and a BMI2 packer that joins short codes before one
+  accumulator shift, both matched the scalar output but were 10-25% slower
+  on text and random bytes (only long runs got faster), so neither is
+  shipped. Both levels give the same checksum, so archives do not depend
+  on the machine that wrote them.
+
+  The environment variable HUFFZIP_KERNELS (scalar, avx512) or
+  forceKernelLevel caps the level, for tests and benchmarks.
+*/
+
+enum KernelLevel {
+    KERNEL_SCALAR = 0,
+    KERNEL_AVX512 = 1
+};
+
+struct CpuFeatures {
+    bool avx512 = false;   // F, BW, DQ and VL together, with ZMM state enabled by the OS
+};
+
+/**
+ * What this CPU supports (detected once)
+ */
+const CpuFeatures& cpuFeatures();
+
+/**
+ * Highest level the CPU supports
+ */
+KernelLevel detectedKernelLevel();
+
+/**
+ * Level the kernels currently run at
+ */
+KernelLevel activeKernelLevel();
+
+/**
+ * Run the kernels at this level; false (and no change) if the CPU lacks it
+ */
+bool forceKernelLevel(KernelLevel level);
+
+/**
+ * Back to the detected level (or the HUFFZIP_KERNELS cap)
+ */
+void resetKernelLevel();
+
+const char* kernelLevelName(KernelLevel level);
+
+/**
+ * Parse a level name as printed by kernelLevelName; false if unknown
+ */
+bool parseKernelLevel(const string& name, KernelLevel& level);
+
+// ------------------------------------------------------------ bit packing
+
+/**
+ * Bits of a packed code stream not yet stored (fewer than 32 between calls)
+ */
+struct BitPackState {
+    unsigned long long accumulator = 0;   // pending bits in the low end
+    int pending = 0;
+};
+
+// Room packSymbols keeps free in its output: one code of up to 64 bits plus a word
+const size_t maxPackedSymbolBytes = 16;
+
+/**
+ * Pack the codes of data MSB-first into out (the BitWriter bit order) and
+ * return how many symbols were consumed; stops early when fewer than
+ * maxPackedSymbolBytes of capacity are left. written gets the bytes stored.
+ */
+size_t packSymbols(const unsigned char* data, size_t length, const unsigned long long bits[256],
+                   const unsigned char lengths[256], BitPackState& state, unsigned char* out, size_t capacity,
+                   size_t& written);
+
+/**
+ * Store the pending bits zero-padded to whole bytes (at most 4) and reset state
+ */
+size_t flushPackedBits(BitPackState& state, unsigned char* out);
+
+/**
+ * Pack the codes of a whole buffer onto the end of out, padding the last byte
+ */
+void appendPackedCodes(const unsigned char* data, size_t length, const unsigned long long bits[256],
+                       const unsigned char lengths[256], string& out);
+
+// --------------------------------------------------------- kernel builds
+
+/**
+ * The kernel builds selected for the active level
+ */
+struct CodecKernels {
+    unsigned long long (*hash64)(const unsigned char* data, size_t length, unsigned long long seed);
+};
+
+const CodecKernels& codecKernels();
+
+// Builds of each kernel, defined next to the function they serve
+unsigned long long hash64Scalar(const unsigned char* data, size_t length, unsigned long long seed);
+#ifdef HUFFZIP_X86_KERNELS
+unsigned long long hash64Avx512(const unsigned char* data, size_t length, unsigned long long seed);
+#endif
+
+#endif //MILESTONE_2_ADS_CPUDISPATCH_H
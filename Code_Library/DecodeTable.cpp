@@ -0,0 +1,47 @@
+#include "DecodeTable.h"
+#include "HuffmanZipper.h"
+
+MultiSymbolTable::MultiSymbolTable(HuffmanNode* treeRoot) {
+    root = treeRoot;
+    const unsigned int size = 1u << windowBits;
+    entries = new MultiSymbolEntry[size]();
+
+    string codes[256];
+    generateCodes(root, "", codes);
+    unsigned long long bits[256];
+    unsigned char lengths[256];
+    packCodes(codes, bits, lengths);
+
+    // Single-symbol table first: every window starting with a code maps to it
+    unsigned char firstSymbol[1u << windowBits];
+    unsigned char firstLength[1u << windowBits] = {0};
+    for (int symbol = 0; symbol < 256; symbol++) {
+        int length = lengths[symbol];
+        if (length == 0 || length > windowBits) continue;
+        unsigned int start = (unsigned int)(bits[symbol] << (windowBits - length));
+        unsigned int span = 1u << (windowBits - length);
+        for (unsigned int w = start; w < start + span; w++) {
+            firstSymbol[w] = (unsigned char)symbol;
+            firstLength[w] = (unsigned char)length;
+        }
+    }
+
+    // Then chain whole codes through each window
+    for (unsigned int w = 0; w < size; w++) {
+        MultiSymbolEntry& entry = entries[w];
+        int used = 0;
+        while (entry.count < maxSymbols) {
+            unsigned int rest = (w << used) & (size - 1); // remaining bits, zero padded
+            int length = firstLength[rest];
+            if (length == 0 || used + length > windowBits) break;
+            entry.symbols[entry.count++] = firstSymbol[rest];
+            if (entry.count == 1) entry.firstBits = (unsigned char)length;
+            used += length;
+        }
+        entry.bits = (unsigned char)used;
+    }
+}
+
+MultiSymbolTable::~MultiSymbolTable() {
+    delete[] entries;
+}
@@ -0,0 +1,74 @@
+#ifndef MILESTONE_2_ADS_DECODETABLE_H
+#define MILESTONE_2_ADS_DECODETABLE_H
+
+#include "HuffmanNode.h"
+#include "BitIO.h"
+
+/*
+  MultiSymbolTable class
+  Decode table indexed by the next 12 bits of the stream. Each entry holds
+  every whole symbol that fits in those bits (up to 4) and how many bits
+  they use, so one lookup can write several bytes. Skewed data with short
+  codes (logs, text) decodes 2-4 bytes per lookup. Codes longer than the
+  window have an empty entry and are decoded by walking the tree.
+*/
+
+struct MultiSymbolEntry {
+    unsigned char symbols[4];
+    unsigned char count;  // symbols in this entry, 0 if the first code is longer than the window
+    unsigned char bits;   // bits used by those symbols
+    unsigned char firstBits; // bits of the first symbol alone (for single-symbol decoding)
+};
+
+class MultiSymbolTable {
+public:
+    static const int windowBits = 12;
+    static const int maxSymbols = 4;
+
+private:
+    HuffmanNode* root;          // not owned; used for codes longer than the window
+    MultiSymbolEntry* entries;  // 1 << windowBits entries
+
+public:
+    explicit MultiSymbolTable(HuffmanNode* treeRoot);
+    ~MultiSymbolTable();
+
+    MultiSymbolTable(const MultiSymbolTable&) = delete;
+    MultiSymbolTable& operator=(const MultiSymbolTable&) = delete;
+
+    const MultiSymbolEntry& lookup(unsigned int window) const { return entries[window]; }
+    HuffmanNode* getRoot() const { return root; }
+};
+
+/**
+ * Decode count symbols using the table, falling back to the tree for long
+ * codes and for the last few symbols; false if the bits run out
+ */
+template <class Source, class Sink>
+inline bool decodeSymbolsMulti(const MultiSymbolTable& table, BitReader<Source>& reader,
+                               unsigned long long count, Sink& out) {
+    const int window = MultiSymbolTable::windowBits;
+    unsigned long long done = 0;
+    while (done < count) {
+        if (reader.bitsAvailable() < window) reader.refill();
+        if (reader.bitsAvailable() >= window && count - done >= MultiSymbolTable::maxSymbols) {
+            const MultiSymbolEntry& entry = table.lookup((unsigned int)reader.peekBits(window));
+            if (entry.count > 0) {
+                for (int i = 0; i < entry.count; i++) {
+                    out.put(entry.symbols[i]);
+                }
+                reader.consumeBits(entry.bits);
+                done += entry.count;
+                continue;
+            }
+        }
+        // Long code, end of stream or last few symbols: walk the tree
+        if (!decodeSymbols(table.getRoot(), reader, 1, out)) {
+            return false;
+        }
+        done++;
+    }
+    return true;
+}
+
+#endif //MILESTONE_2_ADS_DECODETABLE_H
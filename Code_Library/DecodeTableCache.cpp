@@ -0,0 +1,189 @@
+#include "DecodeTableCache.h"
+#include "Checksum.h"
+
+/**
+ * Copy of the tree bits with the bits after the tree cleared, so the
+ * compressed data that shares the last byte does not change the key
+ */
+static string treeBytes(const unsigned char* data, size_t treeBits) {
+    string bytes((const char*)data, (treeBits + 7) / 8);
+    if (treeBits % 8 != 0) {
+        bytes.back() = (char)((unsigned char)bytes.back() & (0xFF << (8 - treeBits % 8)));
+    }
+    return bytes;
+}
+
+static unsigned long long treeKey(const string& bytes, size_t treeBits) {
+    return hash64((const unsigned char*)bytes.data(), bytes.size(), treeBits);
+}
+
+DecodeTableEntry::DecodeTableEntry(const string& bytes, size_t bitCount, HuffmanNode* treeRoot)
+    : tree(bytes), treeBits(bitCount), root(treeRoot), table(treeRoot) {
+}
+
+DecodeTableEntry::~DecodeTableEntry() {
+    delete root;
+}
+
+size_t DecodeTableEntry::memoryBytes() const {
+    // L leaves take 9 bits each and the L - 1 internal nodes 1 bit each
+    size_t nodes = (treeBits + 1) / 10 * 2;
+    return sizeof(DecodeTableEntry) + tree.size() + nodes * sizeof(HuffmanNode)
+           + ((size_t)1 << MultiSymbolTable::windowBits) * sizeof(MultiSymbolEntry);
+}
+
+DecodeTableCache::DecodeTableCache(size_t capacity)
+    : buckets(), newest(nullptr), oldest(nullptr), capacityBytes(capacity), usedBytes(0), entries(0),
+      hitCount(0), missCount(0) {
+}
+
+DecodeTableCache::~DecodeTableCache() {
+    clear();
+}
+
+DecodeTableCache& DecodeTableCache::global() {
+    static DecodeTableCache cache;
+    return cache;
+}
+
+DecodeTableCache::Node* DecodeTableCache::findNode(unsigned long long key, const string& bytes,
+                                                   size_t treeBits) const {
+    for (Node* node = buckets[key % bucketCount]; node; node = node->chain) {
+        if (node->key == key && node->entry->matches(bytes, treeBits)) return node;
+    }
+    return nullptr;
+}
+
+void DecodeTableCache::unlink(Node* node) {
+    if (node->newer) node->newer->older = node->older;
+    else newest = node->older;
+    if (node->older) node->older->newer = node->newer;
+    else oldest = node->newer;
+    node->newer = nullptr;
+    node->older = nullptr;
+}
+
+void DecodeTableCache::pushNewest(Node* node) {
+    node->older = newest;
+    node->newer = nullptr;
+    if (newest) newest->newer = node;
+    newest = node;
+    if (!oldest) oldest = node;
+}
+
+void DecodeTableCache::remove(Node* node) {
+    unlink(node);
+    Node** link = &buckets[node->key % bucketCount];
+    while (*link != node) {
+        link = &(*link)->chain;
+    }
+    *link = node->chain;
+    usedBytes -= node->entry->memoryBytes();
+    entries--;
+    delete node; // the entry lives on while decoders still hold it
+}
+
+void DecodeTableCache::evictTo(size_t bytes) {
+    while (oldest && usedBytes > bytes) {
+        remove(oldest);
+    }
+}
+
+shared_ptr<const DecodeTableEntry> DecodeTableCache::find(const unsigned char* data, size_t treeBits) {
+    string bytes = treeBytes(data, treeBits);
+    unsigned long long key = treeKey(bytes, treeBits);
+
+    std::lock_guard<std::mutex> guard(lock);
+    Node* node = findNode(key, bytes, treeBits);
+    if (!node) {
+        missCount++;
+        return nullptr;
+    }
+    hitCount++;
+    unlink(node);
+    pushNewest(node);
+    return node->entry;
+}
+
+shared_ptr<const DecodeTableEntry> DecodeTableCache::insert(const unsigned char* data, size_t treeBits,
+                                                            HuffmanNode* root) {
+    string bytes = treeBytes(data, treeBits);
+    unsigned long long key = treeKey(bytes, treeBits);
+    // Build outside the lock; other threads keep decoding meanwhile
+    shared_ptr<const DecodeTableEntry> entry = make_shared<const DecodeTableEntry>(bytes, treeBits, root);
+
+    std::lock_guard<std::mutex> guard(lock);
+    Node* existing = findNode(key, bytes, treeBits);
+    if (existing) {
+        unlink(existing);
+        pushNewest(existing);
+        return existing->entry;
+    }
+    if (entry->memoryBytes() > capacityBytes) {
+        return entry; // does not fit at all: usable, just not kept
+    }
+
+    evictTo(capacityBytes - entry->memoryBytes());
+    Node* node = new Node{key, entry, nullptr, nullptr, buckets[key % bucketCount]};
+    buckets[key % bucketCount] = node;
+    pushNewest(node);
+    usedBytes += entry->memoryBytes();
+    entries++;
+    return entry;
+}
+
+void DecodeTableCache::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    evictTo(0);
+}
+
+void DecodeTableCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> guard(lock);
+    capacityBytes = capacity;
+    evictTo(capacityBytes);
+}
+
+size_t DecodeTableCache::capacity() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return capacityBytes;
+}
+
+size_t DecodeTableCache::bytesUsed() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return usedBytes;
+}
+
+size_t DecodeTableCache::entryCount() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return entries;
+}
+
+unsigned long long DecodeTableCache::hits() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return hitCount;
+}
+
+unsigned long long DecodeTableCache::misses() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return missCount;
+}
+
+size_t serializedTreeBits(const unsigned char* data, size_t length) {
+    const size_t maxNodes = 2 * 256 - 1;
+    size_t limit = length * 8;
+    size_t position = 0;
+    size_t pending = 1; // subtrees still to read
+    size_t nodes = 0;
+    while (pending > 0) {
+        if (position >= limit || ++nodes > maxNodes) return 0;
+        bool leaf = (data[position / 8] >> (7 - position % 8)) & 1;
+        position++;
+        if (leaf) {
+            position += 8;
+            pending--;
+        } else {
+            pending++; // one subtree replaced by two
+        }
+    }
+    return position <= limit ? position : 0;
+}
@@ -0,0 +1,122 @@
+#ifndef MILESTONE_2_ADS_DECODETABLECACHE_H
+#define MILESTONE_2_ADS_DECODETABLECACHE_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "DecodeTable.h"
+
+using namespace std;
+
+/*
+  Decode-table cache
+  Many archives of the same kind (one log format, one JSON schema) carry
+  the same Huffman tree. Instead of rebuilding the tree and its
+  MultiSymbolTable for every file, decompressFile looks the serialized tree
+  up here first. Entries are keyed by hash64 of the tree bits, confirmed by
+  comparing the bits themselves, and evicted least-recently-used once the
+  cache holds more than its byte capacity.
+
+  Lookups hand out shared_ptr handles, so a table stays valid for as long
+  as a decoder uses it even if it is evicted in the meantime; all methods
+  are safe to call from several threads.
+*/
+
+/**
+ * A built tree and its multi-symbol decode table. Immutable once built.
+ */
+class DecodeTableEntry {
+private:
+    string tree;            // serialized tree bits, zero padded to whole bytes
+    size_t treeBits;
+    HuffmanNode* root;      // owned
+    MultiSymbolTable table;
+
+public:
+    DecodeTableEntry(const string& treeBytes, size_t bitCount, HuffmanNode* treeRoot);
+    ~DecodeTableEntry();
+
+    DecodeTableEntry(const DecodeTableEntry&) = delete;
+    DecodeTableEntry& operator=(const DecodeTableEntry&) = delete;
+
+    HuffmanNode* getRoot() const { return root; }
+    const MultiSymbolTable& getTable() const { return table; }
+    size_t getTreeBits() const { return treeBits; }
+    bool matches(const string& treeBytes, size_t bitCount) const { return bitCount == treeBits && treeBytes == tree; }
+    size_t memoryBytes() const;
+};
+
+class DecodeTableCache {
+public:
+    static const size_t defaultCapacity = 8 * 1024 * 1024;
+
+    explicit DecodeTableCache(size_t capacityBytes = defaultCapacity);
+    ~DecodeTableCache();
+
+    DecodeTableCache(const DecodeTableCache&) = delete;
+    DecodeTableCache& operator=(const DecodeTableCache&) = delete;
+
+    /**
+     * The cache shared by every decompressFile call in the process
+     */
+    static DecodeTableCache& global();
+
+    /**
+     * Table for the tree stored in the first treeBits bits of data, or nullptr.
+     * A hit becomes the most recently used entry.
+     */
+    shared_ptr<const DecodeTableEntry> find(const unsigned char* data, size_t treeBits);
+
+    /**
+     * Build the table for a freshly deserialized tree and cache it.
+     * Takes ownership of root. If the same tree was added meanwhile, that
+     * entry is returned and root is freed. With capacity 0 nothing is kept.
+     */
+    shared_ptr<const DecodeTableEntry> insert(const unsigned char* data, size_t treeBits, HuffmanNode* root);
+
+    void clear();
+    void setCapacity(size_t capacityBytes);  // evicts down to the new capacity
+
+    size_t capacity() const;
+    size_t bytesUsed() const;
+    size_t entryCount() const;
+    unsigned long long hits() const;
+    unsigned long long misses() const;
+
+private:
+    // Node of the recency list (newest first) and of one hash bucket chain
+    struct Node {
+        unsigned long long key;
+        shared_ptr<const DecodeTableEntry> entry;
+        Node* newer;
+        Node* older;
+        Node* chain;
+    };
+
+    static const size_t bucketCount = 256;
+
+    mutable std::mutex lock;
+    Node* buckets[bucketCount];
+    Node* newest;
+    Node* oldest;
+    size_t capacityBytes;
+    size_t usedBytes;
+    size_t entries;
+    unsigned long long hitCount;
+    unsigned long long missCount;
+
+    Node* findNode(unsigned long long key, const string& treeBytes, size_t treeBits) const;
+    void unlink(Node* node);
+    void pushNewest(Node* node);
+    void remove(Node* node);
+    void evictTo(size_t bytes);
+};
+
+/**
+ * Length in bits of the pre-order serialized tree at the start of data
+ * (as written by serializeTree), or 0 if it does not end within length bytes
+ */
+size_t serializedTreeBits(const unsigned char* data, size_t length);
+
+#endif //MILESTONE_2_ADS_DECODETABLECACHE_H
@@ -1,21 +1,41 @@
 
 #include "DynamicArray.h"
 #include "HuffmanNode.h"
+#include "BlockArchive.h"
+#include <memory>
 
 
 // Method Implementations
 template <typename T>
-DynamicArray<T>::DynamicArray(size_t cap)
+T *DynamicArray<T>::allocate(size_t count) // storage comes from the memory resource instead of new[]
 {
+    T *data = static_cast<T *>(resource->allocate(count * sizeof(T), alignof(T)));
+    std::uninitialized_default_construct_n(data, count); // same element state as new T[count]
+    return data;
+}
+
+template <typename T>
+void DynamicArray<T>::deallocate(T *data, size_t count)
+{
+    if (!data)
+        return;
+    std::destroy_n(data, count);
+    resource->deallocate(data, count * sizeof(T), alignof(T));
+}
+
+template <typename T>
+DynamicArray<T>::DynamicArray(size_t cap, std::pmr::memory_resource *res)
+{
+    resource = res ? res : std::pmr::get_default_resource();
     capacity = (cap > 0) ? cap : 1; // check if the capacity is a valid positive number
     size = 0;
-    array = new T[capacity];
+    array = allocate(capacity);
 }
 
 template <typename T>
 DynamicArray<T>::~DynamicArray()
 {
-    delete[] array;
+    deallocate(array, capacity);
 }
 
 template <typename T>
@@ -30,10 +50,10 @@ void DynamicArray<T>::reserve(size_t newCapacity) // A function for adjusting th
 {
     if (newCapacity <= capacity)
         return;
-    T *newArray = new T[newCapacity];
+    T *newArray = allocate(newCapacity);
     for (size_t i = 0; i < size; ++i)
         newArray[i] = array[i];
-    delete[] array;
+    deallocate(array, capacity);
     array = newArray;
     capacity = newCapacity;
 }
@@ -44,10 +64,10 @@ void DynamicArray<T>::shrinkToFit()
     if (size == capacity)
         return;
     size_t newCap = (size > 0) ? size : 1; // shrinking the capacity to free memory
-    T *newArray = new T[newCap];
+    T *newArray = allocate(newCap);
     for (size_t i = 0; i < size; ++i)
         newArray[i] = array[i];
-    delete[] array;
+    deallocate(array, capacity);
     array = newArray;
     capacity = newCap;
 }
@@ -122,6 +142,12 @@ void DynamicArray<T>::clear()
     size = 0;
 }
 
+template <typename T>
+std::pmr::memory_resource *DynamicArray<T>::getResource() const
+{
+    return resource;
+}
+
 template <typename T>
 T *DynamicArray<T>::getData()
 {
@@ -161,9 +187,10 @@ const T *DynamicArray<T>::end() const
 template <typename T>
 DynamicArray<T>::DynamicArray(const DynamicArray<T> &other) // A function to copy another array
 {
+    resource = other.resource;
     capacity = other.capacity;
     size = other.size;
-    array = new T[capacity];
+    array = allocate(capacity);
     for (size_t i = 0; i < size; ++i)
         array[i] = other.array[i];
 }
@@ -173,10 +200,10 @@ DynamicArray<T> &DynamicArray<T>::operator=(const DynamicArray<T> &other) // A f
 {
     if (this == &other)
         return *this;
-    T *newArray = new T[other.capacity];
+    T *newArray = allocate(other.capacity); // stays in this array's own resource
     for (size_t i = 0; i < other.size; ++i)
         newArray[i] = other.array[i];
-    delete[] array;
+    deallocate(array, capacity);
     array = newArray;
     capacity = other.capacity;
     size = other.size;
@@ -186,6 +213,7 @@ DynamicArray<T> &DynamicArray<T>::operator=(const DynamicArray<T> &other) // A f
 template <typename T>
 DynamicArray<T>::DynamicArray(DynamicArray<T> &&other) noexcept
 {
+    resource = other.resource;
     array = other.array;
     capacity = other.capacity;
     size = other.size;
@@ -195,11 +223,23 @@ DynamicArray<T>::DynamicArray(DynamicArray<T> &&other) noexcept
 }
 
 template <typename T>
-DynamicArray<T> &DynamicArray<T>::operator=(DynamicArray<T> &&other) noexcept
+DynamicArray<T> &DynamicArray<T>::operator=(DynamicArray<T> &&other)
 {
     if (this == &other)
         return *this;
-    delete[] array;
+    if (!(*resource == *other.resource)) // storage can only be stolen from the same resource
+    {
+        T *newArray = allocate(other.capacity);
+        for (size_t i = 0; i < other.size; ++i)
+            newArray[i] = std::move(other.array[i]);
+        deallocate(array, capacity);
+        array = newArray;
+        capacity = other.capacity;
+        size = other.size;
+        other.size = 0;
+        return *this;
+    }
+    deallocate(array, capacity);
     array = other.array;
     capacity = other.capacity;
     size = other.size;
@@ -210,7 +250,9 @@ DynamicArray<T> &DynamicArray<T>::operator=(DynamicArray<T> &&other) noexcept
 }
 
 
-// Explicit instantiations for types you use: int, char, HuffmanNode*
+// Explicit instantiations for types you use: int, char, HuffmanNode*, archive types
 template class DynamicArray<int>;
 template class DynamicArray<char>;
-template class DynamicArray<HuffmanNode*>;
\ No newline at end of file
+template class DynamicArray<HuffmanNode*>;
+template class DynamicArray<unsigned long long>;
+template class DynamicArray<ArchiveBlock>;
\ No newline at end of file
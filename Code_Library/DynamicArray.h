@@ -7,6 +7,7 @@
 #include <stdexcept>
 #include <utility>
 #include <cassert>
+#include <memory_resource>
 
 template <typename T>
 class DynamicArray
@@ -16,11 +17,14 @@ private:
     size_t capacity; // maximum number of elements the array can hold
     size_t size;     // current number of elements
     // used size_t instead of int to prevent surprises that might happen
+    std::pmr::memory_resource *resource; // where the element storage comes from
     void resize();
+    T *allocate(size_t count);
+    void deallocate(T *data, size_t count);
 
 public:
     // Constructor and Destructor
-    DynamicArray(size_t cap = 10);
+    DynamicArray(size_t cap = 10, std::pmr::memory_resource *res = std::pmr::get_default_resource());
     ~DynamicArray();
 
     // Core operations
@@ -40,6 +44,7 @@ public:
     const T *getData() const;
     void reserve(size_t newCapacity);
     void shrinkToFit();
+    std::pmr::memory_resource *getResource() const;
 
     // Iterator support
     T *begin();
@@ -47,10 +52,13 @@ public:
     const T *begin() const;
     const T *end() const;
 
-    DynamicArray(const DynamicArray<T> &other);                // Copy constructor
-    DynamicArray &operator=(const DynamicArray<T> &other);     // Copy assignment
-    DynamicArray(DynamicArray<T> &&other) noexcept;            // Move constructor
-    DynamicArray &operator=(DynamicArray<T> &&other) noexcept; // Move assignment
+    // Copy and move construction take the source's memory resource; assignment
+    // keeps this array's own, so a move between different resources copies the
+    // elements (and can throw, like any allocation)
+    DynamicArray(const DynamicArray<T> &other);            // Copy constructor
+    DynamicArray &operator=(const DynamicArray<T> &other); // Copy assignment
+    DynamicArray(DynamicArray<T> &&other) noexcept;        // Move constructor
+    DynamicArray &operator=(DynamicArray<T> &&other);      // Move assignment
 };
 
 
@@ -0,0 +1,52 @@
+#include "FrequencySampler.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+bool sampleFrequencies(const string& filename, const SamplingOptions& options,
+                       unsigned long long counts[256], unsigned long long& totalBytes) {
+    for (int i = 0; i < 256; i++) {
+        counts[i] = 0;
+    }
+    totalBytes = 0;
+
+    std::error_code ec;
+    unsigned long long fileSize = std::filesystem::file_size(filename, ec);
+    ifstream in(filename, ios::binary);
+    if (ec || !in.is_open()) {
+        cerr << "Error: Cannot open file " << filename << endl;
+        return false;
+    }
+    totalBytes = fileSize;
+
+    size_t window = options.windowSize > 0 ? options.windowSize : 64 * 1024;
+    unsigned long long wanted = (unsigned long long)(fileSize * options.fraction);
+    unsigned long long windows = (wanted + window - 1) / window;
+    bool sampled = fileSize >= options.minInputSize && windows > 0
+                   && windows * window < fileSize;
+
+    string buffer(window, '\0');
+    if (!sampled) {
+        // Small input (or a fraction near 1): an exact count is just as cheap
+        while (in.read(&buffer[0], buffer.size()) || in.gcount() > 0) {
+            size_t got = (size_t)in.gcount();
+            for (size_t i = 0; i < got; i++) {
+                counts[(unsigned char)buffer[i]]++;
+            }
+        }
+        return false;
+    }
+
+    // Windows spread evenly over the file, so headers, bodies and tails all show up
+    unsigned long long stride = fileSize / windows;
+    for (unsigned long long w = 0; w < windows; w++) {
+        in.clear();
+        in.seekg((streamoff)(w * stride), ios::beg);
+        in.read(&buffer[0], window);
+        size_t got = (size_t)in.gcount();
+        for (size_t i = 0; i < got; i++) {
+            counts[(unsigned char)buffer[i]]++;
+        }
+    }
+    return true;
+}
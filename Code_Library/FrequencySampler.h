@@ -0,0 +1,33 @@
+#ifndef MILESTONE_2_ADS_FREQUENCYSAMPLER_H
+#define MILESTONE_2_ADS_FREQUENCYSAMPLER_H
+
+#include <string>
+
+using namespace std;
+
+/*
+  Frequency sampling
+  Instead of a full pass over the input, the byte histogram is estimated from
+  evenly strided sample windows. The resulting table must be able to code
+  every byte (see HuffmanTable::buildFromCounts with coverAllSymbols), and
+  the encoders keep a guard that falls back to exact counts if the estimate
+  turns out to code the data poorly.
+*/
+
+struct SamplingOptions {
+    bool enabled = false;
+    double fraction = 0.02;                           // share of the input to read
+    size_t windowSize = 64 * 1024;                    // bytes per sample window
+    unsigned long long minInputSize = 4 * 1024 * 1024; // smaller inputs are simply counted
+    double tolerance = 0.05;                          // allowed overshoot versus the exact table
+};
+
+/**
+ * Estimate the byte counts of a file
+ * Returns true if counts come from a sample, false if the file was small
+ * enough to count exactly. totalBytes receives the file size.
+ */
+bool sampleFrequencies(const string& filename, const SamplingOptions& options,
+                       unsigned long long counts[256], unsigned long long& totalBytes);
+
+#endif //MILESTONE_2_ADS_FREQUENCYSAMPLER_H
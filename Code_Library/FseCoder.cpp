@@ -0,0 +1,288 @@
+#include "FseCoder.h"
+#include "ByteOrder.h"
+#include <cmath>
+
+static const int minTableLog = 5;
+static const int maxTableLog = 11;
+
+// Index of the highest set bit
+static int highBit(unsigned int value) {
+    int bit = 0;
+    while (value >>= 1) bit++;
+    return bit;
+}
+
+/**
+ * Table size: up to 2^11 states, smaller for small blocks, but always
+ * at least twice the number of distinct symbols
+ */
+static int chooseTableLog(const unsigned long long counts[256], unsigned long long total) {
+    int distinct = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) distinct++;
+    }
+    int tableLog = minTableLog;
+    while (tableLog < maxTableLog && (1ULL << tableLog) < total) tableLog++;
+    while (tableLog < maxTableLog && (1 << tableLog) < distinct * 2) tableLog++;
+    return tableLog;
+}
+
+/**
+ * Scale counts so they sum to 2^tableLog, every present symbol keeping at least 1
+ */
+static void normalizeCounts(const unsigned long long counts[256], unsigned long long total, int tableLog,
+                            unsigned int normalized[256]) {
+    const long long size = 1LL << tableLog;
+    long long sum = 0;
+    for (int i = 0; i < 256; i++) {
+        normalized[i] = 0;
+        if (counts[i] == 0) continue;
+        long long scaled = (long long)((double)counts[i] * size / total + 0.5);
+        normalized[i] = scaled < 1 ? 1 : (unsigned int)scaled;
+        sum += normalized[i];
+    }
+
+    // Fix rounding drift on the largest entries, where it costs the least
+    while (sum != size) {
+        int largest = -1;
+        for (int i = 0; i < 256; i++) {
+            if (normalized[i] > 0 && (sum < size || normalized[i] > 1)
+                && (largest < 0 || normalized[i] > normalized[largest])) {
+                largest = i;
+            }
+        }
+        long long step = sum - size;
+        if (step > 0) {
+            long long room = normalized[largest] - 1;
+            if (step > room) step = room;
+            long long share = normalized[largest] / 4;
+            if (share > 0 && step > share) step = share; // spread big cuts over several symbols
+            normalized[largest] -= (unsigned int)step;
+            sum -= step;
+        } else {
+            normalized[largest] += (unsigned int)(-step);
+            sum = size;
+        }
+    }
+}
+
+/**
+ * Spread symbols over the states (FSE's step, which visits every state once
+ * for these table sizes) so each symbol's states are evenly interleaved
+ */
+static void spreadSymbols(const unsigned int normalized[256], int tableLog, unsigned char* spread) {
+    const unsigned int size = 1u << tableLog;
+    const unsigned int mask = size - 1;
+    const unsigned int step = (size >> 1) + (size >> 3) + 3;
+    unsigned int position = 0;
+    for (int symbol = 0; symbol < 256; symbol++) {
+        for (unsigned int n = 0; n < normalized[symbol]; n++) {
+            spread[position] = (unsigned char)symbol;
+            position = (position + step) & mask;
+        }
+    }
+}
+
+struct FseDecodeEntry {
+    unsigned char symbol;
+    unsigned char bits;      // state bits to read after emitting symbol
+    unsigned short base;     // next state = base + those bits
+};
+
+/**
+ * Read count bits at bit position 'position' of an LSB-first stream
+ */
+static inline unsigned int bitsAt(const unsigned char* stream, unsigned long long position, int count) {
+    if (count == 0) return 0;
+    unsigned long long first = position >> 3;
+    unsigned long long last = (position + count - 1) >> 3;
+    unsigned long long value = 0;
+    for (unsigned long long byte = last + 1; byte-- > first;) {
+        value = (value << 8) | stream[byte];
+    }
+    return (unsigned int)((value >> (position & 7)) & ((1u << count) - 1));
+}
+
+void fseEncode(const unsigned char* data, size_t length, const unsigned long long counts[256], string& out) {
+    unsigned long long total = length;
+    int tableLog = chooseTableLog(counts, total);
+    const unsigned int size = 1u << tableLog;
+
+    unsigned int normalized[256];
+    normalizeCounts(counts, total, tableLog, normalized);
+
+    // Header: table log, bitmap of present symbols, their normalized counts
+    out.push_back((char)tableLog);
+    unsigned char bitmap[32] = {0};
+    for (int i = 0; i < 256; i++) {
+        if (normalized[i] > 0) bitmap[i >> 3] |= (unsigned char)(1 << (i & 7));
+    }
+    out.append((const char*)bitmap, 32);
+    for (int i = 0; i < 256; i++) {
+        unsigned int value = normalized[i];
+        if (value == 0) continue;
+        while (value >= 0x80) {
+            out.push_back((char)((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char)value);
+    }
+
+    // Encoding table: for symbol s, occurrence k lives at state size + position
+    unsigned char* spread = new unsigned char[size];
+    spreadSymbols(normalized, tableLog, spread);
+    unsigned int start[256];
+    unsigned int cumulative = 0;
+    for (int i = 0; i < 256; i++) {
+        start[i] = cumulative;
+        cumulative += normalized[i];
+    }
+    unsigned short* nextState = new unsigned short[size];
+    unsigned int filled[256] = {0};
+    for (unsigned int position = 0; position < size; position++) {
+        unsigned char symbol = spread[position];
+        nextState[start[symbol] + filled[symbol]++] = (unsigned short)(size + position);
+    }
+
+    // Encode backwards; bits go out LSB-first
+    size_t stateAt = out.size();
+    appendU16(out, 0);
+    appendU32(out, 0);
+    unsigned int state = size;
+    unsigned long long accumulator = 0;
+    int pending = 0;
+    unsigned long long bitCount = 0;
+    for (size_t i = length; i-- > 0;) {
+        unsigned char symbol = data[i];
+        unsigned int n = normalized[symbol];
+        int bits = tableLog - highBit(n) + 1;
+        while ((state >> bits) < n) bits--;
+
+        accumulator |= (unsigned long long)(state & ((1u << bits) - 1)) << pending;
+        pending += bits;
+        bitCount += bits;
+        while (pending >= 8) {
+            out.push_back((char)(accumulator & 0xFF));
+            accumulator >>= 8;
+            pending -= 8;
+        }
+        state = nextState[start[symbol] + (state >> bits) - n];
+    }
+    if (pending > 0) {
+        out.push_back((char)(accumulator & 0xFF));
+    }
+
+    string trailer;
+    appendU16(trailer, state - size);
+    appendU32(trailer, (unsigned int)bitCount);
+    out.replace(stateAt, trailer.size(), trailer);
+
+    delete[] spread;
+    delete[] nextState;
+}
+
+bool fseDecode(const unsigned char* stream, size_t streamLength, unsigned int rawLength, size_t maxLength,
+               string& out) {
+    if (streamLength < 33 || rawLength > maxLength) {
+        return false;
+    }
+    int tableLog = stream[0];
+    if (tableLog < minTableLog || tableLog > maxTableLog) {
+        return false;
+    }
+    const unsigned int size = 1u << tableLog;
+
+    // Normalized counts
+    const unsigned char* bitmap = stream + 1;
+    size_t position = 33;
+    unsigned int normalized[256];
+    unsigned long long sum = 0;
+    for (int i = 0; i < 256; i++) {
+        normalized[i] = 0;
+        if (!(bitmap[i >> 3] & (1 << (i & 7)))) continue;
+        unsigned int value = 0;
+        int shift = 0;
+        while (true) {
+            if (position >= streamLength || shift > 14) return false;
+            unsigned char byte = stream[position++];
+            value |= (unsigned int)(byte & 0x7F) << shift;
+            shift += 7;
+            if (!(byte & 0x80)) break;
+        }
+        if (value == 0) return false;
+        normalized[i] = value;
+        sum += value;
+    }
+    if (sum != size || position + 6 > streamLength) {
+        return false;
+    }
+    unsigned int state = readU16(stream + position);
+    unsigned long long bitCount = readU32(stream + position + 2);
+    position += 6;
+    const unsigned char* bits = stream + position;
+    if (state >= size || (bitCount + 7) / 8 > streamLength - position) {
+        return false;
+    }
+
+    // Decoding table
+    unsigned char* spread = new unsigned char[size];
+    spreadSymbols(normalized, tableLog, spread);
+    FseDecodeEntry* table = new FseDecodeEntry[size];
+    unsigned int next[256];
+    for (int i = 0; i < 256; i++) {
+        next[i] = normalized[i];
+    }
+    for (unsigned int s = 0; s < size; s++) {
+        unsigned char symbol = spread[s];
+        unsigned int n = next[symbol]++;
+        int count = tableLog - highBit(n);
+        table[s].symbol = symbol;
+        table[s].bits = (unsigned char)count;
+        table[s].base = (unsigned short)((n << count) - size);
+    }
+    delete[] spread;
+
+    // Read the bits back to front
+    size_t begin = out.size();
+    out.resize(begin + rawLength);
+    unsigned char* dest = (unsigned char*)&out[begin];
+    bool ok = true;
+    for (unsigned int i = 0; i < rawLength; i++) {
+        const FseDecodeEntry& entry = table[state];
+        dest[i] = entry.symbol;
+        if (entry.bits > bitCount) {
+            ok = false;
+            break;
+        }
+        bitCount -= entry.bits;
+        state = entry.base + bitsAt(bits, bitCount, entry.bits);
+    }
+    delete[] table;
+
+    // The encoder started in state 0 (plus size) with no bits written
+    if (!ok || bitCount != 0 || state != 0) {
+        out.resize(begin);
+        return false;
+    }
+    return true;
+}
+
+double fseEstimateBytes(const unsigned long long counts[256]) {
+    unsigned long long total = 0;
+    int distinct = 0;
+    for (int i = 0; i < 256; i++) {
+        total += counts[i];
+        if (counts[i] > 0) distinct++;
+    }
+    if (total == 0) return 39;
+
+    int tableLog = chooseTableLog(counts, total);
+    unsigned int normalized[256];
+    normalizeCounts(counts, total, tableLog, normalized);
+    double bits = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] == 0) continue;
+        bits += (double)counts[i] * (tableLog - log2((double)normalized[i]));
+    }
+    return 1 + 32 + distinct * 1.5 + 6 + bits / 8;
+}
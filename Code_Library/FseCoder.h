@@ -0,0 +1,42 @@
+#ifndef MILESTONE_2_ADS_FSECODER_H
+#define MILESTONE_2_ADS_FSECODER_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/*
+  Table-based asymmetric numeral system (tANS, as in FSE)
+  An alternative entropy coder to Huffman for one block. Symbols cost a
+  fractional number of bits, so very skewed histograms compress better
+  than with whole-bit Huffman codes. It works from the same byte histogram
+  the Huffman path counts.
+
+  Encoded layout (after the block codec's mode byte and raw length):
+    [table log: 1][present-symbol bitmap: 32][normalized count per present symbol: LEB128]
+    [final state: 2][bit count: 4][state bits, LSB-first]
+  The encoder walks the block backwards, so the decoder reads the bits
+  back to front and emits the block in order.
+*/
+
+/**
+ * Encode a block with counts as its histogram and append the stream to out
+ */
+void fseEncode(const unsigned char* data, size_t length, const unsigned long long counts[256], string& out);
+
+/**
+ * Decode rawLength bytes from an FSE stream and append them to out
+ * Returns false if the stream is corrupt or rawLength exceeds maxLength.
+ * A symbol can cost 0 bits, so the stream size cannot bound rawLength;
+ * the caller's block size does.
+ */
+bool fseDecode(const unsigned char* stream, size_t streamLength, unsigned int rawLength, size_t maxLength,
+               string& out);
+
+/**
+ * Expected size in bytes of fseEncode's output for this histogram
+ */
+double fseEstimateBytes(const unsigned long long counts[256]);
+
+#endif //MILESTONE_2_ADS_FSECODER_H
@@ -1,19 +1,26 @@
 
 #include "HashMap.h"
+#include <new>
 
-HashMap::HashMap(int cap) {
+HashMap::HashMap(int cap, std::pmr::memory_resource* res) {
     capacity = cap;
     size = 0;
-    table = new HashNode[capacity];
+    resource = res ? res : std::pmr::get_default_resource();
+    table = static_cast<HashNode*>(resource->allocate(capacity * sizeof(HashNode), alignof(HashNode)));
+    for (int i = 0; i < capacity; i++) {
+        new (&table[i]) HashNode(); // same empty slots as new HashNode[capacity]
+    }
 }
 
 HashMap::~HashMap() {
-    delete[] table;
+    // HashNode is trivially destructible, only the storage is returned
+    resource->deallocate(table, capacity * sizeof(HashNode), alignof(HashNode));
 }
 
 int HashMap::hash(char key) {
 
-    return (int)key % capacity;
+    // unsigned so bytes 128-255 do not produce negative indices
+    return (int)(unsigned char)key % capacity;
 }
 
 int HashMap::findIndex(char key) {
@@ -4,6 +4,7 @@
 
 #include "DynamicArray.h"
 #include <iostream>
+#include <memory_resource>
 using namespace std;
 
 struct HashNode {
@@ -25,14 +26,18 @@ private:
     HashNode* table;
     int capacity;
     int size;
+    std::pmr::memory_resource* resource; // where the table comes from
 
     int hash(char key);
     int findIndex(char key);
 
 public:
-    HashMap(int cap = 256);
+    HashMap(int cap = 256, std::pmr::memory_resource* res = std::pmr::get_default_resource());
     ~HashMap();
 
+    HashMap(const HashMap&) = delete;            // owns a raw table
+    HashMap& operator=(const HashMap&) = delete;
+
     void insert(char key, int value);
     bool find(char key, int& value);
     bool remove(char key);
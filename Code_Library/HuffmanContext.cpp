@@ -0,0 +1,566 @@
+#include "HuffmanContext.h"
+#include "ByteOrder.h"
+#include "CpuDispatch.h"
+#include "BitIO.h"
+#include <algorithm>
+#include <cstring>
+
+// Room for the payload header, the largest tree and the packer's slack
+static const size_t headerRoom = 7 + ((2 * 256 - 1) + 256 * 8 + 7) / 8 + maxPackedSymbolBytes;
+
+static void storeU32(unsigned char* out, unsigned int value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+HuffmanContext::HuffmanContext(size_t expectedBytes)
+    : rootNode(-1), treeLength(0), payloadMode(BLOCK_HUFFMAN), decodedTreeLength(0), buffer(nullptr), capacity(0), used(0), counters() {
+    reserve(expectedBytes);
+}
+
+HuffmanContext::~HuffmanContext() {
+    delete[] buffer;
+}
+
+void HuffmanContext::reset() {
+    used = 0;
+    treeLength = 0;
+    decodedTreeLength = 0;
+}
+
+void HuffmanContext::reserve(size_t bytes) {
+    ensureCapacity(bytes + headerRoom);
+}
+
+bool HuffmanContext::ensureCapacity(size_t bytes) {
+    if (bytes <= capacity) {
+        return true;
+    }
+    size_t grown = max(bytes, capacity + capacity / 2);
+    unsigned char* larger = new unsigned char[grown];
+    delete[] buffer; // results do not survive a call, so nothing to copy
+    buffer = larger;
+    capacity = grown;
+    counters.allocations++;
+    counters.bufferBytes = capacity;
+    return true;
+}
+
+/**
+ * Two-queue Huffman construction over the sorted leaves: merged nodes come
+ * out in non-decreasing weight, so no heap and no node allocation is needed
+ */
+bool HuffmanContext::buildTree(size_t length) {
+    unsigned short order[256];
+    int symbols = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) order[symbols++] = (unsigned short)i;
+    }
+    if (symbols == 0 || length == 0) {
+        return false;
+    }
+    sort(order, order + symbols, [this](unsigned short a, unsigned short b) {
+        return counts[a] != counts[b] ? counts[a] < counts[b] : a < b;
+    });
+
+    if (symbols == 1) {
+        // A lone symbol still needs a one-bit code: pair it with a dummy leaf
+        nodes[0] = {{-1, -1}, (unsigned char)order[0]};
+        nodes[1] = {{-1, -1}, (unsigned char)(order[0] ^ 1)};
+        nodes[2] = {{0, 1}, 0};
+        rootNode = 2;
+        return true;
+    }
+
+    unsigned long long weights[maxNodes];
+    for (int i = 0; i < symbols; i++) {
+        nodes[i] = {{-1, -1}, (unsigned char)order[i]};
+        weights[i] = counts[order[i]];
+    }
+    int nextLeaf = 0;
+    int nextMerged = symbols;
+    int created = symbols;
+    auto takeSmallest = [&]() {
+        if (nextLeaf < symbols && (nextMerged == created || weights[nextLeaf] <= weights[nextMerged])) {
+            return nextLeaf++;
+        }
+        return nextMerged++;
+    };
+    while (created < 2 * symbols - 1) {
+        int left = takeSmallest();
+        int right = takeSmallest();
+        nodes[created] = {{(short)left, (short)right}, 0};
+        weights[created] = weights[left] + weights[right];
+        created++;
+    }
+    rootNode = created - 1;
+    return true;
+}
+
+/**
+ * Walk the tree once: assign the packed codes and write the serializeTree
+ * format (pre-order, 0 = internal, 1 + byte = leaf) into tree[]
+ */
+void HuffmanContext::assignCodes() {
+    memset(codeLengths, 0, sizeof(codeLengths));
+    int stackNode[maxNodes];
+    unsigned long long stackCode[maxNodes];
+    unsigned char stackDepth[maxNodes];
+    int top = 0;
+    stackNode[top] = rootNode;
+    stackCode[top] = 0;
+    stackDepth[top] = 0;
+    top++;
+
+    unsigned long long accumulator = 0;
+    int pending = 0;
+    treeLength = 0;
+    auto putBits = [&](unsigned int value, int count) {
+        accumulator = (accumulator << count) | value;
+        pending += count;
+        while (pending >= 8) {
+            pending -= 8;
+            tree[treeLength++] = (unsigned char)(accumulator >> pending);
+        }
+    };
+
+    while (top > 0) {
+        top--;
+        const TreeNode& node = nodes[stackNode[top]];
+        unsigned long long code = stackCode[top];
+        unsigned char depth = stackDepth[top];
+        if (node.child[0] < 0) {
+            putBits(0x100 | node.symbol, 9);
+            if (counts[node.symbol] > 0) { // not the dummy leaf
+                codeBits[node.symbol] = code;
+                codeLengths[node.symbol] = depth;
+            }
+            continue;
+        }
+        putBits(0, 1);
+        // Right pushed first so the left subtree is written first
+        for (int side = 1; side >= 0; side--) {
+            stackNode[top] = node.child[side];
+            stackCode[top] = (code << 1) | (unsigned long long)side;
+            stackDepth[top] = (unsigned char)(depth + 1);
+            top++;
+        }
+    }
+    if (pending > 0) {
+        tree[treeLength++] = (unsigned char)(accumulator << (8 - pending));
+    }
+}
+
+/**
+ * Writes payload bytes across the caller's output segments in order
+ */
+class SegmentCursor {
+private:
+    const MutableSegment* segments;
+    size_t count;
+    size_t index;
+    size_t offset;
+
+public:
+    size_t written;
+
+    SegmentCursor(const MutableSegment* list, size_t listCount)
+        : segments(list), count(listCount), index(0), offset(0), written(0) {}
+
+    // Free space in the current segment, nullptr when every segment is full
+    unsigned char* span(size_t& room) {
+        while (index < count && offset == segments[index].length) {
+            index++;
+            offset = 0;
+        }
+        room = index < count ? segments[index].length - offset : 0;
+        return index < count ? segments[index].data + offset : nullptr;
+    }
+
+    void advance(size_t bytes) {
+        offset += bytes;
+        written += bytes;
+    }
+
+    bool write(const unsigned char* data, size_t length) {
+        while (length > 0) {
+            size_t room;
+            unsigned char* target = span(room);
+            if (!target) return false;
+            size_t step = min(room, length);
+            memcpy(target, data, step);
+            advance(step);
+            data += step;
+            length -= step;
+        }
+        return true;
+    }
+};
+
+static size_t totalLength(const ByteSegment* segments, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += segments[i].length;
+    }
+    return total;
+}
+
+void HuffmanContext::finishCall(unsigned long long allocationsBefore) {
+    counters.lastCallAllocations = counters.allocations - allocationsBefore;
+}
+
+size_t HuffmanContext::planPayload(const ByteSegment* input, size_t inputCount, size_t length) {
+    if (inputCount == 1) {
+        countBytes(input[0].data, input[0].length, counts);
+    } else {
+        // Histogram every segment where it lies, no gather copy
+        unsigned long long part[256];
+        memset(counts, 0, sizeof(counts));
+        for (size_t s = 0; s < inputCount; s++) {
+            countBytes(input[s].data, input[s].length, part);
+            for (int i = 0; i < 256; i++) {
+                counts[i] += part[i];
+            }
+        }
+    }
+
+    payloadMode = BLOCK_HUFFMAN;
+    if (!buildTree(length)) {
+        treeLength = 0; // empty payload: no tree, no bits (the encodeBlock layout)
+        return 7;
+    }
+    assignCodes();
+
+    unsigned long long bitCount = 0;
+    int longest = 0;
+    for (int i = 0; i < 256; i++) {
+        bitCount += counts[i] * codeLengths[i];
+        longest = max(longest, (int)codeLengths[i]);
+    }
+    size_t huffmanBytes = 7 + treeLength + (size_t)((bitCount + 7) / 8);
+    if (huffmanBytes > 5 + length || longest > maxCodeLength) {
+        payloadMode = BLOCK_RAW; // never larger than stored, like encodeBlock
+        return 5 + length;
+    }
+    return huffmanBytes;
+}
+
+bool HuffmanContext::writePayload(const ByteSegment* input, size_t inputCount, size_t length,
+                                  const MutableSegment* output, size_t outputCount, size_t& written) {
+    SegmentCursor out(output, outputCount);
+    unsigned char header[7];
+    header[0] = payloadMode;
+    storeU32(header + 1, (unsigned int)length);
+    if (payloadMode == BLOCK_RAW) {
+        bool ok = out.write(header, 5);
+        for (size_t s = 0; ok && s < inputCount; s++) {
+            ok = out.write(input[s].data, input[s].length);
+        }
+        written = out.written;
+        return ok;
+    }
+
+    header[5] = (unsigned char)(treeLength >> 8);
+    header[6] = (unsigned char)treeLength;
+    if (!out.write(header, 7) || !out.write(tree, treeLength)) {
+        return false;
+    }
+    // Pack straight into each output segment; only a segment's last few
+    // bytes go through scratch, since packSymbols wants maxPackedSymbolBytes free
+    BitPackState state;
+    unsigned char scratch[4 * maxPackedSymbolBytes];
+    for (size_t s = 0; s < inputCount; s++) {
+        const unsigned char* data = input[s].data;
+        size_t remaining = input[s].length;
+        while (remaining > 0) {
+            size_t room, bytes, done;
+            unsigned char* target = out.span(room);
+            if (room >= maxPackedSymbolBytes) {
+                done = packSymbols(data, remaining, codeBits, codeLengths, state, target, room, bytes);
+                out.advance(bytes);
+            } else {
+                done = packSymbols(data, remaining, codeBits, codeLengths, state, scratch, sizeof(scratch), bytes);
+                if (!out.write(scratch, bytes)) return false;
+            }
+            data += done;
+            remaining -= done;
+        }
+    }
+    bool ok = out.write(scratch, flushPackedBits(state, scratch));
+    written = out.written;
+    return ok;
+}
+
+bool HuffmanContext::compress(const unsigned char* data, size_t length) {
+    ByteSegment input = {data, length};
+    return compress(&input, 1);
+}
+
+bool HuffmanContext::compress(const ByteSegment* input, size_t inputCount) {
+    unsigned long long before = counters.allocations;
+    counters.calls++;
+    used = 0;
+    size_t length = totalLength(input, inputCount);
+    bool ok = length <= 0xFFFFFFFFULL;
+    if (ok) {
+        size_t payloadBytes = planPayload(input, inputCount, length);
+        ensureCapacity(payloadBytes);
+        MutableSegment output = {buffer, capacity};
+        ok = writePayload(input, inputCount, length, &output, 1, used);
+    }
+    finishCall(before);
+    return ok;
+}
+
+bool HuffmanContext::compress(const ByteSegment* input, size_t inputCount, const MutableSegment* output,
+                              size_t outputCount, size_t& written) {
+    unsigned long long before = counters.allocations;
+    counters.calls++;
+    written = 0;
+    size_t length = totalLength(input, inputCount);
+    size_t room = 0;
+    for (size_t i = 0; i < outputCount; i++) {
+        room += output[i].length;
+    }
+    bool ok = length <= 0xFFFFFFFFULL;
+    if (ok) {
+        ok = planPayload(input, inputCount, length) <= room
+             && writePayload(input, inputCount, length, output, outputCount, written);
+    }
+    finishCall(before);
+    return ok;
+}
+
+/**
+ * Rebuild the decode tree from serializeTree bits; bytesUsed gets the
+ * whole bytes it spans. Rejects truncated, oversized or too deep trees.
+ */
+bool HuffmanContext::loadTree(const unsigned char* data, size_t length, size_t& bytesUsed) {
+    size_t position = 0;
+    size_t limit = length * 8;
+    auto readBits = [&](int count, unsigned int& value) {
+        if (position + count > limit) return false;
+        value = 0;
+        for (int i = 0; i < count; i++, position++) {
+            value = (value << 1) | ((data[position / 8] >> (7 - position % 8)) & 1);
+        }
+        return true;
+    };
+
+    // Slots still to fill, as (parent << 1 | side); the root has none
+    int slots[maxNodes];
+    unsigned char slotDepth[maxNodes];
+    int top = 0;
+    int created = 0;
+    int depth = 0;
+    do {
+        int slot = -1;
+        if (created > 0) {
+            top--;
+            slot = slots[top];
+            depth = slotDepth[top];
+        }
+        unsigned int flag, symbol = 0;
+        if (created == maxNodes || depth > maxCodeLength || !readBits(1, flag) || (flag && !readBits(8, symbol))) {
+            return false;
+        }
+        int index = created++;
+        decodeNodes[index] = {{-1, -1}, (unsigned char)symbol};
+        if (slot >= 0) decodeNodes[slot >> 1].child[slot & 1] = (short)index;
+        if (!flag) {
+            slots[top] = index << 1 | 1;
+            slotDepth[top++] = (unsigned char)(depth + 1);
+            slots[top] = index << 1;
+            slotDepth[top++] = (unsigned char)(depth + 1);
+        }
+    } while (top > 0);
+
+    bytesUsed = (position + 7) / 8;
+    return decodeNodes[0].child[0] >= 0; // a lone leaf is not a valid table (HuffmanTable::load)
+}
+
+/**
+ * Index the first lookupBits bits of every code: short codes decode in one
+ * lookup, longer ones continue from the node the prefix leads to
+ */
+void HuffmanContext::buildLookup() {
+    int stackNode[maxNodes];
+    unsigned int stackCode[maxNodes];
+    int stackDepth[maxNodes];
+    int top = 0;
+    stackNode[top] = 0;
+    stackCode[top] = 0;
+    stackDepth[top++] = 0;
+    while (top > 0) {
+        top--;
+        int index = stackNode[top];
+        unsigned int code = stackCode[top];
+        int depth = stackDepth[top];
+        const TreeNode& node = decodeNodes[index];
+        if (node.child[0] < 0) {
+            unsigned int first = code << (lookupBits - depth);
+            unsigned int span = 1u << (lookupBits - depth);
+            for (unsigned int i = 0; i < span; i++) {
+                lookup[first + i] = {node.symbol, (unsigned char)depth};
+            }
+        } else if (depth == lookupBits) {
+            lookup[code] = {(unsigned short)index, 0};
+        } else {
+            for (int side = 0; side < 2; side++) {
+                stackNode[top] = node.child[side];
+                stackCode[top] = code << 1 | (unsigned int)side;
+                stackDepth[top++] = depth + 1;
+            }
+        }
+    }
+    counters.tableRebuilds++;
+}
+
+template <class Source>
+bool HuffmanContext::readHeader(Source& source, size_t payloadLength, unsigned char& mode, size_t& rawLength) {
+    unsigned char header[7];
+    for (int i = 0; i < 5; i++) {
+        if (!source.next(header[i])) return false;
+    }
+    mode = header[0];
+    rawLength = readU32(header + 1);
+    if (mode == BLOCK_RAW) {
+        return payloadLength - 5 == rawLength;
+    }
+    if (mode != BLOCK_HUFFMAN || !source.next(header[5]) || !source.next(header[6])) {
+        return false;
+    }
+    size_t length = readU16(header + 5);
+    if (rawLength == 0) {
+        return length == 0;
+    }
+    if (length == 0 || length > (size_t)maxTreeBytes || 7 + length > payloadLength) {
+        return false;
+    }
+    // Every code is at least one bit: bound the untrusted size before anything is allocated for it
+    if (rawLength > (payloadLength - 7 - length) * 8) {
+        return false;
+    }
+
+    unsigned char treeData[maxTreeBytes];
+    for (size_t i = 0; i < length; i++) {
+        if (!source.next(treeData[i])) return false;
+    }
+    if (length == decodedTreeLength && memcmp(treeData, decodedTree, length) == 0) {
+        return true; // same tree as last time: keep the lookup table
+    }
+    size_t bytesUsed;
+    decodedTreeLength = 0;
+    if (!loadTree(treeData, length, bytesUsed) || bytesUsed != length) {
+        return false;
+    }
+    buildLookup();
+    memcpy(decodedTree, treeData, length);
+    decodedTreeLength = length;
+    return true;
+}
+
+template <class Source, class Sink>
+bool HuffmanContext::decodeBody(Source& source, unsigned char mode, size_t rawLength, Sink& out) {
+    unsigned char byte;
+    if (mode == BLOCK_RAW) {
+        for (size_t i = 0; i < rawLength; i++) {
+            if (!source.next(byte)) return false;
+            out.put(byte);
+        }
+        return out.flush();
+    }
+    if (rawLength == 0) {
+        return true;
+    }
+
+    unsigned long long window = 0;  // next bits, left-aligned
+    int available = 0;
+    auto refill = [&]() {
+        while (available <= 56 && source.next(byte)) {
+            window |= (unsigned long long)byte << (56 - available);
+            available += 8;
+        }
+    };
+    auto consume = [&](int count) {
+        window <<= count;
+        available -= count;
+    };
+
+    for (size_t i = 0; i < rawLength; i++) {
+        refill();
+        const LookupEntry& entry = lookup[window >> (64 - lookupBits)];
+        if (entry.length > 0) {
+            if (entry.length > available) return false; // the code runs past the data
+            consume(entry.length);
+            out.put((unsigned char)entry.value);
+            continue;
+        }
+        if (available < lookupBits) return false;
+        consume(lookupBits);
+        int node = entry.value;
+        while (decodeNodes[node].child[0] >= 0) {
+            if (available == 0) {
+                refill();
+                if (available == 0) return false;
+            }
+            node = decodeNodes[node].child[window >> 63];
+            consume(1);
+        }
+        out.put(decodeNodes[node].symbol);
+    }
+    // Only the padding of the last byte may be left
+    return available < 8 && !source.next(byte) && out.flush();
+}
+
+template <class Source>
+bool HuffmanContext::decodeToBuffer(Source& source, size_t payloadLength) {
+    unsigned long long before = counters.allocations;
+    counters.calls++;
+    used = 0;
+    unsigned char mode;
+    size_t rawLength;
+    bool ok = readHeader(source, payloadLength, mode, rawLength);
+    if (ok) {
+        ensureCapacity(rawLength);
+        MemorySpanSink sink(buffer, rawLength);
+        ok = decodeBody(source, mode, rawLength, sink);
+        if (ok) used = rawLength;
+    }
+    finishCall(before);
+    return ok;
+}
+
+bool HuffmanContext::decompress(const unsigned char* payload, size_t payloadLength) {
+    MemorySpanSource source(payload, payloadLength);
+    return decodeToBuffer(source, payloadLength);
+}
+
+bool HuffmanContext::decompress(const ByteSegment* payload, size_t payloadCount) {
+    SegmentSource source(payload, payloadCount);
+    return decodeToBuffer(source, totalLength(payload, payloadCount));
+}
+
+bool HuffmanContext::decompress(const ByteSegment* payload, size_t payloadCount, const MutableSegment* output,
+                                size_t outputCount, size_t& written) {
+    unsigned long long before = counters.allocations;
+    counters.calls++;
+    written = 0;
+    SegmentSource source(payload, payloadCount);
+    unsigned char mode;
+    size_t rawLength;
+    size_t room = 0;
+    for (size_t i = 0; i < outputCount; i++) {
+        room += output[i].length;
+    }
+    bool ok = readHeader(source, totalLength(payload, payloadCount), mode, rawLength) && rawLength <= room;
+    if (ok) {
+        SegmentSink sink(output, outputCount);
+        ok = decodeBody(source, mode, rawLength, sink);
+        if (ok) written = rawLength;
+    }
+    finishCall(before);
+    return ok;
+}
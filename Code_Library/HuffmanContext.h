@@ -0,0 +1,157 @@
+#ifndef MILESTONE_2_ADS_HUFFMANCONTEXT_H
+#define MILESTONE_2_ADS_HUFFMANCONTEXT_H
+
+#include <cstddef>
+#include <string>
+#include "BitIO.h"
+#include "BlockCodec.h"
+
+using namespace std;
+
+/*
+  Reusable compression context
+  For streams of many small payloads (messages, records) the per-call setup
+  of compressFile / encodeBlock dominates: a HashMap, a node tree, 256 code
+  strings and stream objects are built and torn down every time.
+  HuffmanContext keeps all of that in fixed arrays (histogram, an index-based
+  tree, packed codes, serialized tree, decode lookup table) plus one output
+  buffer, so once the buffer has grown to the largest payload seen, compress
+  and decompress do no heap allocation at all.
+
+  Input and output may also be lists of segments (pointer, length), e.g. a
+  network message held as a chain of buffers: the histogram and the packer
+  read each input segment where it lies and the payload is written straight
+  into the output segments, so no gather copy is needed either way.
+
+  Payloads are ordinary block codec payloads (BLOCK_HUFFMAN, or BLOCK_RAW
+  when coding does not pay), so decodeBlock reads them and decompress reads
+  the Huffman and raw payloads encodeBlock writes. A context is not thread
+  safe; use one per thread.
+*/
+
+struct ContextStats {
+    unsigned long long calls = 0;           // compress + decompress calls
+    unsigned long long allocations = 0;     // heap allocations made by the context, in total
+    unsigned long long lastCallAllocations = 0;
+    unsigned long long tableRebuilds = 0;   // decode tables built (a repeated tree reuses the last one)
+    size_t bufferBytes = 0;                 // current output buffer capacity
+};
+
+class HuffmanContext {
+public:
+    static const int lookupBits = 11;       // decode table index width
+
+    /**
+     * Preallocate for payloads of up to expectedBytes
+     */
+    explicit HuffmanContext(size_t expectedBytes = 64 * 1024);
+    ~HuffmanContext();
+
+    HuffmanContext(const HuffmanContext&) = delete;
+    HuffmanContext& operator=(const HuffmanContext&) = delete;
+
+    /**
+     * Encode data; the payload is in output() / outputSize() until the next call
+     */
+    bool compress(const unsigned char* data, size_t length);
+
+    /**
+     * Encode a message held in several segments, read where they lie (no gather copy)
+     */
+    bool compress(const ByteSegment* input, size_t inputCount);
+
+    /**
+     * Encode straight into the caller's output segments, filled in order;
+     * false if they are too small. written gets the payload size.
+     */
+    bool compress(const ByteSegment* input, size_t inputCount, const MutableSegment* output, size_t outputCount,
+                  size_t& written);
+
+    /**
+     * Decode a BLOCK_HUFFMAN or BLOCK_RAW payload into output(); false if it
+     * is corrupt or uses another mode (decodeBlock handles those)
+     */
+    bool decompress(const unsigned char* payload, size_t payloadLength);
+    bool decompress(const ByteSegment* payload, size_t payloadCount);
+
+    /**
+     * Decode a segmented payload into the caller's output segments; false if
+     * they are too small. written gets the decoded size.
+     */
+    bool decompress(const ByteSegment* payload, size_t payloadCount, const MutableSegment* output,
+                    size_t outputCount, size_t& written);
+
+    const unsigned char* output() const { return buffer; }
+    size_t outputSize() const { return used; }
+
+    /**
+     * Forget the last result and cached decode table; keeps every buffer
+     */
+    void reset();
+
+    /**
+     * Grow the output buffer now so later calls up to this size do not allocate
+     */
+    void reserve(size_t bytes);
+
+    const ContextStats& stats() const { return counters; }
+    unsigned long long lastCallAllocations() const { return counters.lastCallAllocations; }
+
+private:
+    static const int maxNodes = 2 * 256 - 1;
+    static const int maxTreeBytes = (maxNodes + 256 * 8 + 7) / 8;  // 1 bit per node + 8 per leaf
+    static const int maxCodeLength = 64;                           // longest code one packed word holds
+
+    // Encoder and decoder tree: leaves have child[0] < 0 and a symbol
+    struct TreeNode {
+        short child[2];
+        unsigned char symbol;
+    };
+
+    struct LookupEntry {
+        unsigned short value;       // symbol, or the node to continue from when length == 0
+        unsigned char length;       // code length, 0 for codes longer than lookupBits
+    };
+
+    unsigned long long counts[256];
+    TreeNode nodes[maxNodes];
+    int rootNode;
+    unsigned long long codeBits[256];
+    unsigned char codeLengths[256];
+    unsigned char tree[maxTreeBytes];
+    size_t treeLength;
+    unsigned char payloadMode;                 // BLOCK_HUFFMAN or BLOCK_RAW for the payload being written
+
+    TreeNode decodeNodes[maxNodes];            // root at 0
+    unsigned char decodedTree[maxTreeBytes];   // tree the lookup table was built for
+    size_t decodedTreeLength;
+    LookupEntry lookup[1 << lookupBits];
+
+    unsigned char* buffer;
+    size_t capacity;
+    size_t used;
+    ContextStats counters;
+
+    bool ensureCapacity(size_t bytes);
+    bool buildTree(size_t length);
+    void assignCodes();
+    bool loadTree(const unsigned char* data, size_t length, size_t& bytesUsed);
+    void buildLookup();
+    void finishCall(unsigned long long allocationsBefore);
+
+    /**
+     * Histogram and tree for the input; returns the payload size and sets payloadMode
+     */
+    size_t planPayload(const ByteSegment* input, size_t inputCount, size_t length);
+    bool writePayload(const ByteSegment* input, size_t inputCount, size_t length, const MutableSegment* output,
+                      size_t outputCount, size_t& written);
+
+    template <class Source>
+    bool readHeader(Source& source, size_t payloadLength, unsigned char& mode, size_t& rawLength);
+    template <class Source>
+    bool decodeToBuffer(Source& source, size_t payloadLength);
+    template <class Source, class Sink>
+    bool decodeBody(Source& source, unsigned char mode, size_t rawLength, Sink& out);
+};
+
+#endif //MILESTONE_2_ADS_HUFFMANCONTEXT_H
@@ -0,0 +1,152 @@
+#include "HuffmanTable.h"
+#include "HuffmanZipper.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+HuffmanTable::HuffmanTable() {
+    root = nullptr;
+    for (int i = 0; i < 256; i++) {
+        bits[i] = 0;
+        lengths[i] = 0;
+    }
+}
+
+HuffmanTable::~HuffmanTable() {
+    delete root;
+}
+
+/**
+ * Fill bits/lengths and the serialized form from the current tree
+ */
+void HuffmanTable::buildCodes() {
+    string codes[256];
+    generateCodes(root, "", codes);
+    packCodes(codes, bits, lengths);
+
+    stringstream treeStream(ios::in | ios::out | ios::binary);
+    {
+        BitStream bs(&treeStream, true);
+        serializeTree(root, bs);
+        bs.pushRemainingBits();
+    }
+    serialized = treeStream.str();
+}
+
+bool HuffmanTable::buildFromCounts(const unsigned long long counts[256], bool coverAllSymbols) {
+    delete root;
+    root = nullptr;
+
+    // HashMap holds int counts: scale huge histograms down, keeping every seen symbol
+    unsigned long long largest = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > largest) largest = counts[i];
+    }
+    unsigned long long divisor = largest / (INT_MAX / 512) + 1;
+
+    HashMap freqMap(256);
+    for (int i = 0; i < 256; i++) {
+        unsigned long long count = counts[i];
+        if (count > 0) {
+            if (divisor > 1) count = count / divisor + 1;
+        } else if (coverAllSymbols) {
+            count = 1;
+        }
+        if (count > 0) {
+            freqMap.insert((char)i, (int)count);
+        }
+    }
+
+    root = buildHuffmanTree(freqMap);
+    if (!root) {
+        return false;
+    }
+    buildCodes();
+    return true;
+}
+
+bool HuffmanTable::load(const unsigned char* data, size_t length) {
+    delete root;
+    root = nullptr;
+
+    stringstream treeStream(string((const char*)data, length), ios::in | ios::binary);
+    BitStream bs(&treeStream, false);
+    root = deserializeTree(bs);
+    if (!root || root->isLeaf()) {
+        delete root;
+        root = nullptr;
+        return false;
+    }
+    buildCodes();
+    return true;
+}
+
+bool HuffmanTable::covers(const unsigned long long counts[256]) const {
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0 && lengths[i] == 0) return false;
+    }
+    return true;
+}
+
+unsigned long long HuffmanTable::encodedBits(const unsigned long long counts[256]) const {
+    unsigned long long total = 0;
+    for (int i = 0; i < 256; i++) {
+        total += counts[i] * lengths[i];
+    }
+    return total;
+}
+
+/**
+ * Histogram over four tables fed from 8-byte loads: runs of one byte no
+ * longer wait on the increment of the same counter. Plain C++ at every
+ * kernel level (see CpuDispatch.h).
+ */
+void countBytes(const unsigned char* data, size_t length, unsigned long long counts[256]) {
+    unsigned int tables[4][256];
+    for (int i = 0; i < 256; i++) {
+        counts[i] = 0;
+    }
+    size_t i = 0;
+    while (i < length) {
+        // 32-bit counters: fold into counts before any of them can overflow
+        size_t stop = length - i > ((size_t)1 << 30) ? i + ((size_t)1 << 30) : length;
+        for (int t = 0; t < 4; t++) {
+            for (int s = 0; s < 256; s++) tables[t][s] = 0;
+        }
+        for (; i + 8 <= stop; i += 8) {
+            unsigned long long word;
+            memcpy(&word, data + i, 8);
+            tables[0][word & 0xFF]++;
+            tables[1][(word >> 8) & 0xFF]++;
+            tables[2][(word >> 16) & 0xFF]++;
+            tables[3][(word >> 24) & 0xFF]++;
+            tables[0][(word >> 32) & 0xFF]++;
+            tables[1][(word >> 40) & 0xFF]++;
+            tables[2][(word >> 48) & 0xFF]++;
+            tables[3][word >> 56]++;
+        }
+        for (; i < stop; i++) {
+            tables[0][data[i]]++;
+        }
+        for (int s = 0; s < 256; s++) {
+            counts[s] += (unsigned long long)tables[0][s] + tables[1][s] + tables[2][s] + tables[3][s];
+        }
+    }
+}
+
+double entropyBits(const unsigned long long counts[256]) {
+    unsigned long long total = 0;
+    for (int i = 0; i < 256; i++) {
+        total += counts[i];
+    }
+    if (total == 0) return 0;
+
+    double bitsTotal = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] == 0) continue;
+        double p = (double)counts[i] / (double)total;
+        bitsTotal -= (double)counts[i] * log2(p);
+    }
+    return bitsTotal;
+}
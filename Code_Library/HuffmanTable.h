@@ -0,0 +1,73 @@
+#ifndef MILESTONE_2_ADS_HUFFMANTABLE_H
+#define MILESTONE_2_ADS_HUFFMANTABLE_H
+
+#include <string>
+#include "HuffmanNode.h"
+
+using namespace std;
+
+/*
+  HuffmanTable class
+  A built Huffman code ready for encoding and decoding: the tree, the packed
+  code for every byte and the serialized tree (serializeTree format).
+  Used when one table serves many blocks (sampled or preset tables) and
+  inside the block codec for per-block tables.
+*/
+class HuffmanTable {
+private:
+    HuffmanNode* root;
+    unsigned long long bits[256];   // code bits, MSB first
+    unsigned char lengths[256];     // code length in bits (0 = symbol has no code)
+    string serialized;              // tree in serializeTree format, byte padded
+
+    void buildCodes();
+
+public:
+    HuffmanTable();
+    ~HuffmanTable();
+
+    HuffmanTable(const HuffmanTable&) = delete;
+    HuffmanTable& operator=(const HuffmanTable&) = delete;
+
+    /**
+     * Build from byte counts. With coverAllSymbols every byte gets a code,
+     * even ones that never appeared (needed when the counts are a sample).
+     * Returns false if there is nothing to build from.
+     */
+    bool buildFromCounts(const unsigned long long counts[256], bool coverAllSymbols);
+
+    /**
+     * Rebuild from a serialized tree, false if the bytes are not a valid tree
+     */
+    bool load(const unsigned char* data, size_t length);
+
+    bool empty() const { return root == nullptr; }
+    HuffmanNode* getRoot() const { return root; }
+    const string& getSerialized() const { return serialized; }
+    unsigned long long codeBits(unsigned char symbol) const { return bits[symbol]; }
+    unsigned char codeLength(unsigned char symbol) const { return lengths[symbol]; }
+    const unsigned long long* getBits() const { return bits; }
+    const unsigned char* getLengths() const { return lengths; }
+
+    /**
+     * True if every symbol with a non-zero count has a code
+     */
+    bool covers(const unsigned long long counts[256]) const;
+
+    /**
+     * Encoded size in bits of data with these counts (ignores symbols without a code)
+     */
+    unsigned long long encodedBits(const unsigned long long counts[256]) const;
+};
+
+/**
+ * Byte histogram of a memory buffer
+ */
+void countBytes(const unsigned char* data, size_t length, unsigned long long counts[256]);
+
+/**
+ * Shannon entropy of a histogram in bits (the lower bound for any order-0 code)
+ */
+double entropyBits(const unsigned long long counts[256]);
+
+#endif //MILESTONE_2_ADS_HUFFMANTABLE_H
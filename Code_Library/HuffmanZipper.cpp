@@ -2,40 +2,86 @@
 #include "HuffmanZipper.h"
 #include "MiniHeap.h"
 #include <iostream>
+#include <filesystem>
 #include <fstream>
 #include <string>
+#include <sstream>
+#include "IoBackend.h"
+#include "MemoryResource.h"
+#include "HuffmanTable.h"
+#include "BitIO.h"
+#include "DecodeTable.h"
+#include "DecodeTableCache.h"
+#include "JobControl.h"
+#include "CpuDispatch.h"
 
 using namespace std;
 
+/**
+ * Add an array of byte counts to the frequency map
+ */
+static void addCounts(const unsigned long long counts[256], HashMap& freqMap) {
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] == 0) continue;
+        int currentFreq = 0;
+        char charKey = (char)i;  // Explicit cast
+        freqMap.find(charKey, currentFreq);
+        freqMap.insert(charKey, currentFreq + (int)counts[i]);
+    }
+}
+
 /**
  * Build frequency map using HashMap
+ * The file is read in large pieces through the I/O backend and counted
+ * into a plain array, so the map sees one insert per symbol
  */
-void buildFrequencyMap(const string& filename, HashMap& freqMap) {
-    ifstream file(filename, ios::binary);
-    if (!file.is_open()) {
+static bool countFile(const string& filename, HashMap& freqMap, JobTracker* tracker,
+                      const IoOptions& io = IoOptions()) {
+    unique_ptr<SequentialReader> reader = openSequentialReader(filename, io);
+    if (!reader) {
         cerr << "Error: Cannot open file " << filename << endl;
-        return;
+        return false;
     }
 
-    unsigned char ch;
-    while (file.get((char&)ch)) {
-        int currentFreq = 0;
-        char charKey = (char)ch;  // Explicit cast
-        if (freqMap.find(charKey, currentFreq)) {
-            freqMap.insert(charKey, currentFreq + 1);
-        } else {
-            freqMap.insert(charKey, 1);
+    unsigned long long counts[256] = {0};
+    const unsigned char* data;
+    long long length;
+    while ((length = reader->next(data)) > 0) {
+        for (long long i = 0; i < length; i++) {
+            counts[data[i]]++;
         }
+        if (tracker && !tracker->advance((unsigned long long)length)) {
+            return false;
+        }
+    }
+    if (length < 0) {
+        cerr << "Error: Cannot read file " << filename << endl;
     }
 
-    file.close();
+    addCounts(counts, freqMap);
+    return length == 0;
+}
+
+void buildFrequencyMap(const string& filename, HashMap& freqMap) {
+    countFile(filename, freqMap, nullptr);
+}
+
+/**
+ * Build frequency map from memory
+ */
+void buildFrequencyMap(const unsigned char* data, size_t length, HashMap& freqMap) {
+    unsigned long long counts[256] = {0};
+    for (size_t i = 0; i < length; i++) {
+        counts[data[i]]++;
+    }
+    addCounts(counts, freqMap);
 }
 
 /**
  * Build Huffman tree from HashMap
  */
-HuffmanNode* buildHuffmanTree(HashMap& freqMap) {
-    MinHeap heap;
+HuffmanNode* buildHuffmanTree(HashMap& freqMap, std::pmr::memory_resource* resource) {
+    MinHeap heap(resource);
 
     // Iterate through all possible byte values
     for (int i = 0; i < 256; i++) {
@@ -115,60 +161,208 @@ void serializeTree(HuffmanNode* root, BitStream& bs) {
  * Deserialize Huffman tree from compressed file
  * Reconstruct tree from pre-order traversal
  */
-HuffmanNode* deserializeTree(BitStream& bs) {
+static HuffmanNode* deserializeTree(BitStream& bs, int depth) {
+    // A valid tree over 256 symbols is never deeper than 255 levels
+    if (depth > 256) {
+        return nullptr;
+    }
+
     bool isLeaf = bs.readBit();
+    if (!bs.hasMoreBits()) {
+        return nullptr; // ran past the end of the stream
+    }
 
     if (isLeaf) {
         unsigned char ch = bs.readByte();
+        if (!bs.hasMoreBits()) {
+            return nullptr;
+        }
         return new HuffmanNode(ch, 0);
     } else {
-        HuffmanNode* left = deserializeTree(bs);
-        HuffmanNode* right = deserializeTree(bs);
+        HuffmanNode* left = deserializeTree(bs, depth + 1);
+        if (!left) {
+            return nullptr;
+        }
+        HuffmanNode* right = deserializeTree(bs, depth + 1);
+        if (!right) {
+            delete left;
+            return nullptr;
+        }
         return new HuffmanNode(0, left, right);
     }
 }
 
+HuffmanNode* deserializeTree(BitStream& bs) {
+    return deserializeTree(bs, 0);
+}
+
 /**
- * Compress a file using Huffman encoding
+ * Turn the string codes from generateCodes into packed bit patterns
+ * so encoding is one shift/or per symbol instead of one call per bit
  */
-void compressFile(const string& inputFile, const string& outputFile) {
-    cout << "Compressing " << inputFile << "..." << endl;
+void packCodes(const string codes[256], unsigned long long bits[256], unsigned char lengths[256]) {
+    for (int i = 0; i < 256; i++) {
+        bits[i] = 0;
+        lengths[i] = (unsigned char)codes[i].size();
+        for (char bit : codes[i]) {
+            bits[i] = (bits[i] << 1) | (bit == '1' ? 1 : 0);
+        }
+    }
+}
 
-    // Step 1: Build frequency map using HashMap
-    HashMap freqMap(256);
-    buildFrequencyMap(inputFile, freqMap);
+// Size of the staging buffer between the bit packer and the writer
+static const size_t outputChunkSize = 1024 * 1024;
 
-    // Step 2: Build Huffman tree
-    HuffmanNode* root = buildHuffmanTree(freqMap);
-    if (!root) {
-        cerr << "Error: Empty file or cannot build tree" << endl;
-        return;
+// Charged for the tree nodes and code strings of one job
+static const size_t treeScratchBytes = 128 * 1024;
+
+/**
+ * Shrink the I/O buffers until a job's reader, writer and fixedBytes fit
+ * memoryLimit (0 for none); false, after reporting it, if they never do
+ */
+static bool planIoMemory(size_t memoryLimit, size_t fixedBytes, IoOptions& io) {
+    while (memoryLimit > 0 && 2 * ioBufferBytes(io) + fixedBytes > memoryLimit) {
+        if (!shrinkIoBuffers(io)) {
+            cerr << "Error: Memory limit of " << memoryLimit << " bytes is too small" << endl;
+            return false;
+        }
     }
+    return true;
+}
 
-    // Step 3: Generate codes (keep array for fast lookup during encoding)
-    string codes[256];
-    for (int i = 0; i < 256; i++) {
-        codes[i] = "";
+/**
+ * Bit sink that stages bytes and hands them to a SequentialWriter in large chunks
+ */
+class StagingSink {
+private:
+    SequentialWriter& out;
+    unsigned char* staging;
+    size_t staged;
+    bool ok;
+
+    void drain() {
+        ok = ok && out.write(staging, staged);
+        staged = 0;
     }
-    generateCodes(root, "", codes);
 
-    // Step 4: Write compressed file
-    fstream outFile(outputFile, ios::out | ios::binary);
-    if (!outFile.is_open()) {
-        cerr << "Error: Cannot create output file" << endl;
-        delete root;
-        return;
+public:
+    explicit StagingSink(SequentialWriter& writer) : out(writer), staged(0), ok(true) {
+        staging = new unsigned char[outputChunkSize];
     }
+    ~StagingSink() { delete[] staging; }
 
-    BitStream bs(&outFile, true); // Write mode
+    void put(unsigned char byte) {
+        staging[staged++] = byte;
+        if (staged == outputChunkSize) drain();
+    }
+    bool flush() {
+        drain();
+        return ok;
+    }
+};
 
-    // Write original file size (for decompression verification)
-    ifstream inFile(inputFile, ios::binary);
-    inFile.seekg(0, ios::end);
-    unsigned int fileSize = inFile.tellg();
-    inFile.seekg(0, ios::beg);
+/**
+ * Packs codes with the dispatched kernel (see CpuDispatch.h) into a staging
+ * buffer that goes to a SequentialWriter in large chunks
+ */
+class PackedCodeWriter {
+private:
+    SequentialWriter& out;
+    unsigned char* staging;
+    size_t staged;
+    BitPackState state;
+    bool ok;
+
+    void drain() {
+        ok = ok && out.write(staging, staged);
+        staged = 0;
+    }
 
-    // Write file size as 4 bytes
+public:
+    /**
+     * Continue after the bits of a partially filled byte
+     */
+    PackedCodeWriter(SequentialWriter& writer, unsigned char partialByte, int bits)
+        : out(writer), staged(0), ok(true) {
+        staging = new unsigned char[outputChunkSize];
+        state.pending = bits;
+        state.accumulator = bits > 0 ? (partialByte >> (8 - bits)) : 0;
+    }
+    ~PackedCodeWriter() { delete[] staging; }
+
+    void encode(const unsigned char* data, size_t length, const unsigned long long bits[256],
+                const unsigned char lengths[256]) {
+        size_t done = 0;
+        while (done < length) {
+            size_t stored;
+            done += packSymbols(data + done, length - done, bits, lengths, state, staging + staged,
+                                outputChunkSize - staged, stored);
+            staged += stored;
+            if (outputChunkSize - staged < maxPackedSymbolBytes) drain();
+        }
+    }
+
+    /**
+     * Pad the last byte with zeros and write everything staged
+     */
+    bool flush() {
+        staged += flushPackedBits(state, staging + staged); // drain() left room for it
+        drain();
+        return ok;
+    }
+};
+
+/**
+ * Bit source over a SequentialReader, starting with bytes already read
+ */
+class SequentialSource {
+private:
+    SequentialReader& in;
+    const unsigned char* data;
+    long long length;
+    long long position;
+    bool error;
+
+public:
+    SequentialSource(SequentialReader& reader, const unsigned char* first, long long firstLength)
+        : in(reader), data(first), length(firstLength), position(0), error(false) {}
+
+    bool next(unsigned char& byte) {
+        if (position == length) {
+            length = in.next(data);
+            position = 0;
+            if (length <= 0) {
+                error = length < 0;
+                length = 0;
+                return false;
+            }
+        }
+        byte = data[position++];
+        return true;
+    }
+    bool failed() const { return error; }
+};
+
+/**
+ * Write a .huf file: size, tree, then the code of every input byte.
+ * If seenCounts is given, the byte histogram is counted while encoding.
+ */
+static bool writeEncodedFile(const string& inputFile, const string& outputFile, HuffmanNode* root,
+                             unsigned int fileSize, const unsigned long long bits[256],
+                             const unsigned char lengths[256], unsigned long long* seenCounts,
+                             JobTracker* tracker = nullptr, const IoOptions& io = IoOptions()) {
+    unique_ptr<SequentialReader> inFile = openSequentialReader(inputFile, io);
+    unique_ptr<SequentialWriter> outFile = openSequentialWriter(outputFile, io);
+    if (!inFile || !outFile) {
+        cerr << "Error: Cannot create output file" << endl;
+        return false;
+    }
+
+    // Header (original size + tree) goes through BitStream into memory
+    stringstream header(ios::in | ios::out | ios::binary);
+    BitStream bs(&header, true); // Write mode
+
+    // Write file size as 4 bytes (for decompression verification)
     for (int i = 3; i >= 0; i--) {
         bs.writeByte((fileSize >> (i * 8)) & 0xFF);
     }
@@ -176,102 +370,330 @@ void compressFile(const string& inputFile, const string& outputFile) {
     // Serialize tree structure
     serializeTree(root, bs);
 
-    // Encode file content
-    unsigned char ch;
-    while (inFile.get((char&)ch)) {
-        string code = codes[ch];
-        for (char bit : code) {
-            bs.writeBit(bit == '1');
+    string headerBytes = header.str();
+    outFile->write((const unsigned char*)headerBytes.data(), headerBytes.size());
+
+    // Encode file content, continuing from the header's unfinished byte
+    PackedCodeWriter writer(*outFile, bs.getPendingByte(), bs.getBitPosition());
+    bs.resetStream(); // the bits now live in the writer
+
+    if (seenCounts) {
+        for (int i = 0; i < 256; i++) seenCounts[i] = 0;
+    }
+
+    const unsigned char* data;
+    long long length;
+    while ((length = inFile->next(data)) > 0) {
+        writer.encode(data, (size_t)length, bits, lengths);
+        if (seenCounts) {
+            for (long long i = 0; i < length; i++) seenCounts[data[i]]++;
         }
+        if (tracker && !tracker->advance((unsigned long long)length)) {
+            return false;
+        }
+    }
+
+    bool ok = length == 0 && writer.flush() && outFile->finish();
+    if (!ok) {
+        cerr << "Error: Failed writing " << outputFile << endl;
+    }
+    return ok;
+}
+
+/**
+ * Compress a file using Huffman encoding
+ */
+void compressFile(const string& inputFile, const string& outputFile, std::pmr::memory_resource* resource) {
+    compressFile(inputFile, outputFile, JobControl(), resource);
+}
+
+bool compressFile(const string& inputFile, const string& outputFile, const JobControl& control,
+                  std::pmr::memory_resource* resource, size_t memoryLimit) {
+    cout << "Compressing " << inputFile << "..." << endl;
+
+    // One reader at a time plus the writer, the staging buffer and the tree
+    IoOptions io;
+    if (!planIoMemory(memoryLimit, outputChunkSize + treeScratchBytes, io)) {
+        return false;
     }
+    MemoryBudget budget(memoryLimit);
+    BudgetResource tracked(budget, resource); // the frequency map and heap
+    budget.charge(2 * ioBufferBytes(io) + outputChunkSize + treeScratchBytes);
 
-    bs.pushRemainingBits(); // Flush remaining bits
+    // The file is read twice (counting, then encoding) and both passes count as progress
+    std::error_code ec;
+    unsigned long long inputSize = std::filesystem::file_size(inputFile, ec);
+    JobTracker tracker(&control, ec ? 0 : 2 * inputSize);
 
-    inFile.close();
-    outFile.close();
+    // Step 1: Build frequency map using HashMap
+    HashMap freqMap(256, &tracked);
+    if (!countFile(inputFile, freqMap, &tracker, io) && tracker.cancelled()) {
+        cerr << "Compression of " << inputFile << " cancelled" << endl;
+        return false;
+    }
 
-    // Cleanup
+    // Step 2: Build Huffman tree
+    HuffmanNode* root = buildHuffmanTree(freqMap, &tracked);
+    if (!root) {
+        cerr << "Error: Empty file or cannot build tree" << endl;
+        return false;
+    }
+
+    // Step 3: Generate codes (packed into integers for fast lookup during encoding)
+    string codes[256];
+    generateCodes(root, "", codes);
+    unsigned long long bits[256];
+    unsigned char lengths[256];
+    packCodes(codes, bits, lengths);
+
+    // Step 4: Write compressed file
+    bool ok = writeEncodedFile(inputFile, outputFile, root, (unsigned int)root->frequency, bits, lengths, nullptr,
+                               &tracker, io);
     delete root;
+    if (!ok && tracker.cancelled()) {
+        std::filesystem::remove(outputFile, ec);
+        cerr << "Compression of " << inputFile << " cancelled" << endl;
+        return false;
+    }
+    if (!ok) {
+        return false;
+    }
+    if (budget.exceeded()) {
+        std::filesystem::remove(outputFile, ec);
+        cerr << "Error: Memory limit of " << memoryLimit << " bytes exceeded" << endl;
+        return false;
+    }
 
+    tracker.finish();
     cout << "Compression complete! Output: " << outputFile << endl;
+    return true;
 }
 
+bool compressFileSampled(const string& inputFile, const string& outputFile, const SamplingOptions& options,
+                         bool* sampledTableKept) {
+    cout << "Compressing " << inputFile << " (sampled frequencies)..." << endl;
+    if (sampledTableKept) *sampledTableKept = false;
+
+    // Step 1: Estimate the histogram; the table must be able to code every byte
+    unsigned long long counts[256];
+    unsigned long long fileSize;
+    bool sampled = sampleFrequencies(inputFile, options, counts, fileSize);
+    if (fileSize > 0xFFFFFFFFULL) {
+        // The .huf size field is 4 bytes; larger inputs belong in a block archive
+        cerr << "Error: " << inputFile << " is larger than 4 GiB, use a block archive" << endl;
+        return false;
+    }
+    HuffmanTable table;
+    if (!table.buildFromCounts(counts, sampled)) {
+        cerr << "Error: Empty file or cannot build tree" << endl;
+        return false;
+    }
+
+    // Step 2: Encode with it, counting the real histogram on the way
+    unsigned long long exact[256];
+    if (!writeEncodedFile(inputFile, outputFile, table.getRoot(), (unsigned int)fileSize,
+                          table.getBits(), table.getLengths(), exact)) {
+        return false;
+    }
+
+    // Step 3: Guard - if the estimate coded the data poorly, redo it with the exact table
+    HuffmanTable exactTable;
+    exactTable.buildFromCounts(exact, false);
+    unsigned long long sampledCost = table.encodedBits(exact) + table.getSerialized().size() * 8;
+    unsigned long long exactCost = exactTable.encodedBits(exact) + exactTable.getSerialized().size() * 8;
+    if (sampled && sampledCost > exactCost * (1 + options.tolerance)) {
+        cout << "Sampled table too inaccurate, using exact frequencies" << endl;
+        if (!writeEncodedFile(inputFile, outputFile, exactTable.getRoot(), (unsigned int)fileSize,
+                              exactTable.getBits(), exactTable.getLengths(), nullptr)) {
+            return false;
+        }
+    } else if (sampledTableKept) {
+        *sampledTableKept = sampled;
+    }
+
+    cout << "Compression complete! Output: " << outputFile << endl;
+    return true;
+}
+
+// Largest possible header: 4 size bytes + 256 leaves * 9 bits + 255 internal bits
+static const size_t maxHeaderBytes = 4 + (256 * 9 + 255 + 7) / 8;
+
 /**
- * Decompress a Huffman-encoded file
+ * Where the coded bits of a .huf file start, and what decodes them
  */
-void decompressFile(const string& inputFile, const string& outputFile) {
-    cout << "Decompressing " << inputFile << "..." << endl;
+struct EncodedHeader {
+    unsigned char bytes[maxHeaderBytes];   // first bytes of the file; data may start in here
+    long long length;
+    unsigned int fileSize;
+    shared_ptr<const DecodeTableEntry> decodeTable;
+    long long position;                    // first data byte within bytes
+    int bitOffset;                         // data bits already used in that byte
+};
 
-    fstream inFile(inputFile, ios::in | ios::binary);
-    if (!inFile.is_open()) {
-        cerr << "Error: Cannot open compressed file" << endl;
-        return;
+/**
+ * Read the size and tree of a .huf file
+ * A tree seen before comes ready-built from the decode-table cache; otherwise it is deserialized
+ */
+static bool readEncodedHeader(SequentialReader& in, EncodedHeader& header) {
+    // The header is never longer than maxHeaderBytes; parse it from memory
+    header.length = in.read(header.bytes, maxHeaderBytes);
+    if (header.length < 0) header.length = 0;
+
+    // Read original file size
+    header.fileSize = 0;
+    for (int i = 0; i < 4 && i < header.length; i++) {
+        header.fileSize = (header.fileSize << 8) | header.bytes[i];
     }
 
-    BitStream bs(&inFile, false); // Read mode
+    size_t treeBits = header.length > 4 ? serializedTreeBits(header.bytes + 4, (size_t)header.length - 4) : 0;
+    if (treeBits > 0) header.decodeTable = DecodeTableCache::global().find(header.bytes + 4, treeBits);
+    if (header.decodeTable) {
+        header.position = 4 + (long long)(treeBits / 8);
+        header.bitOffset = (int)(treeBits % 8);
+        return true;
+    }
 
-    // Read original file size
-    unsigned int fileSize = 0;
+    stringstream stream(string((const char*)header.bytes, (size_t)header.length), ios::in | ios::binary);
+    BitStream bs(&stream, false); // Read mode
     for (int i = 0; i < 4; i++) {
-        fileSize = (fileSize << 8) | bs.readByte();
+        bs.readByte();
     }
-
-    // Deserialize tree
     HuffmanNode* root = deserializeTree(bs);
     if (!root) {
         cerr << "Error: Cannot reconstruct tree" << endl;
-        inFile.close();
-        return;
+        return false;
     }
 
-    // Decode content
-    ofstream outFile(outputFile, ios::binary);
-    if (!outFile.is_open()) {
-        cerr << "Error: Cannot create output file" << endl;
+    // Data starts right after the last header bit
+    header.position = stream.tellg();
+    header.bitOffset = bs.getBitPosition();
+    if (header.bitOffset > 0) header.position--; // still inside the last header byte
+    if (header.position < 0 || treeBits == 0) {
+        cerr << "Error: Cannot reconstruct tree" << endl;
         delete root;
-        inFile.close();
-        return;
+        return false;
     }
+    header.decodeTable = DecodeTableCache::global().insert(header.bytes + 4, treeBits, root);
+    return true;
+}
 
-    HuffmanNode* current = root;
-    unsigned int bytesWritten = 0;
+/**
+ * Decompress a Huffman-encoded file
+ */
+void decompressFile(const string& inputFile, const string& outputFile, DecodeMode mode) {
+    decompressFile(inputFile, outputFile, JobControl(), mode);
+}
 
-    while (bytesWritten < fileSize && bs.hasMoreBits()) {
-        bool bit = bs.readBit();
+// Symbols decoded between two progress/cancellation checks
+static const unsigned long long decodeStepSymbols = 1024 * 1024;
 
-        // Traverse tree with null check
-        if (bit) {
-            if (current->right) {
-                current = current->right;
-            } else {
-                cerr << "Error: Invalid tree traversal (right)" << endl;
-                break;
-            }
+bool decompressFile(const string& inputFile, const string& outputFile, const JobControl& control, DecodeMode mode,
+                    size_t memoryLimit) {
+    cout << "Decompressing " << inputFile << "..." << endl;
+
+    // Reader, writer and staging buffer; the decode table is charged once the header names it
+    IoOptions io;
+    if (!planIoMemory(memoryLimit, outputChunkSize, io)) {
+        return false;
+    }
+    unique_ptr<SequentialReader> inFile = openSequentialReader(inputFile, io);
+    if (!inFile) {
+        cerr << "Error: Cannot open compressed file" << endl;
+        return false;
+    }
+
+    EncodedHeader header;
+    if (!readEncodedHeader(*inFile, header)) {
+        return false;
+    }
+    MemoryBudget budget(memoryLimit);
+    if (!budget.charge(2 * ioBufferBytes(io) + outputChunkSize + header.decodeTable->memoryBytes())) {
+        cerr << "Error: Memory limit of " << memoryLimit << " bytes exceeded" << endl;
+        return false;
+    }
+
+    // Decode content
+    unique_ptr<SequentialWriter> outFile = openSequentialWriter(outputFile, io);
+    if (!outFile) {
+        cerr << "Error: Cannot create output file" << endl;
+        return false;
+    }
+
+    // Decode straight from the header buffer, then from the rest of the file
+    SequentialSource source(*inFile, header.bytes + header.position, header.length - header.position);
+    BitReader<SequentialSource> reader(source);
+    reader.skipBits(header.bitOffset);
+    StagingSink sink(*outFile);
+    JobTracker tracker(&control, header.fileSize);
+    // Progress is checked every decodeStepSymbols bytes
+    auto discardOutput = [&]() {
+        outFile.reset();
+        std::error_code ec;
+        std::filesystem::remove(outputFile, ec);
+    };
+    unsigned long long done = 0;
+    bool decoded = true;
+    while (decoded && done < header.fileSize) {
+        unsigned long long step = header.fileSize - done < decodeStepSymbols ? header.fileSize - done
+                                                                             : decodeStepSymbols;
+        if (mode == DECODE_MULTI_SYMBOL) {
+            decoded = decodeSymbolsMulti(header.decodeTable->getTable(), reader, step, sink);
         } else {
-            if (current->left) {
-                current = current->left;
-            } else {
-                cerr << "Error: Invalid tree traversal (left)" << endl;
-                break;
-            }
+            decoded = decodeSymbols(header.decodeTable->getRoot(), reader, step, sink);
         }
-
-        // Reached leaf node
-        if (current && current->isLeaf()) {
-            outFile.put(current->data);
-            bytesWritten++;
-            current = root; // Reset to root for next character
+        if (decoded) done += step;
+        if (!tracker.advance(step)) {
+            discardOutput();
+            cerr << "Decompression of " << inputFile << " cancelled" << endl;
+            return false;
         }
     }
+    // A truncated or corrupt file leaves no short output behind
+    if (!decoded || source.failed() || done != header.fileSize) {
+        discardOutput();
+        cerr << "Error: " << inputFile << (source.failed() ? " cannot be read" : " is corrupt") << endl;
+        return false;
+    }
 
+    bool ok = sink.flush() && outFile->finish();
 
-    outFile.close();
-    inFile.close();
-
-    // Cleanup
-    delete root;
+    if (!ok) {
+        cerr << "Error: Failed writing " << outputFile << endl;
+        discardOutput();
+        return false;
+    }
 
+    tracker.finish();
     cout << "Decompression complete! Output: " << outputFile << endl;
+    return true;
+}
+
+bool verifyFile(const string& inputFile, unsigned long long* decodedBytes) {
+    unique_ptr<SequentialReader> inFile = openSequentialReader(inputFile);
+    if (!inFile) {
+        cerr << "Error: Cannot open compressed file" << endl;
+        return false;
+    }
+    EncodedHeader header;
+    if (!readEncodedHeader(*inFile, header)) {
+        return false;
+    }
+
+    SequentialSource source(*inFile, header.bytes + header.position, header.length - header.position);
+    BitReader<SequentialSource> reader(source);
+    reader.skipBits(header.bitOffset);
+    DiscardSink sink;
+    bool ok = decodeSymbolsMulti(header.decodeTable->getTable(), reader, header.fileSize, sink);
+    if (decodedBytes) *decodedBytes = sink.size();
+
+    // Only the zero padding of the last byte may follow the data
+    reader.refill();
+    int rest = reader.bitsAvailable();
+    if (!ok || source.failed() || sink.size() != header.fileSize || rest >= 8 || reader.peekBits(rest) != 0) {
+        cerr << "Error: " << inputFile << " is corrupt" << endl;
+        return false;
+    }
+    return true;
 }
 
 /**
@@ -283,7 +705,12 @@ void displayMenu() {
     cout << "========================================" << endl;
     cout << "1. Compress a file" << endl;
     cout << "2. Decompress a file" << endl;
-    cout << "3. Exit" << endl;
+    cout << "3. Compress with deduplication (block archive)" << endl;
+    cout << "4. Decompress a block archive" << endl;
+    cout << "5. Update a block archive (re-encode changed blocks only)" << endl;
+    cout << "6. Compress a directory tree (parallel)" << endl;
+    cout << "7. Verify a compressed file or archive (no output written)" << endl;
+    cout << "8. Exit" << endl;
     cout << "========================================" << endl;
     cout << "Enter your choice: ";
 }
\ No newline at end of file
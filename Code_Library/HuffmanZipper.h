@@ -4,9 +4,12 @@
 #define MILESTONE_2_ADS_HUFFMANZIPPER_H
 
 #include <string>
+#include <memory_resource>
 #include "HuffmanNode.h"
 #include "HashMap.h"
 #include "BitStream.h"
+#include "FrequencySampler.h"
+#include "JobControl.h"
 
 using namespace std;
 
@@ -17,11 +20,18 @@ using namespace std;
  */
 void buildFrequencyMap(const string& filename, HashMap& freqMap);
 
+/**
+ * Build frequency map for all bytes in a memory buffer
+ */
+void buildFrequencyMap(const unsigned char* data, size_t length, HashMap& freqMap);
+
 
 /**
  * Build Huffman tree from frequency array
+ * The working heap is allocated from the given memory resource
  */
-HuffmanNode* buildHuffmanTree(HashMap& freqMap);
+HuffmanNode* buildHuffmanTree(HashMap& freqMap,
+                              std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
 /**
  * Generate Huffman codes for each character
@@ -29,6 +39,11 @@ HuffmanNode* buildHuffmanTree(HashMap& freqMap);
  */
 void generateCodes(HuffmanNode* root, string code, string codes[256]);
 
+/**
+ * Pack the string codes into integers (MSB first) with their bit lengths
+ */
+void packCodes(const string codes[256], unsigned long long bits[256], unsigned char lengths[256]);
+
 /**
  * Serialize Huffman tree to compressed file
  * Write tree structure using pre-order traversal
@@ -38,18 +53,64 @@ void serializeTree(HuffmanNode* root, BitStream& bs);
 /**
  * Deserialize Huffman tree from compressed file
  * Reconstruct tree from pre-order traversal
+ * Returns nullptr if the stream ends early or the tree is deeper than 256 levels
  */
 HuffmanNode* deserializeTree(BitStream& bs);
 
 /**
  * Compress a file using Huffman encoding
+ * Container storage for the job (frequency map, heap) comes from the given
+ * memory resource, e.g. an ArenaResource that is reset between jobs
  */
-void compressFile(const string& inputFile, const string& outputFile);
+void compressFile(const string& inputFile, const string& outputFile,
+                  std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+/**
+ * compressFile with progress reports and cancellation (see JobControl.h)
+ * Both passes over the input count, so bytesTotal is twice its size.
+ * memoryLimit (bytes, 0 for none) shrinks the I/O buffers to fit; a job
+ * that still goes over it fails.
+ * Returns false on error or cancellation; a cancelled job removes its output.
+ */
+bool compressFile(const string& inputFile, const string& outputFile, const JobControl& control,
+                  std::pmr::memory_resource* resource = std::pmr::get_default_resource(), size_t memoryLimit = 0);
+
+/**
+ * Compress a file using a histogram estimated from a sample of it
+ * Writes the same format as compressFile. If the sampled table turns out
+ * more than options.tolerance worse than the exact one, the file is encoded
+ * again with exact counts. sampledTableKept tells which table was used.
+ * The sample read is small, but a failed guard means one more full pass:
+ * up to three reads of the input, where compressFile always does two.
+ * Inputs over 4 GiB do not fit the .huf size field and are rejected.
+ */
+bool compressFileSampled(const string& inputFile, const string& outputFile,
+                         const SamplingOptions& options = SamplingOptions(), bool* sampledTableKept = nullptr);
+
+enum DecodeMode {
+    DECODE_TREE_WALK,     // one tree step per bit
+    DECODE_MULTI_SYMBOL   // 12-bit lookups that emit up to 4 bytes each (see DecodeTable.h)
+};
 
 /**
  * Decompress a Huffman-encoded file
  */
-void decompressFile(const string& inputFile, const string& outputFile);
+void decompressFile(const string& inputFile, const string& outputFile, DecodeMode mode = DECODE_MULTI_SYMBOL);
+
+/**
+ * decompressFile with progress reports (decoded bytes) and cancellation
+ * memoryLimit works as for compressFile, checked before any output is written.
+ * Returns false on error or cancellation; a cancelled job removes its output.
+ */
+bool decompressFile(const string& inputFile, const string& outputFile, const JobControl& control,
+                    DecodeMode mode = DECODE_MULTI_SYMBOL, size_t memoryLimit = 0);
+
+/**
+ * Check a Huffman-encoded file without writing anything: decodes into a
+ * discard sink and checks the stored size and the end of the bit stream.
+ * decodedBytes gets the number of bytes that decoded.
+ */
+bool verifyFile(const string& inputFile, unsigned long long* decodedBytes = nullptr);
 
 /**
  * Display menu
@@ -0,0 +1,734 @@
+#include "IoBackend.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#define HAVE_IO_URING 1
+#endif
+
+static const size_t minShrunkBufferSize = 64 * 1024; // shrinkIoBuffers stops halving here
+
+long long SequentialReader::next(const unsigned char*& data) {
+    // Finish what read() left of the current piece first
+    if (leftoverLength > 0) {
+        data = leftover;
+        long long length = (long long)leftoverLength;
+        leftoverLength = 0;
+        return length;
+    }
+    return nextPiece(data);
+}
+
+long long SequentialReader::read(unsigned char* buffer, size_t length) {
+    size_t copied = 0;
+    while (copied < length) {
+        if (leftoverLength == 0) {
+            long long got = nextPiece(leftover);
+            if (got < 0) return -1;
+            if (got == 0) break;
+            leftoverLength = (size_t)got;
+        }
+        size_t take = std::min(leftoverLength, length - copied);
+        memcpy(buffer + copied, leftover, take);
+        leftover += take;
+        leftoverLength -= take;
+        copied += take;
+    }
+    return (long long)copied;
+}
+
+// Page-aligned buffer memory (what registered buffers and O_DIRECT-style I/O like)
+static unsigned char* allocateBuffers(size_t bytes) {
+    void* memory = nullptr;
+    if (posix_memalign(&memory, 4096, bytes) != 0) {
+        return nullptr;
+    }
+    return static_cast<unsigned char*>(memory);
+}
+
+/**
+ * Buffered backend: one large read() or write() at a time
+ */
+class BufferedReader : public SequentialReader {
+private:
+    int fd;
+    unsigned char* buffer;
+    size_t bufferSize;
+
+public:
+    BufferedReader(int fileDescriptor, size_t size) {
+        fd = fileDescriptor;
+        bufferSize = size;
+        buffer = allocateBuffers(bufferSize);
+    }
+    ~BufferedReader() override {
+        free(buffer);
+        close(fd);
+    }
+
+    bool ready() const { return buffer != nullptr; }
+
+protected:
+    long long nextPiece(const unsigned char*& data) override {
+        ssize_t n;
+        do {
+            n = ::read(fd, buffer, bufferSize);
+        } while (n < 0 && errno == EINTR);
+        data = buffer;
+        return (n < 0) ? -1 : (long long)n;
+    }
+
+public:
+    const char* backendName() const override { return "buffered"; }
+};
+
+class BufferedWriter : public SequentialWriter {
+private:
+    int fd;
+    unsigned char* buffer;
+    size_t bufferSize;
+    size_t filled;
+    bool failed;
+
+    bool flush() {
+        size_t done = 0;
+        while (done < filled) {
+            ssize_t n = ::write(fd, buffer + done, filled - done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += (size_t)n;
+        }
+        filled = 0;
+        return true;
+    }
+
+public:
+    BufferedWriter(int fileDescriptor, size_t size) {
+        fd = fileDescriptor;
+        bufferSize = size;
+        buffer = allocateBuffers(bufferSize);
+        filled = 0;
+        failed = false;
+    }
+    ~BufferedWriter() override {
+        if (fd >= 0) close(fd);
+        free(buffer);
+    }
+
+    bool ready() const { return buffer != nullptr; }
+
+    bool write(const unsigned char* data, size_t length) override {
+        while (length > 0 && !failed) {
+            size_t take = std::min(length, bufferSize - filled);
+            memcpy(buffer + filled, data, take);
+            filled += take;
+            data += take;
+            length -= take;
+            if (filled == bufferSize && !flush()) failed = true;
+        }
+        return !failed;
+    }
+
+    bool finish() override {
+        if (fd < 0) return !failed;
+        if (!failed && !flush()) failed = true;
+        if (close(fd) != 0) failed = true;
+        fd = -1;
+        return !failed;
+    }
+
+    const char* backendName() const override { return "buffered"; }
+};
+
+#ifdef HAVE_IO_URING
+
+/**
+ * Minimal io_uring wrapper over the raw system calls (no liburing needed)
+ */
+class Uring {
+private:
+    int ringFd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqesSize = 0;
+
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+
+    unsigned localTail = 0;       // SQEs filled in but not yet published
+    unsigned toSubmit = 0;
+
+public:
+    ~Uring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+        if (ringFd >= 0) close(ringFd);
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd = (int)syscall(__NR_io_uring_setup, entries, &params);
+        if (ringFd < 0) return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+        }
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) return false;
+        cqRing = singleMap ? sqRing
+                           : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) return false;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+
+        char* sq = (char*)sqRing;
+        char* cq = (char*)cqRing;
+        sqHead = (unsigned*)(sq + params.sq_off.head);
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+        sqEntries = *(unsigned*)(sq + params.sq_off.ring_entries);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+        localTail = *sqTail;
+        return true;
+    }
+
+    bool registerBuffers(const iovec* buffers, unsigned count) {
+        return syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+    }
+
+    // Next free submission entry (zeroed), nullptr if the queue is full
+    io_uring_sqe* getSqe() {
+        unsigned head = std::atomic_ref<unsigned>(*sqHead).load(std::memory_order_acquire);
+        if (localTail - head >= sqEntries) return nullptr;
+        unsigned index = localTail & sqMask;
+        sqArray[index] = index;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        localTail++;
+        toSubmit++;
+        return sqe;
+    }
+
+    // Publish queued entries and optionally wait for at least waitFor completions
+    bool submit(unsigned waitFor) {
+        std::atomic_ref<unsigned>(*sqTail).store(localTail, std::memory_order_release);
+        while (true) {
+            long ret = syscall(__NR_io_uring_enter, ringFd, toSubmit, waitFor,
+                               waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (ret >= 0) {
+                toSubmit -= (unsigned)ret;
+                return true;
+            }
+            if (errno != EINTR) return false;
+        }
+    }
+
+    bool popCompletion(io_uring_cqe& out) {
+        unsigned head = *cqHead;
+        if (head == std::atomic_ref<unsigned>(*cqTail).load(std::memory_order_acquire)) return false;
+        out = cqes[head & cqMask];
+        std::atomic_ref<unsigned>(*cqHead).store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/**
+ * State shared by the io_uring reader and writer: the ring plus depth
+ * registered buffers of bufferSize bytes each
+ */
+class UringFile {
+protected:
+    struct Slot {
+        unsigned long long offset;  // file position of this request
+        size_t wanted;              // bytes to transfer
+        size_t done;                // bytes transferred so far
+        bool inFlight;
+        bool error;
+    };
+
+    Uring ring;
+    int fd;
+    unsigned char* memory;
+    size_t bufferSize;
+    unsigned depth;
+    Slot* slots;
+    bool fixedBuffers;      // registered buffers (READ_FIXED/WRITE_FIXED) or plain READ/WRITE
+
+    UringFile(int fileDescriptor, const IoOptions& options) {
+        fd = fileDescriptor;
+        bufferSize = options.bufferSize ? options.bufferSize : 1024 * 1024;
+        depth = options.queueDepth ? options.queueDepth : 4;
+        memory = nullptr;
+        slots = nullptr;
+        fixedBuffers = false;
+    }
+
+    ~UringFile() {
+        // The kernel may still be using the buffers: wait for every request first
+        if (slots) {
+            bool busy = true;
+            while (busy) {
+                busy = false;
+                for (unsigned i = 0; i < depth; i++) {
+                    busy = busy || slots[i].inFlight;
+                }
+                if (busy && !ring.submit(1)) break;
+                io_uring_cqe cqe;
+                while (ring.popCompletion(cqe)) {
+                    slots[cqe.user_data].inFlight = false;
+                }
+            }
+        }
+        delete[] slots;
+        free(memory);
+        close(fd);
+    }
+
+    bool setUp() {
+        memory = allocateBuffers(bufferSize * depth);
+        if (!memory || !ring.init(depth)) return false;
+        slots = new Slot[depth]();
+
+        iovec* buffers = new iovec[depth];
+        for (unsigned i = 0; i < depth; i++) {
+            buffers[i].iov_base = buffer(i);
+            buffers[i].iov_len = bufferSize;
+        }
+        // Registration can fail under a low RLIMIT_MEMLOCK; plain reads/writes still work
+        fixedBuffers = ring.registerBuffers(buffers, depth);
+        delete[] buffers;
+        return true;
+    }
+
+    unsigned char* buffer(unsigned slot) { return memory + (size_t)slot * bufferSize; }
+
+    // Queue the remaining part of a slot's request
+    void queue(unsigned slot, bool isWrite) {
+        Slot& s = slots[slot];
+        io_uring_sqe* sqe = ring.getSqe(); // never full: at most depth requests in flight
+        if (fixedBuffers) {
+            sqe->opcode = isWrite ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = (unsigned short)slot;
+        } else {
+            sqe->opcode = isWrite ? IORING_OP_WRITE : IORING_OP_READ;
+        }
+        sqe->fd = fd;
+        sqe->addr = (unsigned long long)(buffer(slot) + s.done);
+        sqe->len = (unsigned)(s.wanted - s.done);
+        sqe->off = s.offset + s.done;
+        sqe->user_data = slot;
+        s.inFlight = true;
+    }
+
+    // Wait for at least one completion and handle all that are ready
+    bool reap(bool isWrite) {
+        if (!ring.submit(1)) return false;
+        io_uring_cqe cqe;
+        while (ring.popCompletion(cqe)) {
+            Slot& s = slots[cqe.user_data];
+            if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                queue((unsigned)cqe.user_data, isWrite);          // retry as is
+            } else if (cqe.res < 0 || (cqe.res == 0 && isWrite)) {
+                s.error = true;
+                s.inFlight = false;
+            } else if (cqe.res == 0) {
+                s.inFlight = false;                              // file got shorter: stop here
+            } else {
+                s.done += (size_t)cqe.res;
+                if (s.done < s.wanted) {
+                    queue((unsigned)cqe.user_data, isWrite);      // short transfer: queue the rest
+                } else {
+                    s.inFlight = false;
+                }
+            }
+        }
+        return ring.submit(0);
+    }
+};
+
+class UringReader : public SequentialReader, private UringFile {
+private:
+    unsigned long long fileSize;
+    unsigned long long nextOffset;  // next file position to request
+    unsigned current;               // slot handed out by the last next()
+    bool holding;                   // current slot is owned by the caller
+
+    // Give a free slot the next piece of the file
+    void request(unsigned slot) {
+        Slot& s = slots[slot];
+        s.offset = nextOffset;
+        s.wanted = (size_t)std::min<unsigned long long>(bufferSize, fileSize - nextOffset);
+        s.done = 0;
+        s.error = false;
+        nextOffset += s.wanted;
+        if (s.wanted > 0) queue(slot, false);
+    }
+
+public:
+    UringReader(int fileDescriptor, const IoOptions& options) : UringFile(fileDescriptor, options) {
+        fileSize = 0;
+        nextOffset = 0;
+        current = 0;
+        holding = false;
+    }
+
+    bool start() {
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || !setUp()) return false;
+        fileSize = (unsigned long long)info.st_size;
+        for (unsigned i = 0; i < depth; i++) {
+            request(i);
+        }
+        return ring.submit(0);
+    }
+
+protected:
+    long long nextPiece(const unsigned char*& data) override {
+        if (holding) {
+            // The caller is done with the previous slot: reuse it for read-ahead
+            request(current);
+            current = (current + 1) % depth;
+            holding = false;
+            if (!ring.submit(0)) return -1;
+        }
+
+        Slot& s = slots[current];
+        while (s.inFlight) {
+            if (!reap(false)) return -1;
+        }
+        if (s.error) return -1;
+        if (s.wanted == 0 || s.done == 0) return 0; // end of file
+
+        data = buffer(current);
+        holding = true;
+        return (long long)s.done;
+    }
+
+public:
+    const char* backendName() const override { return "io_uring"; }
+};
+
+class UringWriter : public SequentialWriter, private UringFile {
+private:
+    unsigned long long nextOffset;
+    unsigned current;     // slot being filled
+    size_t filled;
+    bool failed;
+    bool closed;
+
+    void send(unsigned slot) {
+        Slot& s = slots[slot];
+        s.offset = nextOffset;
+        s.wanted = filled;
+        s.done = 0;
+        nextOffset += filled;
+        queue(slot, true);
+        filled = 0;
+    }
+
+    bool anyInFlight() const {
+        for (unsigned i = 0; i < depth; i++) {
+            if (slots[i].inFlight) return true;
+        }
+        return false;
+    }
+
+    bool anyError() const {
+        for (unsigned i = 0; i < depth; i++) {
+            if (slots[i].error) return true;
+        }
+        return false;
+    }
+
+public:
+    UringWriter(int fileDescriptor, const IoOptions& options) : UringFile(fileDescriptor, options) {
+        nextOffset = 0;
+        current = 0;
+        filled = 0;
+        failed = false;
+        closed = false;
+    }
+
+    bool start() { return setUp(); }
+
+    bool write(const unsigned char* data, size_t length) override {
+        while (length > 0 && !failed) {
+            // Wait until the slot we are about to fill has been written out
+            while (slots[current].inFlight && !failed) {
+                if (!reap(true)) failed = true;
+            }
+            if (failed || anyError()) {
+                failed = true;
+                break;
+            }
+
+            size_t take = std::min(length, bufferSize - filled);
+            memcpy(buffer(current) + filled, data, take);
+            filled += take;
+            data += take;
+            length -= take;
+
+            if (filled == bufferSize) {
+                send(current);
+                if (!ring.submit(0)) failed = true;
+                current = (current + 1) % depth;
+            }
+        }
+        return !failed;
+    }
+
+    bool finish() override {
+        if (closed) return !failed;
+        closed = true;
+        if (!failed && filled > 0) {
+            send(current);
+            if (!ring.submit(0)) failed = true;
+        }
+        while (!failed && anyInFlight()) {
+            if (!reap(true)) failed = true;
+        }
+        if (anyError()) failed = true;
+        return !failed;
+    }
+
+    const char* backendName() const override { return "io_uring"; }
+};
+
+bool ioUringAvailable() {
+    static const bool available = []() {
+        Uring probe;
+        return probe.init(2);
+    }();
+    return available;
+}
+
+#else
+
+bool ioUringAvailable() {
+    return false;
+}
+
+#endif // HAVE_IO_URING
+
+unique_ptr<SequentialReader> openSequentialReader(const string& path, const IoOptions& options) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    size_t bufferSize = options.bufferSize ? options.bufferSize : 1024 * 1024;
+
+#ifdef HAVE_IO_URING
+    if (options.backend != IO_BUFFERED && ioUringAvailable()) {
+        unique_ptr<UringReader> reader(new UringReader(fd, options));
+        if (reader->start()) return reader;
+        // Not a regular file or setup failed: reopen for the buffered path
+        reader.reset();
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return nullptr;
+    }
+#endif
+
+    unique_ptr<BufferedReader> reader(new BufferedReader(fd, bufferSize));
+    if (!reader->ready()) return nullptr;
+    return reader;
+}
+
+unique_ptr<SequentialWriter> openSequentialWriter(const string& path, const IoOptions& options) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    int fd = open(path.c_str(), flags, 0644);
+    if (fd < 0) return nullptr;
+    size_t bufferSize = options.bufferSize ? options.bufferSize : 1024 * 1024;
+
+#ifdef HAVE_IO_URING
+    if (options.backend != IO_BUFFERED && ioUringAvailable()) {
+        unique_ptr<UringWriter> writer(new UringWriter(fd, options));
+        if (writer->start()) return writer;
+        writer.reset();
+        fd = open(path.c_str(), flags, 0644);
+        if (fd < 0) return nullptr;
+    }
+#endif
+
+    unique_ptr<BufferedWriter> writer(new BufferedWriter(fd, bufferSize));
+    if (!writer->ready()) return nullptr;
+    return writer;
+}
+
+unique_ptr<SequentialReader> openSequentialReader(int fd, const IoOptions& options) {
+    // The buffered reader owns and closes its descriptor, so give it a copy.
+    // Passed descriptors are often pipes or sockets, which io_uring's file path does not suit.
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) return nullptr;
+    unique_ptr<BufferedReader> reader(new BufferedReader(copy, options.bufferSize ? options.bufferSize : 1024 * 1024));
+    if (!reader->ready()) return nullptr;
+    return reader;
+}
+
+unique_ptr<SequentialWriter> openSequentialWriter(int fd, const IoOptions& options) {
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) return nullptr;
+    unique_ptr<BufferedWriter> writer(new BufferedWriter(copy, options.bufferSize ? options.bufferSize : 1024 * 1024));
+    if (!writer->ready()) return nullptr;
+    return writer;
+}
+
+/**
+ * Memory backend: the whole buffer is one piece
+ */
+class MemoryReader : public SequentialReader {
+private:
+    const unsigned char* data;
+    size_t remaining;
+
+public:
+    MemoryReader(const unsigned char* buffer, size_t length) : data(buffer), remaining(length) {}
+
+protected:
+    long long nextPiece(const unsigned char*& piece) override {
+        piece = data;
+        long long length = (long long)remaining;
+        data += remaining;
+        remaining = 0;
+        return length;
+    }
+
+public:
+    const char* backendName() const override { return "memory"; }
+};
+
+class StringWriter : public SequentialWriter {
+private:
+    string& out;
+
+public:
+    explicit StringWriter(string& buffer) : out(buffer) {}
+
+    bool write(const unsigned char* data, size_t length) override {
+        out.append((const char*)data, length);
+        return true;
+    }
+    bool finish() override { return true; }
+    const char* backendName() const override { return "memory"; }
+};
+
+unique_ptr<SequentialReader> openMemoryReader(const unsigned char* data, size_t length) {
+    return unique_ptr<SequentialReader>(new MemoryReader(data, length));
+}
+
+unique_ptr<SequentialWriter> openStringWriter(string& out) {
+    return unique_ptr<SequentialWriter>(new StringWriter(out));
+}
+
+/**
+ * pread() on an owned descriptor, relative to a start offset
+ */
+class FileRandomAccess : public RandomAccessReader {
+private:
+    int fd;
+    unsigned long long start;
+    unsigned long long fileSize;
+
+public:
+    FileRandomAccess(int fileDescriptor, unsigned long long startOffset, unsigned long long length)
+        : fd(fileDescriptor), start(startOffset), fileSize(length) {}
+    ~FileRandomAccess() override { close(fd); }
+
+    bool readAt(unsigned long long offset, unsigned char* buffer, size_t length) override {
+        size_t done = 0;
+        while (done < length) {
+            ssize_t n = pread(fd, buffer + done, length - done, (off_t)(start + offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += (size_t)n;
+        }
+        return true;
+    }
+
+    unsigned long long size() const override { return fileSize; }
+};
+
+class MemoryRandomAccess : public RandomAccessReader {
+private:
+    const unsigned char* data;
+    size_t length;
+
+public:
+    MemoryRandomAccess(const unsigned char* buffer, size_t bufferLength) : data(buffer), length(bufferLength) {}
+
+    bool readAt(unsigned long long offset, unsigned char* buffer, size_t count) override {
+        if (offset > length || count > length - offset) return false;
+        memcpy(buffer, data + offset, count);
+        return true;
+    }
+
+    unsigned long long size() const override { return length; }
+};
+
+static unique_ptr<RandomAccessReader> randomAccessOver(int fd, unsigned long long start) {
+    struct stat info;
+    if (fd < 0) return nullptr;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || (unsigned long long)info.st_size < start) {
+        close(fd); // pipes and sockets cannot be read by offset
+        return nullptr;
+    }
+    return unique_ptr<RandomAccessReader>(new FileRandomAccess(fd, start, (unsigned long long)info.st_size - start));
+}
+
+unique_ptr<RandomAccessReader> openRandomAccessReader(const string& path) {
+    return randomAccessOver(open(path.c_str(), O_RDONLY | O_CLOEXEC), 0);
+}
+
+unique_ptr<RandomAccessReader> openRandomAccessReader(int fd) {
+    // Offsets count from the descriptor's current position, like the sequential reader sees it
+    off_t position = lseek(fd, 0, SEEK_CUR);
+    if (position < 0) return nullptr;
+    return randomAccessOver(fcntl(fd, F_DUPFD_CLOEXEC, 0), (unsigned long long)position);
+}
+
+unique_ptr<RandomAccessReader> openRandomAccessReader(const unsigned char* data, size_t length) {
+    return unique_ptr<RandomAccessReader>(new MemoryRandomAccess(data, length));
+}
+
+size_t ioBufferBytes(const IoOptions& options) {
+    return options.bufferSize * (options.queueDepth > 0 ? options.queueDepth : 1);
+}
+
+bool shrinkIoBuffers(IoOptions& options) {
+    if (options.bufferSize > minShrunkBufferSize) {
+        options.bufferSize /= 2;
+    } else if (options.queueDepth > 1) {
+        options.queueDepth = 1;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,127 @@
+#ifndef MILESTONE_2_ADS_IOBACKEND_H
+#define MILESTONE_2_ADS_IOBACKEND_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+/*
+  File I/O backends
+  The codec reads and writes whole files sequentially through these two
+  interfaces, so it does not care how the bytes move:
+    - buffered: plain read()/write() system calls on large buffers
+    - io_uring (Linux): several 1-4 MiB reads or writes kept in flight on
+      registered buffers, so the disk works while the codec computes
+  IO_AUTO picks io_uring when the kernel allows it and falls back to the
+  buffered backend otherwise (old kernel, seccomp, non-Linux build).
+  Readers and writers can also sit on memory or on a descriptor someone
+  else opened (a daemon client's inline buffer or passed fd).
+  RandomAccessReader serves the parts that are read out of order: an
+  archive's index and payloads, and dedup's re-reads of earlier chunks.
+*/
+
+enum IoBackendKind {
+    IO_AUTO = 0,
+    IO_BUFFERED,
+    IO_URING
+};
+
+struct IoOptions {
+    IoBackendKind backend = IO_AUTO;
+    size_t bufferSize = 1024 * 1024;  // bytes per request (1-4 MiB works well on NVMe)
+    unsigned int queueDepth = 4;      // requests kept in flight
+};
+
+class SequentialReader {
+public:
+    virtual ~SequentialReader() {}
+
+    /**
+     * Next piece of the file, without copying.
+     * data stays valid until the next call to next() or read(). Returns the
+     * length, 0 at end of file and -1 on an I/O error.
+     */
+    long long next(const unsigned char*& data);
+
+    /**
+     * Copying read on top of next(): fills buffer with up to length bytes
+     * Returns the number of bytes copied, 0 at end of file, -1 on error
+     */
+    long long read(unsigned char* buffer, size_t length);
+
+    virtual const char* backendName() const = 0;
+
+protected:
+    virtual long long nextPiece(const unsigned char*& data) = 0; // backend-specific next()
+
+private:
+    const unsigned char* leftover = nullptr;  // unread part of the last piece
+    size_t leftoverLength = 0;
+};
+
+class SequentialWriter {
+public:
+    virtual ~SequentialWriter() {}
+
+    virtual bool write(const unsigned char* data, size_t length) = 0;
+    virtual bool finish() = 0;           // flush, wait for outstanding writes and close
+    virtual const char* backendName() const = 0;
+};
+
+class RandomAccessReader {
+public:
+    virtual ~RandomAccessReader() {}
+
+    /**
+     * Copy length bytes starting at offset; false on an I/O error or past the end
+     */
+    virtual bool readAt(unsigned long long offset, unsigned char* buffer, size_t length) = 0;
+    virtual unsigned long long size() const = 0;
+};
+
+/**
+ * Open a file for sequential reading / writing (truncates), nullptr on failure
+ */
+unique_ptr<SequentialReader> openSequentialReader(const string& path, const IoOptions& options = IoOptions());
+unique_ptr<SequentialWriter> openSequentialWriter(const string& path, const IoOptions& options = IoOptions());
+
+/**
+ * Same over a descriptor the caller keeps: it is duplicated, never closed
+ */
+unique_ptr<SequentialReader> openSequentialReader(int fd, const IoOptions& options = IoOptions());
+unique_ptr<SequentialWriter> openSequentialWriter(int fd, const IoOptions& options = IoOptions());
+
+/**
+ * Read from a memory buffer / append to a string; both must outlive the reader or writer
+ */
+unique_ptr<SequentialReader> openMemoryReader(const unsigned char* data, size_t length);
+unique_ptr<SequentialWriter> openStringWriter(string& out);
+
+/**
+ * Positional reads over a file, a regular-file descriptor (duplicated; offsets count from
+ * its current position) or memory; nullptr on failure
+ */
+unique_ptr<RandomAccessReader> openRandomAccessReader(const string& path);
+unique_ptr<RandomAccessReader> openRandomAccessReader(int fd);
+unique_ptr<RandomAccessReader> openRandomAccessReader(const unsigned char* data, size_t length);
+
+/**
+ * True if io_uring can be used in this process
+ */
+bool ioUringAvailable();
+
+/**
+ * Buffer memory one reader or writer opened with these options holds
+ * (io_uring keeps queueDepth buffers in flight)
+ */
+size_t ioBufferBytes(const IoOptions& options);
+
+/**
+ * One step down for a memory limit: halve the buffers down to 64 KiB, then
+ * keep a single request in flight; false if already at the smallest
+ */
+bool shrinkIoBuffers(IoOptions& options);
+
+#endif //MILESTONE_2_ADS_IOBACKEND_H
@@ -0,0 +1,42 @@
+#include "JobControl.h"
+
+JobTracker::JobTracker(const JobControl* jobControl, unsigned long long bytesTotal)
+    : control(jobControl), total(bytesTotal), doneBytes(0), start(Clock::now()), lastBytes(0), lastTime(0) {
+    long long interval = control ? (long long)(control->reportInterval * 1e9) : 0;
+    nextReport.store(interval);
+}
+
+void JobTracker::finish() {
+    if (control && control->onProgress) {
+        report(bytesDone(), true);
+    }
+}
+
+void JobTracker::report(unsigned long long done, bool finished) {
+    std::unique_lock<std::mutex> lock(reportMutex, std::defer_lock);
+    if (finished) {
+        lock.lock();
+    } else if (!lock.try_lock()) {
+        return; // another thread is reporting right now
+    }
+
+    long long time = now();
+    if (!finished && time < nextReport.load(std::memory_order_relaxed)) return; // someone just reported
+    nextReport.store(time + (long long)(control->reportInterval * 1e9), std::memory_order_relaxed);
+
+    JobProgress progress;
+    progress.bytesDone = done;
+    progress.bytesTotal = total;
+    progress.elapsedSeconds = time / 1e9;
+    double window = (time - lastTime) / 1e9;
+    if (window > 0 && done >= lastBytes) {
+        progress.megabytesPerSecond = (done - lastBytes) / window / 1e6;
+    }
+    if (total > 0 && done > 0 && done <= total) {
+        progress.etaSeconds = progress.elapsedSeconds * (double)(total - done) / (double)done;
+    }
+    progress.finished = finished;
+    lastBytes = done;
+    lastTime = time;
+    control->onProgress(progress);
+}
@@ -0,0 +1,100 @@
+#ifndef MILESTONE_2_ADS_JOBCONTROL_H
+#define MILESTONE_2_ADS_JOBCONTROL_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+
+/*
+  Progress and cancellation for long jobs
+  A job advances a JobTracker at its natural boundaries (an archive block,
+  one reader piece of a .huf file), which costs one relaxed atomic add.
+  At most every reportInterval seconds the thread that crosses the interval
+  calls onProgress; calls never overlap, but they can come from any of the
+  job's threads, so the callback should be quick. Cancelling the token
+  makes the job stop at its next boundary and remove its partial output.
+*/
+
+struct JobProgress {
+    unsigned long long bytesDone = 0;
+    unsigned long long bytesTotal = 0;   // 0 if unknown (e.g. a pipe)
+    double elapsedSeconds = 0;
+    double megabytesPerSecond = 0;       // since the previous report
+    double etaSeconds = -1;              // from the average rate so far, -1 if unknown
+    bool finished = false;               // last report of a job that completed
+};
+
+/**
+ * Shared between the job and whoever may stop it; cancel() is safe from any thread
+ */
+class CancellationToken {
+public:
+    CancellationToken() : flag(false) {}
+
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    void cancel() { flag.store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return flag.load(std::memory_order_relaxed); }
+    void reset() { flag.store(false, std::memory_order_relaxed); }   // reuse for the next job
+
+private:
+    std::atomic<bool> flag;
+};
+
+struct JobControl {
+    std::function<void(const JobProgress&)> onProgress;   // optional
+    double reportInterval = 0.5;                          // seconds between reports
+    CancellationToken* cancel = nullptr;                  // optional
+};
+
+class JobTracker {
+public:
+    /**
+     * control may be nullptr: the tracker then only counts
+     */
+    JobTracker(const JobControl* jobControl, unsigned long long bytesTotal);
+
+    JobTracker(const JobTracker&) = delete;
+    JobTracker& operator=(const JobTracker&) = delete;
+
+    /**
+     * Count bytes finished at a boundary; false once the job is cancelled
+     */
+    bool advance(unsigned long long bytes) {
+        unsigned long long done = doneBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (control && control->onProgress && now() >= nextReport.load(std::memory_order_relaxed)) {
+            report(done, false);
+        }
+        return !cancelled();
+    }
+
+    bool cancelled() const { return control && control->cancel && control->cancel->cancelled(); }
+
+    /**
+     * Final report after a successful job
+     */
+    void finish();
+
+    unsigned long long bytesDone() const { return doneBytes.load(std::memory_order_relaxed); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    const JobControl* control;
+    unsigned long long total;
+    std::atomic<unsigned long long> doneBytes;
+    std::atomic<long long> nextReport;       // nanoseconds since start
+    Clock::time_point start;
+    std::mutex reportMutex;                  // one reporter at a time
+    unsigned long long lastBytes;
+    long long lastTime;
+
+    long long now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+    void report(unsigned long long done, bool finished);
+};
+
+#endif //MILESTONE_2_ADS_JOBCONTROL_H
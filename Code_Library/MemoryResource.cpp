@@ -0,0 +1,170 @@
+#include "MemoryResource.h"
+#include <cstdint>
+#include <sys/resource.h>
+
+// Alignment used for the chunk header so the data area starts well aligned
+static const size_t chunkHeaderSize = (sizeof(void*) * 2 + alignof(std::max_align_t) - 1)
+                                      & ~(alignof(std::max_align_t) - 1);
+
+ArenaResource::ArenaResource(size_t initialChunkSize, std::pmr::memory_resource* upstreamResource) {
+    chunks = nullptr;
+    cursor = nullptr;
+    limit = nullptr;
+    nextChunkSize = (initialChunkSize > 0) ? initialChunkSize : 1024;
+    used = 0;
+    reserved = 0;
+    upstream = upstreamResource;
+}
+
+ArenaResource::~ArenaResource() {
+    // Give every chunk back to the upstream resource
+    while (chunks) {
+        Chunk* next = chunks->next;
+        upstream->deallocate(chunks, chunkHeaderSize + chunks->size, alignof(std::max_align_t));
+        chunks = next;
+    }
+}
+
+/**
+ * Allocate a new chunk big enough for minBytes and make it current
+ */
+void ArenaResource::addChunk(size_t minBytes) {
+    size_t size = nextChunkSize;
+    while (size < minBytes) {
+        size *= 2;
+    }
+
+    void* raw = upstream->allocate(chunkHeaderSize + size, alignof(std::max_align_t));
+    Chunk* chunk = static_cast<Chunk*>(raw);
+    chunk->next = chunks;
+    chunk->size = size;
+    chunks = chunk;
+
+    cursor = static_cast<char*>(raw) + chunkHeaderSize;
+    limit = cursor + size;
+    reserved += chunkHeaderSize + size;
+    nextChunkSize = size * 2; // doubling keeps the number of chunks logarithmic
+}
+
+void* ArenaResource::do_allocate(size_t bytes, size_t alignment) {
+    uintptr_t current = reinterpret_cast<uintptr_t>(cursor);
+    uintptr_t aligned = (current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+    if (!cursor || aligned + bytes > reinterpret_cast<uintptr_t>(limit)) {
+        addChunk(bytes + alignment);
+        current = reinterpret_cast<uintptr_t>(cursor);
+        aligned = (current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+
+    cursor = reinterpret_cast<char*>(aligned + bytes);
+    used += bytes;
+    return reinterpret_cast<void*>(aligned);
+}
+
+void ArenaResource::do_deallocate(void*, size_t, size_t) {
+    // Monotonic: individual frees are ignored, memory comes back on reset()
+}
+
+bool ArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+/**
+ * Release everything in O(1) with respect to the number of allocations.
+ * Only the newest (largest) chunk is kept, so a reused arena stops growing
+ * once it has seen its biggest job.
+ */
+void ArenaResource::reset() {
+    if (!chunks) return;
+
+    // Keep the largest (most recent) chunk and return the others
+    Chunk* keep = chunks;
+    Chunk* chunk = chunks->next;
+    while (chunk) {
+        Chunk* next = chunk->next;
+        reserved -= chunkHeaderSize + chunk->size;
+        upstream->deallocate(chunk, chunkHeaderSize + chunk->size, alignof(std::max_align_t));
+        chunk = next;
+    }
+
+    keep->next = nullptr;
+    chunks = keep;
+    cursor = reinterpret_cast<char*>(keep) + chunkHeaderSize;
+    limit = cursor + keep->size;
+    used = 0;
+}
+
+PerThreadPoolResource* PerThreadPoolResource::instance() {
+    static PerThreadPoolResource shared;
+    return &shared;
+}
+
+std::pmr::memory_resource* PerThreadPoolResource::localPool() {
+    // One pool per thread, created on first use and freed when the thread exits
+    thread_local std::pmr::unsynchronized_pool_resource pool;
+    return &pool;
+}
+
+void* PerThreadPoolResource::do_allocate(size_t bytes, size_t alignment) {
+    return localPool()->allocate(bytes, alignment);
+}
+
+void PerThreadPoolResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    localPool()->deallocate(p, bytes, alignment);
+}
+
+bool PerThreadPoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    // All instances share the same thread-local pools
+    return dynamic_cast<const PerThreadPoolResource*>(&other) != nullptr;
+}
+
+MemoryBudget::MemoryBudget(size_t limit) : limitBytes(limit), used(0), highWater(0), overLimit(false) {
+}
+
+bool MemoryBudget::charge(size_t bytes) {
+    size_t now = used.fetch_add(bytes) + bytes;
+    size_t seen = highWater.load();
+    while (now > seen && !highWater.compare_exchange_weak(seen, now)) {
+        // seen was refreshed, try again
+    }
+    if (limitBytes > 0 && now > limitBytes) {
+        overLimit.store(true);
+        return false;
+    }
+    return true;
+}
+
+void MemoryBudget::release(size_t bytes) {
+    used.fetch_sub(bytes);
+}
+
+BudgetResource::BudgetResource(MemoryBudget& memoryBudget, std::pmr::memory_resource* upstreamResource)
+    : budget(memoryBudget), upstream(upstreamResource) {
+}
+
+void* BudgetResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = upstream->allocate(bytes, alignment);
+    budget.charge(bytes);
+    return p;
+}
+
+void BudgetResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    upstream->deallocate(p, bytes, alignment);
+    budget.release(bytes);
+}
+
+bool BudgetResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+size_t peakResidentBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;          // bytes on macOS
+#else
+    return (size_t)usage.ru_maxrss * 1024;   // kilobytes on Linux
+#endif
+}
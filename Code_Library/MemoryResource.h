@@ -0,0 +1,134 @@
+#ifndef MILESTONE_2_ADS_MEMORYRESOURCE_H
+#define MILESTONE_2_ADS_MEMORYRESOURCE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+/*
+  Memory resources for the Code_Library containers.
+  DynamicArray, MinHeap and HashMap take a std::pmr::memory_resource*,
+  so any standard or custom resource can be plugged in. The library ships
+  three of its own:
+    - ArenaResource: monotonic bump allocator, released in O(1) with reset()
+    - PerThreadPoolResource: routes each thread to its own pool so threads
+      do not contend on the global allocator
+    - BudgetResource: passes allocations through and charges them to a MemoryBudget
+*/
+
+/**
+ * Monotonic arena
+ * Hands out memory by bumping a pointer inside large chunks; deallocate is a no-op.
+ * reset() frees everything at once and keeps one chunk for reuse,
+ * so a whole compression job can run out of one arena.
+ */
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    explicit ArenaResource(size_t initialChunkSize = 64 * 1024,
+                           std::pmr::memory_resource* upstream = std::pmr::new_delete_resource());
+    ~ArenaResource() override;
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    void reset();                            // release all allocations, keep the largest chunk
+    size_t bytesAllocated() const { return used; }      // bytes handed out since last reset
+    size_t bytesReserved() const { return reserved; }   // bytes held from upstream
+
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t size;       // usable bytes after the header
+    };
+
+    Chunk* chunks;         // most recent chunk first
+    char* cursor;          // next free byte in the current chunk
+    char* limit;           // end of the current chunk
+    size_t nextChunkSize;  // grows geometrically
+    size_t used;
+    size_t reserved;
+    std::pmr::memory_resource* upstream;
+
+    void addChunk(size_t minBytes);
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+/**
+ * Per-thread pool resource
+ * Every thread allocates from its own unsynchronized pool, so there is no
+ * locking on the hot path. Memory must be released by the thread that
+ * allocated it (true for containers that live inside a single job).
+ */
+class PerThreadPoolResource : public std::pmr::memory_resource {
+public:
+    PerThreadPoolResource() = default;
+
+    static PerThreadPoolResource* instance();          // process-wide shared instance
+    static std::pmr::memory_resource* localPool();      // the calling thread's pool
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+/**
+ * Memory budget for one job
+ * A job plans its buffers against limit() up front, then charges what it
+ * really holds and releases it when done; peak() is the high-water mark
+ * of those charges. A charge past the limit still counts but marks the
+ * budget exceeded(), and the job fails at its next check.
+ * Thread-safe, so pipeline stages can charge their own buffers.
+ */
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limitBytes = 0);   // 0 = no limit
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    MemoryBudget& operator=(const MemoryBudget&) = delete;
+
+    bool charge(size_t bytes);   // false if the total is now over the limit
+    void release(size_t bytes);
+    bool fits(size_t bytes) const { return limitBytes == 0 || bytes <= limitBytes; }
+
+    size_t limit() const { return limitBytes; }
+    size_t current() const { return used.load(); }
+    size_t peak() const { return highWater.load(); }
+    bool exceeded() const { return overLimit.load(); }
+
+private:
+    size_t limitBytes;
+    std::atomic<size_t> used;
+    std::atomic<size_t> highWater;
+    std::atomic<bool> overLimit;
+};
+
+/**
+ * Resident high-water mark of the whole process in bytes (getrusage), 0 if unknown
+ * Measured rather than charged, so it also covers memory outside any budget
+ * and, in a process that runs several jobs, all of them.
+ */
+size_t peakResidentBytes();
+
+/**
+ * Resource that charges every allocation to a MemoryBudget
+ * Lets pmr containers (DynamicArray, HashMap, MinHeap) show up in a job's peak usage.
+ */
+class BudgetResource : public std::pmr::memory_resource {
+public:
+    explicit BudgetResource(MemoryBudget& budget,
+                            std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+private:
+    MemoryBudget& budget;
+    std::pmr::memory_resource* upstream;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+#endif //MILESTONE_2_ADS_MEMORYRESOURCE_H
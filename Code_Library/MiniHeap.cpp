@@ -4,30 +4,31 @@
 static const int initialCapacity = 16; // choosing a small starting capacity to keep it light
 
 // Constructor
-MinHeap::MinHeap() {
+MinHeap::MinHeap(std::pmr::memory_resource* res) {
+    resource_ = res ? res : std::pmr::get_default_resource();
     size_ = 0;
     capacity_ = initialCapacity;
-    data_ = new HuffmanNode*[capacity_];
+    data_ = static_cast<HuffmanNode**>(resource_->allocate(capacity_ * sizeof(HuffmanNode*), alignof(HuffmanNode*)));
 }
 
 // Destructor
 MinHeap::~MinHeap() {
     // Do not delete HuffmanNode*s (ownershp is external)
     // Huffman tree destructor will free them later
-    delete[] data_; // only internal array is freed
+    resource_->deallocate(data_, capacity_ * sizeof(HuffmanNode*), alignof(HuffmanNode*)); // only internal array is freed
 }
 
 void MinHeap::ensureCapacity() {
     if (size_ < capacity_) return; // capacity not reached, can exit safely
 
     int newCap = (capacity_ == 0) ? initialCapacity : capacity_ * 2; // double array size
-    HuffmanNode** newData = new HuffmanNode*[newCap];
+    HuffmanNode** newData = static_cast<HuffmanNode**>(resource_->allocate(newCap * sizeof(HuffmanNode*), alignof(HuffmanNode*)));
 
     for (int i = 0; i < size_; ++i) {
         newData[i] = data_[i];
     }
 
-    delete[] data_;
+    resource_->deallocate(data_, capacity_ * sizeof(HuffmanNode*), alignof(HuffmanNode*));
     data_ = newData;
     capacity_ = newCap;
 }
@@ -3,12 +3,16 @@
 #define MILESTONE_2_ADS_MINIHEAP_H
 
 #include "HuffmanNode.h"
+#include <memory_resource>
 
 class MinHeap {
 public:
-    MinHeap();                                  // empty heap (starts small, grows)
+    explicit MinHeap(std::pmr::memory_resource* res = std::pmr::get_default_resource()); // empty heap (starts small, grows)
     ~MinHeap();
 
+    MinHeap(const MinHeap&) = delete;           // owns its pointer array
+    MinHeap& operator=(const MinHeap&) = delete;
+
     bool empty() const { return size_ == 0; }   // check if MinHeap is empty
     int size()  const { return size_; }         // getter for 'size_'
 
@@ -22,6 +26,7 @@ private:
     HuffmanNode** data_;  // dynamic array of pointers
     int size_;            // number of elements in heap ( '_' to indicate private member)
     int capacity_;        // allocated slots
+    std::pmr::memory_resource* resource_; // where the pointer array comes from
 
     // index helpers (returning the index of the respective node)
     int parent(int i) { return (i - 1) / 2; }
@@ -0,0 +1,238 @@
+#include "RecordTranspose.h"
+#include "HuffmanTable.h"
+#include "DecodeTable.h"
+#include "ByteOrder.h"
+#include "CpuDispatch.h"
+
+// detectRecordStride looks at this much of the block
+static const size_t strideSampleBytes = 64 * 1024;
+
+// Below this many symbols a lane is decoded by walking the tree
+static const size_t laneMultiSymbolMinLength = 8192;
+
+// Stride must beat plain coding by this factor to be picked
+static const double strideGain = 0.97;
+
+/**
+ * Bytes of a lane with its own tree: header, tree and entropy (one bit per symbol at least)
+ */
+static double laneEstimate(const unsigned long long counts[256], size_t laneLength) {
+    int distinct = 0;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) distinct++;
+    }
+    double bits = entropyBits(counts);
+    if (bits < (double)laneLength) bits = (double)laneLength;
+    return 7 + (distinct * 10 - 1 + 7) / 8 + bits / 8;
+}
+
+/**
+ * Histograms of every lane, as they are and delta coded
+ */
+static void countLanes(const unsigned char* data, size_t length, unsigned int stride,
+                       unsigned long long* plain, unsigned long long* delta) {
+    for (size_t i = 0; i < (size_t)stride * 256; i++) {
+        plain[i] = 0;
+        delta[i] = 0;
+    }
+    for (size_t i = 0; i < length; i++) {
+        size_t lane = i % stride;
+        unsigned char previous = i >= stride ? data[i - stride] : 0;
+        plain[lane * 256 + data[i]]++;
+        delta[lane * 256 + (unsigned char)(data[i] - previous)]++;
+    }
+}
+
+static size_t laneLength(size_t length, unsigned int stride, unsigned int lane) {
+    return length / stride + (lane < length % stride ? 1 : 0);
+}
+
+/**
+ * Estimate per lane; useDelta (if given) gets whether delta coding is cheaper
+ */
+static double estimateLanes(const unsigned char* data, size_t length, unsigned int stride, bool* useDelta) {
+    unsigned long long* plain = new unsigned long long[(size_t)stride * 256];
+    unsigned long long* delta = new unsigned long long[(size_t)stride * 256];
+    countLanes(data, length, stride, plain, delta);
+
+    double total = 2;
+    for (unsigned int lane = 0; lane < stride; lane++) {
+        size_t count = laneLength(length, stride, lane);
+        if (count == 0) {
+            total += 3;
+            continue;
+        }
+        double plainBytes = laneEstimate(plain + (size_t)lane * 256, count);
+        double deltaBytes = laneEstimate(delta + (size_t)lane * 256, count);
+        if (useDelta) useDelta[lane] = deltaBytes < plainBytes;
+        total += deltaBytes < plainBytes ? deltaBytes : plainBytes;
+    }
+    delete[] plain;
+    delete[] delta;
+    return total;
+}
+
+unsigned int detectRecordStride(const unsigned char* data, size_t length) {
+    size_t sample = length < strideSampleBytes ? length : strideSampleBytes;
+    if (sample < 64) {
+        return 1;
+    }
+
+    unsigned long long counts[256];
+    countBytes(data, sample, counts);
+    double bestBytes = laneEstimate(counts, sample) * strideGain;
+    unsigned int best = 1;
+    for (unsigned int stride = 2; stride <= maxDetectedStride && stride * 8 <= sample; stride++) {
+        double bytes = estimateLanes(data, sample, stride, nullptr);
+        if (bytes < bestBytes) {
+            bestBytes = bytes;
+            best = stride;
+        }
+    }
+    return best;
+}
+
+double transposeEstimateBytes(const unsigned char* data, size_t length, unsigned int stride) {
+    return estimateLanes(data, length, stride, nullptr);
+}
+
+void transposeEncode(const unsigned char* data, size_t length, unsigned int stride, string& out) {
+    bool* useDelta = new bool[stride];
+    estimateLanes(data, length, stride, useDelta);
+    appendU16(out, stride);
+
+    unsigned char* lane = new unsigned char[length / stride + 1];
+    string codes;
+    for (unsigned int k = 0; k < stride; k++) {
+        size_t count = 0;
+        unsigned char previous = 0;
+        for (size_t i = k; i < length; i += stride) {
+            lane[count++] = useDelta[k] ? (unsigned char)(data[i] - previous) : data[i];
+            previous = data[i];
+        }
+        out.push_back(useDelta[k] ? 1 : 0);
+
+        unsigned long long counts[256];
+        countBytes(lane, count, counts);
+        HuffmanTable table;
+        if (count == 0 || !table.buildFromCounts(counts, false)) {
+            appendU16(out, 0);
+            continue;
+        }
+        const string& tree = table.getSerialized();
+        appendU16(out, (unsigned int)tree.size());
+        out += tree;
+
+        codes.clear();
+        appendPackedCodes(lane, count, table.getBits(), table.getLengths(), codes);
+        appendU32(out, (unsigned int)codes.size());
+        out += codes;
+    }
+    delete[] lane;
+    delete[] useDelta;
+}
+
+/**
+ * Walk the lane headers without decoding: true if they tile the stream and
+ * every lane's code bits can hold its bytes (each code is at least one bit)
+ */
+static bool lanesCoverLength(const unsigned char* stream, size_t streamLength, unsigned int stride,
+                             unsigned int rawLength) {
+    size_t position = 2;
+    for (unsigned int k = 0; k < stride; k++) {
+        size_t count = laneLength(rawLength, stride, k);
+        if (position + 3 > streamLength) {
+            return false;
+        }
+        unsigned int treeLength = readU16(stream + position + 1);
+        position += 3;
+        if (treeLength == 0) {
+            if (count != 0) return false;
+            continue;
+        }
+        if (position + treeLength + 4 > streamLength) {
+            return false;
+        }
+        position += treeLength;
+        unsigned long long codeLength = readU32(stream + position);
+        position += 4;
+        if (codeLength > streamLength - position || count > codeLength * 8) {
+            return false;
+        }
+        position += (size_t)codeLength;
+    }
+    return position == streamLength;
+}
+
+bool transposeDecode(const unsigned char* stream, size_t streamLength, unsigned int rawLength, string& out) {
+    if (streamLength < 2) {
+        return false;
+    }
+    unsigned int stride = readU16(stream);
+    if (stride == 0 || stride > maxRecordStride) {
+        return false;
+    }
+    // rawLength sizes the output and the lane buffer: check it against the lanes first
+    if (!lanesCoverLength(stream, streamLength, stride, rawLength)) {
+        return false;
+    }
+
+    size_t start = out.size();
+    out.resize(start + rawLength);
+    unsigned char* dest = (unsigned char*)&out[start];
+    unsigned char* lane = new unsigned char[rawLength / stride + 1];
+    size_t position = 2;
+    bool ok = true;
+    for (unsigned int k = 0; k < stride && ok; k++) {
+        size_t count = laneLength(rawLength, stride, k);
+        if (position + 3 > streamLength || stream[position] > 1) {
+            ok = false;
+            break;
+        }
+        bool delta = stream[position] == 1;
+        unsigned int treeLength = readU16(stream + position + 1);
+        position += 3;
+        if (treeLength == 0) {
+            ok = count == 0;
+            continue;
+        }
+
+        HuffmanTable table;
+        if (count == 0 || position + treeLength + 4 > streamLength || !table.load(stream + position, treeLength)) {
+            ok = false;
+            break;
+        }
+        position += treeLength;
+        unsigned int codeLength = readU32(stream + position);
+        position += 4;
+        if (codeLength > streamLength - position) {
+            ok = false;
+            break;
+        }
+
+        MemorySpanSource source(stream + position, codeLength);
+        BitReader<MemorySpanSource> reader(source);
+        MemorySpanSink sink(lane, count);
+        if (count >= laneMultiSymbolMinLength) {
+            MultiSymbolTable lookup(table.getRoot());
+            ok = decodeSymbolsMulti(lookup, reader, count, sink);
+        } else {
+            ok = decodeSymbols(table.getRoot(), reader, count, sink);
+        }
+        position += codeLength;
+
+        // Scatter back into records, undoing the delta
+        unsigned char previous = 0;
+        for (size_t j = 0; j < count && ok; j++) {
+            unsigned char byte = delta ? (unsigned char)(lane[j] + previous) : lane[j];
+            dest[k + j * stride] = byte;
+            previous = byte;
+        }
+    }
+    delete[] lane;
+    if (!ok || position != streamLength) {
+        out.resize(start);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,52 @@
+#ifndef MILESTONE_2_ADS_RECORDTRANSPOSE_H
+#define MILESTONE_2_ADS_RECORDTRANSPOSE_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/*
+  Record transposition for fixed-width binary data
+  Arrays of fixed-size records (timestamps, counters, floats) mix bytes with
+  very different statistics in one histogram: the high byte of a counter
+  barely changes while its low byte looks random. Transposing with the
+  record stride puts byte k of every record into lane k, each lane is
+  optionally delta coded (byte minus the lane's previous byte, mod 256) and
+  gets its own Huffman tree.
+
+  Encoded layout (after the block codec's mode byte and raw length):
+    [stride: 2]
+    per lane: [delta: 1][tree length: 2][serialized tree][code length: 4][code bits, MSB-first]
+  Lane k holds bytes k, k + stride, k + 2 * stride, ... A lane without
+  bytes has tree length 0 and no code length.
+*/
+
+const unsigned int maxRecordStride = 1024;
+
+// Strides detectRecordStride tries
+const unsigned int maxDetectedStride = 32;
+
+/**
+ * Record stride that makes the lanes cheapest to code, judged on a sample
+ * from the start of the block; 1 if transposing does not pay
+ */
+unsigned int detectRecordStride(const unsigned char* data, size_t length);
+
+/**
+ * Estimated size in bytes of transposeEncode's output
+ */
+double transposeEstimateBytes(const unsigned char* data, size_t length, unsigned int stride);
+
+/**
+ * Transpose a block into stride lanes, code each lane and append the stream to out
+ */
+void transposeEncode(const unsigned char* data, size_t length, unsigned int stride, string& out);
+
+/**
+ * Decode rawLength bytes of a transposed stream and append them to out
+ * Returns false if the stream is corrupt
+ */
+bool transposeDecode(const unsigned char* stream, size_t streamLength, unsigned int rawLength, string& out);
+
+#endif //MILESTONE_2_ADS_RECORDTRANSPOSE_H
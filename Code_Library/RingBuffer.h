@@ -0,0 +1,162 @@
+#ifndef MILESTONE_2_ADS_RINGBUFFER_H
+#define MILESTONE_2_ADS_RINGBUFFER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+
+/*
+  Bounded lock-free ring buffers for passing work between pipeline stages.
+    - SpscRing: one producer, one consumer (head/tail counters only)
+    - MpmcRing: any number of producers and consumers (Vyukov's bounded
+      queue, one sequence number per slot); used as MPSC and SPMC
+  tryPush/tryPop never block; push/pop back off (spin, yield, then sleep)
+  until they succeed, which keeps idle stages cheap without any locks.
+*/
+
+/**
+ * Backoff for a stage that found its queue full or empty
+ */
+inline void pipelineBackoff(int& attempts) {
+    attempts++;
+    if (attempts < 64) {
+        // busy spin: the other side is usually about to make progress
+    } else if (attempts < 128) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+template <typename T>
+class SpscRing {
+private:
+    T* slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head;  // next slot to read (consumer)
+    alignas(64) std::atomic<size_t> tail;  // next slot to write (producer)
+
+public:
+    explicit SpscRing(size_t minCapacity) {
+        size_t cap = 2;
+        while (cap < minCapacity) cap *= 2;
+        slots = new T[cap];
+        mask = cap - 1;
+        head.store(0);
+        tail.store(0);
+    }
+    ~SpscRing() { delete[] slots; }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    bool tryPush(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask) return false; // full
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false; // empty
+        value = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(const T& value) {
+        int attempts = 0;
+        while (!tryPush(value)) pipelineBackoff(attempts);
+    }
+
+    void pop(T& value) {
+        int attempts = 0;
+        while (!tryPop(value)) pipelineBackoff(attempts);
+    }
+};
+
+template <typename T>
+class MpmcRing {
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Slot* slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+
+public:
+    explicit MpmcRing(size_t minCapacity) {
+        size_t cap = 2;
+        while (cap < minCapacity) cap *= 2;
+        slots = new Slot[cap];
+        mask = cap - 1;
+        for (size_t i = 0; i < cap; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos.store(0);
+        dequeuePos.store(0);
+    }
+    ~MpmcRing() { delete[] slots; }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    bool tryPush(const T& value) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            long long diff = (long long)seq - (long long)pos;
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value) {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[pos & mask];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            long long diff = (long long)seq - (long long)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = slot.value;
+                    slot.sequence.store(pos + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(const T& value) {
+        int attempts = 0;
+        while (!tryPush(value)) pipelineBackoff(attempts);
+    }
+
+    void pop(T& value) {
+        int attempts = 0;
+        while (!tryPop(value)) pipelineBackoff(attempts);
+    }
+};
+
+#endif //MILESTONE_2_ADS_RINGBUFFER_H
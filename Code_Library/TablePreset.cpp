@@ -0,0 +1,218 @@
+#include "TablePreset.h"
+#include "IoBackend.h"
+#include <atomic>
+
+/*
+  Built-in preset trees, serialized (serializeTree format, byte padded).
+  They were generated once from per-mille byte weights for each kind of
+  data, every other byte value weight 1, and are shipped as bytes rather
+  than rebuilt at startup, so a change to how buildHuffmanTree breaks ties
+  can never change what an ID decodes to. Never edit these; add a new ID.
+*/
+
+// English prose (weights roughly per-mille letter frequencies)
+static const unsigned char englishTree[] = {
+    0x00, 0x37, 0xd0, 0x26, 0xe2, 0xb8, 0x75, 0xb5, 0x2e, 0xdf, 0x70, 0x9f, 0xa0, 0x10, 0x15, 0x31,
+    0xf8, 0xc0, 0x5c, 0x05, 0x4c, 0xf0, 0xf8, 0xda, 0x68, 0xa0, 0xef, 0x42, 0x5c, 0x6a, 0xea, 0xa0,
+    0xbe, 0xdf, 0xac, 0xe0, 0x6d, 0x76, 0xce, 0x05, 0x80, 0x86, 0xc6, 0xd1, 0xcf, 0x38, 0xa5, 0x65,
+    0x5e, 0x6c, 0xb1, 0x8f, 0xc8, 0x30, 0xf8, 0x80, 0xbe, 0x4f, 0x9d, 0x8e, 0xca, 0x52, 0xf6, 0xc3,
+    0x84, 0x9b, 0x36, 0xc4, 0xe2, 0x93, 0x56, 0xaa, 0x54, 0x13, 0x09, 0x92, 0x66, 0xe7, 0x6c, 0x44,
+    0xae, 0xb1, 0x59, 0x3e, 0xd8, 0x17, 0xea, 0xfe, 0x52, 0x4f, 0x16, 0x6a, 0x70, 0xa0, 0xa8, 0xec,
+    0x5e, 0x30, 0x06, 0xba, 0x2a, 0xd6, 0x55, 0x89, 0xe7, 0xcd, 0xca, 0x8b, 0x21, 0x47, 0x93, 0xca,
+    0xe1, 0x41, 0x44, 0xc5, 0xb9, 0xdd, 0x1e, 0x8f, 0x4b, 0x83, 0x0b, 0x2d, 0x4a, 0xf6, 0xf4, 0xf5,
+    0xfb, 0x25, 0x00, 0xc9, 0x49, 0x18, 0xe8, 0x41, 0xee, 0xc6, 0xcd, 0xee, 0xc1, 0xa0, 0xd0, 0xcd,
+    0x93, 0xb7, 0xca, 0x20, 0x3e, 0x98, 0x4a, 0x21, 0xc7, 0xe4, 0x2b, 0xfb, 0xf5, 0xb1, 0x79, 0x0d,
+    0x3e, 0xa2, 0x68, 0x44, 0xf3, 0xef, 0xac, 0x78, 0x64, 0xf2, 0x8c, 0x2e, 0x19, 0x78, 0xa3, 0x00,
+    0x55, 0x75, 0x6d, 0x15, 0x44, 0xfc, 0xff, 0xdf, 0x7a, 0x00, 0xef, 0xf8, 0x11, 0x79, 0x7d, 0x50,
+    0x36, 0x7b, 0x45, 0x6f, 0x6e, 0x7e, 0xe3, 0xef, 0xec, 0x1c, 0x73, 0xfa, 0x0e, 0xa7, 0x54, 0xee,
+    0xc1, 0x9c, 0x58, 0xc0, 0x21, 0x91, 0x97, 0x33, 0x9a, 0x70, 0xf8, 0x8e, 0x96, 0xb4, 0x46, 0xba,
+    0xee, 0x8f, 0x4c, 0xd7, 0xec, 0x1c, 0x9e, 0x58, 0x66, 0x33, 0x2d, 0xde, 0xf1, 0x3a, 0x9c, 0x8c,
+    0x16, 0x0e, 0x42, 0x44, 0x64, 0x6f, 0x56, 0x46, 0xc2, 0x02, 0x97, 0x97, 0x7f, 0xa0, 0x6a, 0x7b,
+    0x3d, 0x04, 0x2e, 0x28, 0x94, 0x94, 0xfe, 0x43, 0xef, 0x42, 0xa4, 0xd2, 0x69, 0x4f, 0x87, 0xc5,
+    0xb2, 0xad, 0x0c, 0xe6, 0x75, 0xda, 0xd1, 0x93, 0xdb, 0xda, 0x3b, 0xef, 0xb2, 0x5d, 0x01, 0x77,
+    0xb6, 0xac, 0xc9, 0x74, 0xb0, 0xba, 0xd8, 0xc2, 0x85, 0x43, 0x55, 0xe5, 0xa5, 0x16, 0x44, 0xa7,
+    0x53, 0x4b, 0x5a, 0x91, 0x27, 0xb1, 0x48, 0x05, 0xca, 0xe7, 0x65, 0x2d, 0x16, 0xe5, 0xa6, 0xde
+};
+
+// JSON documents: structure characters, keys and numbers
+static const unsigned char jsonTree[] = {
+    0x05, 0xd2, 0xe5, 0x20, 0x91, 0x02, 0xed, 0x6b, 0x59, 0x85, 0x73, 0x6e, 0xe0, 0x45, 0x8f, 0x07,
+    0x85, 0xe5, 0x8e, 0x2e, 0xb6, 0x40, 0x3b, 0xd9, 0x95, 0x57, 0x56, 0x69, 0x74, 0xcd, 0x1e, 0x90,
+    0x76, 0xb3, 0xce, 0x0e, 0xd8, 0x8d, 0xf7, 0xdd, 0x2a, 0x90, 0x7f, 0xa0, 0x28, 0x7c, 0x7c, 0xd5,
+    0x4a, 0x9a, 0x7d, 0x40, 0xc5, 0x51, 0x9f, 0x6c, 0x11, 0x4a, 0xca, 0xbc, 0x59, 0x65, 0xc0, 0x23,
+    0x3c, 0xf7, 0x2b, 0x5a, 0x71, 0xab, 0x0d, 0xa5, 0x68, 0x74, 0x3a, 0x2e, 0xac, 0x68, 0xe9, 0xf5,
+    0x1f, 0x7b, 0xe0, 0xb6, 0x87, 0x36, 0x18, 0x8a, 0x4a, 0x49, 0x7e, 0xfd, 0x2b, 0xab, 0x8d, 0xe6,
+    0xf5, 0x02, 0x82, 0x9b, 0xed, 0xc3, 0x85, 0xb5, 0x05, 0x1f, 0x1e, 0xf3, 0x64, 0x49, 0x45, 0x46,
+    0x12, 0x2b, 0xdb, 0xb5, 0x37, 0x36, 0x67, 0xf4, 0x0d, 0x0e, 0x88, 0x3d, 0x9e, 0xd4, 0x7a, 0x7a,
+    0x75, 0xaa, 0x08, 0xc7, 0x1c, 0x6b, 0x2a, 0xcd, 0x74, 0x54, 0xac, 0xec, 0xd0, 0xb8, 0xb8, 0x10,
+    0x48, 0x9a, 0x4f, 0x4f, 0x33, 0x99, 0xd4, 0xef, 0xde, 0x22, 0x32, 0x36, 0x37, 0x1c, 0x7e, 0x6f,
+    0xea, 0x06, 0x04, 0x3c, 0x7e, 0x45, 0x83, 0x86, 0x7a, 0x7d, 0x68, 0x74, 0x76, 0xb6, 0x0f, 0xec,
+    0x0d, 0x00, 0xff, 0x99, 0x3c, 0xa3, 0xf5, 0x3f, 0x1c, 0xed, 0x4b, 0x73, 0xba, 0x33, 0x52, 0x64,
+    0x4a, 0x4b, 0x6c, 0x00, 0x62, 0xf1, 0x8f, 0x54, 0x20, 0xf8, 0xcf, 0x1f, 0x3f, 0xa8, 0xfc, 0x60,
+    0x12, 0x1a, 0x19, 0x88, 0xa2, 0x32, 0x52, 0x4b, 0x18, 0x39, 0x7c, 0xc7, 0x23, 0x92, 0x76, 0x7b,
+    0x68, 0x34, 0x34, 0x71, 0x38, 0xae, 0xbf, 0x60, 0xf3, 0xfa, 0x1d, 0xce, 0xe8, 0x6c, 0x76, 0x4d,
+    0x7e, 0xc0, 0xc8, 0x52, 0x1f, 0xc8, 0x38, 0xf7, 0x62, 0x5f, 0x0c, 0x39, 0xf2, 0x88, 0x30, 0xb8,
+    0x60, 0x33, 0x14, 0xc5, 0x2f, 0x2e, 0x7d, 0x30, 0x8a, 0x16, 0x0e, 0xbb, 0x7b, 0x5f, 0x55, 0xf2,
+    0xa7, 0x6a, 0x2f, 0xc9, 0xf7, 0xee, 0xf4, 0x59, 0x67, 0x49, 0x60, 0x51, 0x6e, 0x2a, 0x75, 0x50,
+    0xa0, 0xd2, 0x57, 0x8b, 0xbc, 0xdc, 0x26, 0x33, 0x34, 0xd2, 0x6c, 0x4e, 0x66, 0x09, 0xac, 0xe0,
+    0x4c, 0x89, 0x6c, 0xb9, 0x67, 0xb4, 0x2d, 0xd6, 0x90, 0xb1, 0x5e, 0x61, 0x57, 0x35, 0x86, 0xde
+};
+
+// Timestamped ASCII log lines
+static const unsigned char logTree[] = {
+    0x09, 0xb2, 0xcb, 0x3a, 0x4d, 0xc0, 0xff, 0x40, 0x5f, 0xa8, 0xf9, 0xfb, 0x87, 0xbf, 0x17, 0xf1,
+    0xf2, 0xa1, 0x3d, 0xf1, 0x03, 0xe1, 0x86, 0x7b, 0xa4, 0x21, 0xc2, 0xda, 0xb8, 0x15, 0xc3, 0xc5,
+    0x94, 0x65, 0xa2, 0x42, 0x29, 0x53, 0x76, 0x3b, 0x27, 0x6b, 0x36, 0xbe, 0xdf, 0x81, 0x98, 0xa6,
+    0x35, 0x7a, 0xc3, 0xfb, 0x03, 0x40, 0x3f, 0xf7, 0x55, 0xb4, 0x49, 0xa9, 0xa9, 0x2d, 0x2c, 0xf8,
+    0xe1, 0x58, 0x3c, 0x20, 0x05, 0x0f, 0x0e, 0x92, 0x64, 0xee, 0xc3, 0xeb, 0x82, 0x60, 0x28, 0x06,
+    0x67, 0x34, 0xef, 0x65, 0xc2, 0x47, 0x8f, 0x79, 0xb2, 0x06, 0x73, 0x3a, 0x84, 0xc4, 0xc6, 0x2b,
+    0x16, 0xfa, 0x50, 0x4c, 0xfe, 0x81, 0xd4, 0xa8, 0x03, 0xd1, 0xe9, 0x45, 0xec, 0x16, 0x2b, 0x80,
+    0x78, 0xfc, 0xab, 0xdf, 0xdc, 0x86, 0xc6, 0xdd, 0xd8, 0x30, 0xe1, 0xf1, 0x1c, 0x9e, 0x59, 0x1d,
+    0x9d, 0xbd, 0x7e, 0xc0, 0x35, 0xba, 0xe7, 0x33, 0x9a, 0x74, 0xaa, 0x2d, 0x1e, 0x90, 0x6a, 0xa5,
+    0x4d, 0x2e, 0x98, 0xcf, 0x41, 0x17, 0x7b, 0xc0, 0x6c, 0x76, 0x4a, 0xc6, 0xbc, 0x84, 0x44, 0x5e,
+    0xac, 0x60, 0xbe, 0x4f, 0x9c, 0x7e, 0x41, 0xba, 0xaf, 0x36, 0xfb, 0x80, 0x52, 0x32, 0x2f, 0xe4,
+    0x1c, 0xa5, 0x65, 0x5f, 0x99, 0xfd, 0x8d, 0x6c, 0x1b, 0x68, 0xb3, 0x69, 0x5a, 0xb5, 0x80, 0x8a,
+    0xca, 0xdb, 0xfe, 0x09, 0x1c, 0xf3, 0xbc, 0x37, 0x11, 0xdf, 0xf0, 0x38, 0xb1, 0x8b, 0x31, 0x79,
+    0x3d, 0xb0, 0xe6, 0x87, 0x44, 0x37, 0xb0, 0x26, 0xef, 0x78, 0x5e, 0xa3, 0xc9, 0xe7, 0xcc, 0x18,
+    0xdc, 0x73, 0xc9, 0x92, 0x3e, 0xd8, 0x16, 0x23, 0x13, 0x68, 0x97, 0x01, 0x1a, 0xeb, 0xba, 0x36,
+    0xa3, 0xad, 0x27, 0x76, 0xfb, 0x8b, 0x39, 0xce, 0xd3, 0xba, 0x7d, 0x50, 0xe3, 0x6c, 0x1b, 0xed,
+    0xc9, 0x59, 0xd9, 0xa0, 0xb0, 0xb1, 0xa8, 0xd4, 0xb9, 0x55, 0x63, 0x9f, 0xd0, 0x43, 0x23, 0x2b,
+    0x95, 0xbc, 0x16, 0xe5, 0x92, 0xb6, 0xb4, 0xdc, 0xc9, 0x6d, 0x85, 0x74, 0x57, 0x49, 0x14, 0xa2,
+    0xa8, 0x90, 0x08, 0x52, 0x93, 0x4f, 0x28, 0x94, 0x55, 0x3a, 0xa4, 0x27, 0xb5, 0xf5, 0x56, 0xae,
+    0x51, 0xe5, 0xe4, 0xa6, 0x59, 0x46, 0x13, 0x09, 0x92, 0x67, 0x39, 0x26, 0x93, 0x54, 0xc6, 0x70
+};
+
+// Structured binary data: lots of zeros, small integers and 0xFF padding
+static const unsigned char binaryTree[] = {
+    0x40, 0x02, 0x05, 0x04, 0x40, 0xc3, 0xe7, 0x84, 0x5f, 0x93, 0xeb, 0xe8, 0xf0, 0xc4, 0x5e, 0x9c,
+    0x51, 0xf7, 0xc1, 0x3e, 0x18, 0x68, 0x30, 0x84, 0x41, 0x50, 0x70, 0xbd, 0xdf, 0x13, 0x9b, 0x99,
+    0xd3, 0x89, 0x3b, 0x79, 0x21, 0x0b, 0x86, 0x37, 0x35, 0x23, 0x79, 0x51, 0x70, 0x34, 0x10, 0x10,
+    0x0e, 0xf6, 0x41, 0xd1, 0xa5, 0x96, 0x3b, 0x23, 0x8d, 0x9e, 0x12, 0xca, 0xca, 0x57, 0x57, 0x36,
+    0x1a, 0xa4, 0xb6, 0xb6, 0x1f, 0x5a, 0x0b, 0xf3, 0x40, 0x3c, 0xd8, 0xb7, 0xba, 0x86, 0x3f, 0x91,
+    0xf7, 0xf6, 0x20, 0x42, 0x61, 0x4f, 0xf4, 0x3c, 0x1f, 0x8c, 0x0b, 0xb9, 0x91, 0x2c, 0x36, 0x27,
+    0x0e, 0x4e, 0x38, 0xf9, 0xd6, 0xf6, 0x50, 0x5d, 0x6e, 0xcf, 0x5d, 0x10, 0x38, 0x91, 0x46, 0xd6,
+    0xa6, 0x6c, 0xf5, 0x0d, 0xbe, 0x98, 0x57, 0xf7, 0xe9, 0x55, 0x54, 0xae, 0xd7, 0x9b, 0x69, 0x48,
+    0x17, 0x49, 0xd3, 0xd1, 0x22, 0x3b, 0x19, 0x37, 0x82, 0x46, 0x3d, 0xb8, 0x77, 0x9e, 0x8a, 0x47,
+    0xa7, 0xab, 0xc4, 0xf0, 0x36, 0x3a, 0x96, 0xef, 0x46, 0x6c, 0xaa, 0x8d, 0xa6, 0x9c, 0x79, 0x28,
+    0xcb, 0x94, 0x70, 0xec, 0xd2, 0x5d, 0xda, 0x40, 0x21, 0xb1, 0xb7, 0x6a, 0x48, 0x77, 0xee, 0x0f,
+    0x16, 0x38, 0x6e, 0xb4, 0x8a, 0xd4, 0x58, 0xe7, 0x66, 0x5c, 0x58, 0x98, 0x51, 0xf1, 0xee, 0x56,
+    0x6c, 0xe8, 0x65, 0xdc, 0x2a, 0x78, 0xe6, 0xe6, 0x93, 0x5b, 0x59, 0xaf, 0xac, 0x2a, 0xda, 0xd0,
+    0x1e, 0xac, 0x4b, 0x93, 0x9c, 0x2d, 0x93, 0x67, 0x57, 0x2a, 0x3f, 0x73, 0xf7, 0x22, 0x9c, 0x7e,
+    0xaf, 0xea, 0xe4, 0xb8, 0x39, 0xf6, 0x86, 0x62, 0x98, 0x75, 0x32, 0xce, 0x64, 0x98, 0x4c, 0xec,
+    0xe9, 0x95, 0x94, 0x8c, 0x4c, 0x56, 0x09, 0x80, 0x3c, 0xb8, 0xc7, 0xd3, 0x06, 0x7c, 0x70, 0xaf,
+    0x95, 0x08, 0x75, 0xf2, 0x8e, 0x94, 0x94, 0x9c, 0x5c, 0x5e, 0x3c, 0x68, 0x4d, 0x2d, 0x2e, 0x5d,
+    0x34, 0x9d, 0xdd, 0xde, 0xf9, 0x08, 0xbc, 0xde, 0x9f, 0x69, 0x01, 0xae, 0x8a, 0xb7, 0xda, 0x20,
+    0x2c, 0xd1, 0x95, 0x43, 0x42, 0x7b, 0x31, 0x08, 0x74, 0x74, 0x70, 0x73, 0xe8, 0xbc, 0xbc, 0xdc,
+    0x69, 0x5a, 0xbd, 0x60, 0x4d, 0xed, 0xeb, 0x6d, 0xb8, 0xeb, 0x52, 0x96, 0xa8, 0xd6, 0x03, 0xfe
+};
+
+struct BuiltInPreset {
+    const unsigned char* tree;
+    size_t length;
+};
+
+static const BuiltInPreset builtInPresets[] = {
+    {nullptr, 0}, // TABLE_NONE
+    {englishTree, sizeof(englishTree)},
+    {jsonTree, sizeof(jsonTree)},
+    {logTree, sizeof(logTree)},
+    {binaryTree, sizeof(binaryTree)},
+};
+static const int builtInCount = sizeof(builtInPresets) / sizeof(builtInPresets[0]);
+
+/**
+ * All tables by ID. Built-in presets are loaded once on first use; custom
+ * slots are filled at most once and never freed, so readers need no lock.
+ */
+struct PresetRegistry {
+    HuffmanTable builtIn[builtInCount];
+    std::atomic<HuffmanTable*> custom[256];
+
+    PresetRegistry() {
+        for (int id = 1; id < builtInCount; id++) {
+            builtIn[id].load(builtInPresets[id].tree, builtInPresets[id].length);
+        }
+        for (int i = 0; i < 256; i++) {
+            custom[i].store(nullptr);
+        }
+    }
+
+    ~PresetRegistry() {
+        for (int i = 0; i < 256; i++) {
+            delete custom[i].load();
+        }
+    }
+};
+
+static PresetRegistry& presetRegistry() {
+    static PresetRegistry registry; // thread-safe one-time initialization
+    return registry;
+}
+
+const HuffmanTable* findPresetTable(unsigned char id) {
+    if (id == TABLE_NONE || id == TABLE_AUTO) {
+        return nullptr;
+    }
+    PresetRegistry& registry = presetRegistry();
+    if (id < builtInCount) {
+        return &registry.builtIn[id];
+    }
+    return registry.custom[id].load(std::memory_order_acquire);
+}
+
+bool registerPresetTable(unsigned char id, const string& serializedTree) {
+    if (id < TABLE_CUSTOM_FIRST || id == TABLE_AUTO) {
+        return false;
+    }
+    // Preset blocks are encoded without a histogram, so every byte needs a code
+    HuffmanTable* table = new HuffmanTable();
+    bool complete = table->load((const unsigned char*)serializedTree.data(), serializedTree.size());
+    for (int i = 0; complete && i < 256; i++) {
+        if (table->codeLength((unsigned char)i) == 0) complete = false;
+    }
+    if (!complete) {
+        delete table;
+        return false;
+    }
+
+    HuffmanTable* expected = nullptr;
+    if (!presetRegistry().custom[id].compare_exchange_strong(expected, table, std::memory_order_acq_rel)) {
+        delete table; // ID already taken
+        return false;
+    }
+    return true;
+}
+
+TableTrainer::TableTrainer() {
+    for (int i = 0; i < 256; i++) {
+        counts[i] = 0;
+    }
+}
+
+void TableTrainer::addSample(const unsigned char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        counts[data[i]]++;
+    }
+}
+
+bool TableTrainer::addFile(const string& filename) {
+    unique_ptr<SequentialReader> reader = openSequentialReader(filename);
+    if (!reader) {
+        return false;
+    }
+    const unsigned char* data;
+    long long length;
+    while ((length = reader->next(data)) > 0) {
+        addSample(data, (size_t)length);
+    }
+    return length == 0;
+}
+
+bool TableTrainer::build(HuffmanTable& table) const {
+    bool any = false;
+    for (int i = 0; i < 256; i++) {
+        if (counts[i] > 0) any = true;
+    }
+    // Every byte keeps a code, so messages unlike the corpus still encode
+    return any && table.buildFromCounts(counts, true);
+}
@@ -0,0 +1,68 @@
+#ifndef MILESTONE_2_ADS_TABLEPRESET_H
+#define MILESTONE_2_ADS_TABLEPRESET_H
+
+#include <string>
+#include "HuffmanTable.h"
+
+using namespace std;
+
+/*
+  Table presets
+  Predefined Huffman tables referenced by a one-byte ID instead of a
+  serialized tree, so small messages skip the histogram, the tree build and
+  the tree header. Built-in presets are fixed forever: an ID that was once
+  written must always decode the same way, so new presets get new IDs.
+  IDs from TABLE_CUSTOM_FIRST up are for tables trained from a corpus and
+  registered by the application on both the compressing and the
+  decompressing side.
+*/
+
+enum TablePresetId : unsigned char {
+    TABLE_NONE = 0,           // no preset: build a table from the data
+    TABLE_ENGLISH_TEXT = 1,
+    TABLE_JSON = 2,
+    TABLE_ASCII_LOG = 3,
+    TABLE_BINARY = 4,
+    TABLE_CUSTOM_FIRST = 128, // 128..254 are free for registered tables
+    TABLE_AUTO = 255          // encoder picks the smallest built-in preset or own tree
+};
+
+/**
+ * Table for an ID: a built-in preset or a registered custom table.
+ * Returns nullptr for unknown IDs. Safe to call from any thread.
+ */
+const HuffmanTable* findPresetTable(unsigned char id);
+
+/**
+ * Register a custom table (serialized tree) under an ID in the custom range.
+ * Fails if the ID is outside the range, already taken, or the tree is
+ * invalid or does not give every byte value a code.
+ */
+bool registerPresetTable(unsigned char id, const string& serializedTree);
+
+/*
+  TableTrainer class
+  Collects byte counts from a sample corpus and builds a table that can
+  code every byte value, ready to be registered as a custom preset.
+*/
+class TableTrainer {
+private:
+    unsigned long long counts[256];
+
+public:
+    TableTrainer();
+
+    void addSample(const unsigned char* data, size_t length);
+
+    /**
+     * Add a whole file to the corpus, false if it cannot be read
+     */
+    bool addFile(const string& filename);
+
+    /**
+     * Build the trained table, false if no samples were added
+     */
+    bool build(HuffmanTable& table) const;
+};
+
+#endif //MILESTONE_2_ADS_TABLEPRESET_H
@@ -0,0 +1,314 @@
+#include "WorkStealingPool.h"
+#include <chrono>
+
+// Which pool (and which worker of it) the current thread belongs to
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local int currentIndex = -1;
+
+WorkStealingDeque::Ring::Ring(long long cap) {
+    capacity = cap;
+    slots = new std::atomic<PoolTask*>[capacity];
+    previous = nullptr;
+}
+
+WorkStealingDeque::Ring::~Ring() {
+    delete[] slots;
+}
+
+WorkStealingDeque::WorkStealingDeque(long long initialCapacity) {
+    long long cap = 2;
+    while (cap < initialCapacity) {
+        cap *= 2; // capacity must be a power of two for the index mask
+    }
+    top.store(0, std::memory_order_relaxed);
+    bottom.store(0, std::memory_order_relaxed);
+    ring.store(new Ring(cap), std::memory_order_relaxed);
+}
+
+WorkStealingDeque::~WorkStealingDeque() {
+    Ring* r = ring.load(std::memory_order_relaxed);
+    while (r) {
+        Ring* previous = r->previous;
+        delete r;
+        r = previous;
+    }
+}
+
+WorkStealingDeque::Ring* WorkStealingDeque::grow(Ring* old, long long b, long long t) {
+    Ring* bigger = new Ring(old->capacity * 2);
+    for (long long i = t; i < b; i++) {
+        bigger->put(i, old->get(i));
+    }
+    bigger->previous = old;
+    ring.store(bigger, std::memory_order_release);
+    return bigger;
+}
+
+void WorkStealingDeque::push(PoolTask* task) {
+    long long b = bottom.load(std::memory_order_relaxed);
+    long long t = top.load(std::memory_order_acquire);
+    Ring* r = ring.load(std::memory_order_relaxed);
+    if (b - t > r->capacity - 1) {
+        r = grow(r, b, t);
+    }
+    r->put(b, task);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+PoolTask* WorkStealingDeque::pop() {
+    long long b = bottom.load(std::memory_order_relaxed) - 1;
+    Ring* r = ring.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed); // was empty
+        return nullptr;
+    }
+
+    PoolTask* task = r->get(b);
+    if (t == b) {
+        // Last element: race against thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            task = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return task;
+}
+
+PoolTask* WorkStealingDeque::steal() {
+    long long t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long b = bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+
+    Ring* r = ring.load(std::memory_order_acquire);
+    PoolTask* task = r->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr; // another thief or the owner got it
+    }
+    return task;
+}
+
+bool WorkStealingDeque::empty() const {
+    return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+}
+
+WorkStealingPool::WorkStealingPool(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+    }
+    workerCount = threads;
+    queuedTasks.store(0);
+    stopping.store(false);
+
+    workers = new Worker[workerCount];
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers[i].thread = std::thread(&WorkStealingPool::workerLoop, this, (int)i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping.store(true);
+    }
+    sleepCondition.notify_all();
+    for (unsigned int i = 0; i < workerCount; i++) {
+        workers[i].thread.join();
+    }
+    delete[] workers;
+
+    // Tasks nobody waited for are dropped
+    for (PoolTask* task : injected) {
+        delete task;
+    }
+}
+
+int WorkStealingPool::currentWorker() const {
+    return (currentPool == this) ? currentIndex : -1;
+}
+
+void WorkStealingPool::submit(PoolTask* task) {
+    int self = currentWorker();
+    if (self >= 0) {
+        workers[self].deque.push(task);
+    } else {
+        std::lock_guard<std::mutex> lock(injectedMutex);
+        injected.push_back(task);
+    }
+
+    queuedTasks.fetch_add(1);
+    {
+        // Taking the lock orders this wake-up after a sleeper's predicate check
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_one();
+}
+
+/**
+ * Own deque first, then the injection queue, then steal from the others
+ * starting at a different victim each time
+ */
+PoolTask* WorkStealingPool::takeTask(int self) {
+    PoolTask* task = nullptr;
+    if (self >= 0) {
+        task = workers[self].deque.pop();
+    }
+
+    if (!task) {
+        std::lock_guard<std::mutex> lock(injectedMutex);
+        if (!injected.empty()) {
+            task = injected.front();
+            injected.pop_front();
+        }
+    }
+
+    if (!task && queuedTasks.load(std::memory_order_relaxed) > 0) {
+        thread_local unsigned int victimSeed = 0;
+        unsigned int start = victimSeed++;
+        for (unsigned int i = 0; i < workerCount && !task; i++) {
+            unsigned int victim = (start + i) % workerCount;
+            if ((int)victim != self) {
+                task = workers[victim].deque.steal();
+            }
+        }
+    }
+
+    if (task) {
+        queuedTasks.fetch_sub(1);
+    }
+    return task;
+}
+
+void WorkStealingPool::execute(PoolTask* task) {
+    std::exception_ptr taskError;
+    try {
+        task->fn();
+    } catch (...) {
+        taskError = std::current_exception();
+    }
+    TaskGroup* group = task->group;
+    delete task;
+    group->finishTask(taskError);
+}
+
+bool WorkStealingPool::runOneTask() {
+    PoolTask* task = takeTask(currentWorker());
+    if (!task) {
+        return false;
+    }
+    execute(task);
+    return true;
+}
+
+void WorkStealingPool::workerLoop(int index) {
+    currentPool = this;
+    currentIndex = index;
+
+    while (true) {
+        PoolTask* task = takeTask(index);
+        if (task) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [this]() {
+            return stopping.load() || queuedTasks.load() > 0;
+        });
+        if (stopping.load() && queuedTasks.load() == 0) {
+            break;
+        }
+    }
+
+    currentPool = nullptr;
+    currentIndex = -1;
+}
+
+TaskGroup::TaskGroup(WorkStealingPool& workPool) : pool(workPool) {
+    pending.store(0);
+}
+
+TaskGroup::~TaskGroup() {
+    // Never leave tasks running that point at this group
+    while (pending.load() > 0) {
+        if (!pool.runOneTask()) {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCondition.wait_for(lock, std::chrono::microseconds(200), [this]() { return pending.load() == 0; });
+        }
+    }
+    std::lock_guard<std::mutex> lock(doneMutex); // last finisher has let go of the group
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    pending.fetch_add(1);
+    pool.submit(new PoolTask{std::move(task), this});
+}
+
+void TaskGroup::finishTask(std::exception_ptr taskError) {
+    // Decrement under the lock: once a waiter can take the lock after seeing
+    // zero, this thread no longer touches the group
+    std::lock_guard<std::mutex> lock(doneMutex);
+    if (taskError && !error) {
+        error = taskError;
+    }
+    if (pending.fetch_sub(1) == 1) {
+        doneCondition.notify_all();
+    }
+}
+
+void TaskGroup::wait() {
+    while (pending.load() > 0) {
+        // Help with queued work instead of blocking a core
+        if (!pool.runOneTask()) {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            doneCondition.wait_for(lock, std::chrono::microseconds(200), [this]() { return pending.load() == 0; });
+        }
+    }
+
+    std::exception_ptr taskError;
+    {
+        std::lock_guard<std::mutex> lock(doneMutex); // also waits for the last finisher to let go
+        taskError = error;
+        error = nullptr;
+    }
+    if (taskError) {
+        std::rethrow_exception(taskError);
+    }
+}
+
+void parallelFor(WorkStealingPool& pool, size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t)>& body) {
+    if (begin >= end) return;
+    if (grain == 0) grain = 1;
+
+    TaskGroup group(pool);
+    std::function<void(size_t, size_t)> split = [&](size_t from, size_t to) {
+        // Hand the upper half to the pool and keep splitting the lower half
+        while (to - from > grain) {
+            size_t mid = from + (to - from) / 2;
+            group.run([&split, mid, to]() { split(mid, to); });
+            to = mid;
+        }
+        body(from, to);
+    };
+
+    try {
+        split(begin, end);
+    } catch (...) {
+        // Queued halves still call split: let them finish before it goes away
+        try {
+            group.wait();
+        } catch (...) {
+        }
+        throw;
+    }
+    group.wait();
+}
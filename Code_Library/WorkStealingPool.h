@@ -0,0 +1,143 @@
+#ifndef MILESTONE_2_ADS_WORKSTEALINGPOOL_H
+#define MILESTONE_2_ADS_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/*
+  Work-stealing task scheduler
+  Every worker owns a Chase-Lev deque: it pushes and pops its own tasks at
+  the bottom (LIFO, cache friendly) while idle workers steal from the top
+  (FIFO, the biggest pieces of work). Tasks submitted from outside the pool
+  go through a shared injection queue. Uneven work (e.g. files of wildly
+  different sizes) keeps every core busy without static partitioning.
+*/
+
+class TaskGroup;
+
+struct PoolTask {
+    std::function<void()> fn;
+    TaskGroup* group;
+};
+
+/**
+ * Chase-Lev work-stealing deque (Le et al., "Correct and Efficient
+ * Work-Stealing for Weak Memory Models"). push/pop by the owner only,
+ * steal by any thread. The ring grows on demand; old rings are kept until
+ * the deque is destroyed because a thief may still be reading them.
+ */
+class WorkStealingDeque {
+private:
+    struct Ring {
+        long long capacity;
+        std::atomic<PoolTask*>* slots;
+        Ring* previous;   // retired ring, freed with the deque
+
+        explicit Ring(long long cap);
+        ~Ring();
+        PoolTask* get(long long i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(long long i, PoolTask* task) { slots[i & (capacity - 1)].store(task, std::memory_order_relaxed); }
+    };
+
+    std::atomic<long long> top;
+    std::atomic<long long> bottom;
+    std::atomic<Ring*> ring;
+
+    Ring* grow(Ring* old, long long b, long long t);
+
+public:
+    explicit WorkStealingDeque(long long initialCapacity = 256);
+    ~WorkStealingDeque();
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    void push(PoolTask* task);   // owner only
+    PoolTask* pop();             // owner only, nullptr if empty
+    PoolTask* steal();           // any thread, nullptr if empty or lost a race
+    bool empty() const;
+};
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned int threads = 0); // 0 = one per hardware thread
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    unsigned int threadCount() const { return workerCount; }
+
+    /**
+     * Run one queued task on the calling thread if any is available.
+     * Used by waiting threads so they help instead of blocking.
+     */
+    bool runOneTask();
+
+private:
+    friend class TaskGroup;
+
+    struct Worker {
+        WorkStealingDeque deque;
+        std::thread thread;
+    };
+
+    Worker* workers;
+    unsigned int workerCount;
+    std::deque<PoolTask*> injected;        // tasks from non-worker threads
+    std::mutex injectedMutex;
+    std::atomic<long long> queuedTasks;    // pushed but not yet taken
+    std::atomic<bool> stopping;
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+
+    void submit(PoolTask* task);
+    PoolTask* takeTask(int self);
+    void execute(PoolTask* task);
+    void workerLoop(int index);
+    int currentWorker() const;             // index of the calling worker, -1 outside the pool
+};
+
+/**
+ * A set of tasks that can be waited on together
+ * wait() runs queued tasks while it waits and rethrows the first exception
+ * thrown by a task of the group. The destructor waits as well.
+ */
+class TaskGroup {
+public:
+    explicit TaskGroup(WorkStealingPool& workPool);
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+
+private:
+    friend class WorkStealingPool;
+
+    WorkStealingPool& pool;
+    std::atomic<long long> pending;
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::exception_ptr error;
+
+    void finishTask(std::exception_ptr taskError);
+};
+
+/**
+ * Run body(rangeBegin, rangeEnd) over [begin, end) in pieces of at most
+ * grain elements. The range is split recursively so idle workers steal
+ * large halves first and load stays balanced when pieces differ in cost.
+ */
+void parallelFor(WorkStealingPool& pool, size_t begin, size_t end, size_t grain,
+                 const std::function<void(size_t, size_t)>& body);
+
+#endif //MILESTONE_2_ADS_WORKSTEALINGPOOL_H
@@ -0,0 +1,100 @@
+#include "AdaptiveHuffman.h"
+#include <gtest/gtest.h>
+#include <string>
+
+using namespace std;
+
+// Telemetry-like messages: mostly the same shape, changing numbers
+static string telemetryMessage(int i) {
+    return "sensor=" + to_string(i % 7) + " temp=" + to_string(20 + i % 13) + "." + to_string(i % 10)
+           + " status=ok seq=" + to_string(i) + "\n";
+}
+
+TEST(AdaptiveHuffmanTest, MessagesRoundTripOneAtATimeTest) {
+    AdaptiveEncoder encoder;
+    AdaptiveDecoder decoder;
+    size_t rawBytes = 0;
+    size_t frameBytes = 0;
+    for (int i = 0; i < 2000; i++) {
+        string message = telemetryMessage(i);
+        string frame;
+        encoder.encodeMessage((const unsigned char*)message.data(), message.size(), frame);
+
+        // Each frame decodes on its own, right away
+        string decoded;
+        size_t consumed = 0;
+        ASSERT_TRUE(decoder.decodeMessage((const unsigned char*)frame.data(), frame.size(), decoded, consumed)) << i;
+        EXPECT_EQ(consumed, frame.size());
+        ASSERT_EQ(decoded, message) << i;
+        rawBytes += message.size();
+        frameBytes += frame.size();
+    }
+    EXPECT_GT(encoder.getModel().getRebuildCount(), 5u);
+    EXPECT_LT(frameBytes * 10, rawBytes * 7); // learned the alphabet without a header
+}
+
+TEST(AdaptiveHuffmanTest, ConcatenatedFramesAndEmptyMessagesTest) {
+    AdaptiveOptions options;
+    options.initialInterval = 3;
+    options.maxInterval = 20;
+    options.ageLimit = 500;
+    AdaptiveEncoder encoder(options);
+    AdaptiveDecoder decoder(options);
+
+    string messages[] = {"", "x", "hello adaptive world", "", string(300, 'z'), "tail"};
+    string stream;
+    for (const string& message : messages) {
+        encoder.encodeMessage((const unsigned char*)message.data(), message.size(), stream);
+    }
+
+    size_t position = 0;
+    for (const string& message : messages) {
+        string decoded;
+        size_t consumed = 0;
+        ASSERT_TRUE(decoder.decodeMessage((const unsigned char*)stream.data() + position, stream.size() - position,
+                                          decoded, consumed));
+        EXPECT_EQ(decoded, message);
+        position += consumed;
+    }
+    EXPECT_EQ(position, stream.size());
+}
+
+TEST(AdaptiveHuffmanTest, IncompleteFrameIsRejectedTest) {
+    AdaptiveEncoder encoder;
+    string message = telemetryMessage(42);
+    string frame;
+    encoder.encodeMessage((const unsigned char*)message.data(), message.size(), frame);
+
+    AdaptiveDecoder decoder;
+    string decoded;
+    size_t consumed = 0;
+    EXPECT_FALSE(decoder.decodeMessage((const unsigned char*)frame.data(), frame.size() / 2, decoded, consumed));
+    EXPECT_TRUE(decoded.empty());
+}
+
+TEST(AdaptiveHuffmanTest, PartialFrameCanBeRetriedTest) {
+    AdaptiveOptions options;
+    options.initialInterval = 8;    // several rebuilds inside every frame
+    options.maxInterval = 32;
+    AdaptiveEncoder encoder(options);
+    AdaptiveDecoder decoder(options);
+
+    for (int i = 0; i < 20; i++) {
+        string message = telemetryMessage(i) + telemetryMessage(i + 1);
+        string frame;
+        encoder.encodeMessage((const unsigned char*)message.data(), message.size(), frame);
+
+        // The frame arrives a few bytes at a time; every short attempt fails
+        // without touching the model, the full one decodes
+        string decoded;
+        size_t consumed = 0;
+        for (size_t available = 0; available < frame.size(); available += 3) {
+            ASSERT_FALSE(decoder.decodeMessage((const unsigned char*)frame.data(), available, decoded, consumed))
+                << i << " " << available;
+            ASSERT_TRUE(decoded.empty());
+        }
+        ASSERT_TRUE(decoder.decodeMessage((const unsigned char*)frame.data(), frame.size(), decoded, consumed)) << i;
+        EXPECT_EQ(consumed, frame.size());
+        ASSERT_EQ(decoded, message) << i;
+    }
+}
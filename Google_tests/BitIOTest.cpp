@@ -0,0 +1,242 @@
+#include "BitIO.h"
+#include "BitStream.h"
+#include "DecodeTable.h"
+#include "HuffmanTable.h"
+#include "Checksum.h"
+#include "CpuDispatch.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+static_assert(bitMasks.values[0] == 0 && bitMasks.values[5] == 0x1F && bitMasks.values[64] == ~0ULL,
+              "masks are built at compile time");
+
+// Writes a fixed pattern of varied-width fields
+template <class Sink>
+static void writePattern(BitWriter<Sink>& writer) {
+    for (int i = 0; i < 200; i++) {
+        writer.writeBits((unsigned long long)i * 2654435761ULL, 1 + i % 40);
+    }
+    writer.writeBits(0x0123456789ABCDEFULL, 64);
+    writer.writeBit(true);
+}
+
+template <class Source>
+static bool patternMatches(BitReader<Source>& reader) {
+    for (int i = 0; i < 201; i++) {
+        int count = i < 200 ? 1 + i % 40 : 64;
+        unsigned long long expected = i < 200 ? ((unsigned long long)i * 2654435761ULL) & lowBitMask(count)
+                                              : 0x0123456789ABCDEFULL;
+        unsigned long long value = 0;
+        bool ok = true;
+        for (int b = 0; b < count; b++) {
+            value = (value << 1) | (reader.readBit(ok) ? 1 : 0);
+        }
+        if (!ok || value != expected) return false;
+    }
+    bool ok = true;
+    return reader.readBit(ok) && ok;
+}
+
+TEST(BitIOTest, MemorySinksRoundTripTest) {
+    string grown;
+    GrowingBufferSink growing(grown);
+    BitWriter<GrowingBufferSink> writer(growing);
+    writePattern(writer);
+    ASSERT_TRUE(writer.flush());
+
+    unsigned char span[4096];
+    MemorySpanSink fixed(span, sizeof(span));
+    BitWriter<MemorySpanSink> spanWriter(fixed);
+    writePattern(spanWriter);
+    ASSERT_TRUE(spanWriter.flush());
+    ASSERT_EQ(fixed.size(), grown.size());
+    EXPECT_EQ(string((const char*)span, fixed.size()), grown);
+
+    MemorySpanSource source((const unsigned char*)grown.data(), grown.size());
+    BitReader<MemorySpanSource> reader(source);
+    EXPECT_TRUE(patternMatches(reader));
+
+    // A span that is too small reports the overflow
+    unsigned char tiny[4];
+    MemorySpanSink small(tiny, sizeof(tiny));
+    BitWriter<MemorySpanSink> smallWriter(small);
+    writePattern(smallWriter);
+    EXPECT_FALSE(smallWriter.flush());
+}
+
+TEST(BitIOTest, FileDescriptorRoundTripTest) {
+    const char* path = "bitio_test.bin";
+    int fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    ASSERT_GE(fd, 0);
+    {
+        FdSink sink(fd);
+        BitWriter<FdSink> writer(sink);
+        for (int repeat = 0; repeat < 100; repeat++) {
+            writePattern(writer); // crosses the sink's buffer several times
+        }
+        ASSERT_TRUE(writer.flush());
+    }
+    close(fd);
+
+    fd = open(path, O_RDONLY);
+    ASSERT_GE(fd, 0);
+    FdSource source(fd);
+    BitReader<FdSource> reader(source);
+    for (int repeat = 0; repeat < 100; repeat++) {
+        ASSERT_TRUE(patternMatches(reader)) << repeat;
+    }
+    close(fd);
+    remove(path);
+}
+
+TEST(BitIOTest, MatchesBitStreamBitOrderTest) {
+    stringstream stream(ios::in | ios::out | ios::binary);
+    {
+        BitStream bs(&stream, true);
+        bs.writeBit(true);
+        bs.writeBit(false);
+        bs.writeByte(0xA5);
+        bs.writeBit(true);
+    }
+
+    string written;
+    GrowingBufferSink sink(written);
+    BitWriter<GrowingBufferSink> writer(sink);
+    writer.writeBits(2, 2);
+    writer.writeByte(0xA5);
+    writer.writeBit(true);
+    writer.flush();
+    EXPECT_EQ(written, stream.str());
+}
+
+TEST(BitIOTest, MultiSymbolTableMatchesTreeWalkTest) {
+    // Skewed counts give 1-3 bit codes for the common symbols
+    unsigned long long counts[256] = {0};
+    counts['a'] = 500;
+    counts['b'] = 250;
+    counts['c'] = 120;
+    counts['d'] = 60;
+    for (int i = 0; i < 256; i++) counts[i] += 1; // plus long codes for everything else
+    HuffmanTable huffman;
+    ASSERT_TRUE(huffman.buildFromCounts(counts, false));
+    MultiSymbolTable table(huffman.getRoot());
+
+    // Most windows hold more than one whole code
+    int multi = 0;
+    for (unsigned int w = 0; w < (1u << MultiSymbolTable::windowBits); w++) {
+        if (table.lookup(w).count > 1) multi++;
+    }
+    EXPECT_GT(multi, 2000);
+
+    string data;
+    unsigned int state = 3;
+    for (int i = 0; i < 50000; i++) {
+        state = state * 1103515245u + 12345u;
+        unsigned int r = (state >> 16) % 1000;
+        data.push_back(r < 450 ? 'a' : r < 700 ? 'b' : r < 820 ? 'c' : r < 880 ? 'd' : (char)(r % 256));
+    }
+    string encoded;
+    GrowingBufferSink sink(encoded);
+    BitWriter<GrowingBufferSink> writer(sink);
+    encodeSymbols((const unsigned char*)data.data(), data.size(), huffman.getBits(), huffman.getLengths(), writer);
+    writer.flush();
+
+    string fast(data.size(), '\0');
+    MemorySpanSource source((const unsigned char*)encoded.data(), encoded.size());
+    BitReader<MemorySpanSource> reader(source);
+    MemorySpanSink out((unsigned char*)&fast[0], fast.size());
+    ASSERT_TRUE(decodeSymbolsMulti(table, reader, data.size(), out));
+    EXPECT_EQ(fast, data);
+
+    // Asking for more symbols than the stream holds fails instead of inventing bytes
+    MemorySpanSource shortSource((const unsigned char*)encoded.data(), encoded.size() / 2);
+    BitReader<MemorySpanSource> shortReader(shortSource);
+    string ignored(data.size(), '\0');
+    MemorySpanSink ignoredOut((unsigned char*)&ignored[0], ignored.size());
+    EXPECT_FALSE(decodeSymbolsMulti(table, shortReader, data.size(), ignoredOut));
+}
+
+TEST(BitIOTest, HistogramAndPackerMatchReferenceTest) {
+    // Skewed text, long runs and noise, at lengths around the 8-byte loads and 32-bit stores
+    string data(100003, '\0');
+    unsigned int state = 9;
+    for (size_t i = 0; i < data.size(); i++) {
+        state = state * 1103515245u + 12345u;
+        data[i] = i < 30000 ? "eeeettaoinsrh  "[(state >> 16) % 15] : i < 60000 ? 'z' : (char)(state >> 24);
+    }
+    const unsigned char* bytes = (const unsigned char*)data.data();
+    size_t lengths[] = {0, 1, 7, 8, 31, 32, 33, 63, 64, 1000, data.size()};
+    for (size_t length : lengths) {
+        unsigned long long expected[256];
+        unsigned long long got[256];
+        size_t counted = length - (length > 0 ? 1 : 0);
+        for (int i = 0; i < 256; i++) expected[i] = 0;
+        for (size_t i = 0; i < counted; i++) expected[bytes[1 + i]]++;
+        countBytes(bytes + 1, counted, got);
+        for (int i = 0; i < 256; i++) ASSERT_EQ(got[i], expected[i]) << length;
+    }
+
+    unsigned long long counts[256];
+    countBytes(bytes, data.size(), counts);
+    HuffmanTable table;
+    ASSERT_TRUE(table.buildFromCounts(counts, false));
+
+    // Reference bit stream from the BitWriter, starting 3 bits into a byte
+    string reference;
+    GrowingBufferSink sink(reference);
+    BitWriter<GrowingBufferSink> writer(sink);
+    writer.writeBits(0x5, 3);
+    encodeSymbols(bytes, data.size(), table.getBits(), table.getLengths(), writer);
+    writer.flush();
+
+    // Small output windows make the packer stop and resume mid-stream
+    string packed(reference.size() + 64, '\0');
+    BitPackState packState;
+    packState.accumulator = 0x5;
+    packState.pending = 3;
+    size_t done = 0;
+    size_t used = 0;
+    while (done < data.size()) {
+        size_t written;
+        done += packSymbols(bytes + done, data.size() - done, table.getBits(), table.getLengths(), packState,
+                            (unsigned char*)&packed[used], 40, written);
+        used += written;
+    }
+    used += flushPackedBits(packState, (unsigned char*)&packed[used]);
+    packed.resize(used);
+    EXPECT_EQ(packed, reference);
+}
+
+TEST(BitIOTest, EveryKernelLevelMatchesScalarTest) {
+    string data(100003, '\0');
+    unsigned int state = 9;
+    for (size_t i = 0; i < data.size(); i++) {
+        state = state * 1103515245u + 12345u;
+        data[i] = i < 60000 ? 'z' : (char)(state >> 24);
+    }
+    const unsigned char* bytes = (const unsigned char*)data.data();
+    for (int level = KERNEL_SCALAR; level <= detectedKernelLevel(); level++) {
+        ASSERT_TRUE(forceKernelLevel((KernelLevel)level));
+        EXPECT_EQ(activeKernelLevel(), level);
+        SCOPED_TRACE(kernelLevelName((KernelLevel)level));
+
+        // Lengths around the 32-byte stripes of the checksum
+        size_t lengths[] = {0, 1, 7, 8, 31, 32, 33, 63, 64, 1000, data.size() - 3};
+        for (size_t length : lengths) {
+            EXPECT_EQ(hash64(bytes + 3, length, 77), hash64Scalar(bytes + 3, length, 77)) << length;
+        }
+    }
+    resetKernelLevel();
+
+    EXPECT_EQ(hash64((const unsigned char*)"abc", 3), 0x44BC2CF5AD770999ULL); // XXH64 reference value
+    EXPECT_FALSE(forceKernelLevel((KernelLevel)(KERNEL_AVX512 + 1)));
+    KernelLevel parsed;
+    EXPECT_TRUE(parseKernelLevel("avx512", parsed));
+    EXPECT_EQ(parsed, KERNEL_AVX512);
+    EXPECT_FALSE(parseKernelLevel("avx2", parsed));   // no kernel differs at that level
+    EXPECT_FALSE(parseKernelLevel("neon", parsed));
+}
@@ -0,0 +1,765 @@
+#include "BlockArchive.h"
+#include "BlockCodec.h"
+#include "BurrowsWheeler.h"
+#include "RecordTranspose.h"
+#include "Checksum.h"
+#include "Chunker.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Test fixture for the block archive
+class BlockArchiveTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        remove("archive_input.bin");
+        remove("archive_output.hza");
+        remove("archive_roundtrip.bin");
+        remove("archive_updated.hza");
+    }
+
+    void createTestFile(const string& filename, const string& content) {
+        ofstream file(filename, ios::binary);
+        file << content;
+        file.close();
+    }
+
+    string readFile(const string& filename) {
+        ifstream file(filename, ios::binary);
+        string content((istreambuf_iterator<char>(file)),
+                       istreambuf_iterator<char>());
+        file.close();
+        return content;
+    }
+
+    // Deterministic pseudo-random bytes (not compressible, good for chunking tests)
+    string randomBytes(size_t length, unsigned int seed) {
+        string data(length, '\0');
+        unsigned int state = seed;
+        for (size_t i = 0; i < length; i++) {
+            state = state * 1103515245u + 12345u;
+            data[i] = (char)(state >> 24);
+        }
+        return data;
+    }
+};
+
+TEST_F(BlockArchiveTest, Hash64KnownValueTest) {
+    // XXH64 of the empty input with seed 0
+    EXPECT_EQ(hash64(nullptr, 0), 0xEF46DB3751D8E999ULL);
+    const unsigned char text[] = "abc";
+    EXPECT_NE(hash64(text, 3), hash64(text, 2));
+}
+
+TEST_F(BlockArchiveTest, BlockCodecRoundTripTest) {
+    string inputs[] = {"", "A", string(1000, 'X'), "AAABBC", randomBytes(5000, 7)};
+    for (const string& input : inputs) {
+        string payload;
+        encodeBlock((const unsigned char*)input.data(), input.size(), payload);
+        string decoded;
+        ASSERT_TRUE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded)) << input.size();
+        EXPECT_EQ(decoded, input);
+    }
+}
+
+TEST_F(BlockArchiveTest, BlockCodecRejectsTruncatedPayloadTest) {
+    string input = "the quick brown fox jumps over the lazy dog";
+    string payload;
+    encodeBlock((const unsigned char*)input.data(), input.size(), payload);
+    string decoded;
+    EXPECT_FALSE(decodeBlock((const unsigned char*)payload.data(), payload.size() - 3, decoded));
+
+    // A raw length the code bits cannot hold is rejected before the output is sized
+    string text = "aaaabbbcccdde";
+    while (text.size() < 2000) text += text;
+    payload.clear();
+    encodeBlock((const unsigned char*)text.data(), text.size(), payload);
+    ASSERT_EQ((unsigned char)payload[0], BLOCK_HUFFMAN);
+    for (int i = 1; i <= 4; i++) payload[i] = '\xFF';
+    EXPECT_FALSE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded));
+    EXPECT_TRUE(decoded.empty());
+}
+
+TEST_F(BlockArchiveTest, BlockCodecPicksModeFromHistogramTest) {
+    string text = "mode selection keeps text in Huffman form, runs in RLE and noise raw. ";
+    while (text.size() < 8000) text += text;
+    string inputs[] = {randomBytes(200000, 9), string(1000, 'X'), text, randomBytes(700, 2)};
+    BlockMode expected[] = {BLOCK_RAW, BLOCK_RLE, BLOCK_HUFFMAN, BLOCK_RAW};
+    for (int i = 0; i < 4; i++) {
+        string payload;
+        encodeBlock((const unsigned char*)inputs[i].data(), inputs[i].size(), payload);
+        EXPECT_EQ((unsigned char)payload[0], expected[i]) << i;
+        EXPECT_LE(payload.size(), inputs[i].size() + 5);
+        string decoded;
+        ASSERT_TRUE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded)) << i;
+        EXPECT_EQ(decoded, inputs[i]);
+    }
+
+    // 1000 equal bytes are a single run: mode, length, byte and a two-byte count
+    string payload;
+    encodeBlock((const unsigned char*)inputs[1].data(), inputs[1].size(), payload);
+    EXPECT_EQ(payload.size(), 8u);
+    string decoded;
+    EXPECT_FALSE(decodeBlock((const unsigned char*)payload.data(), payload.size() - 1, decoded));
+}
+
+TEST_F(BlockArchiveTest, FseRoundTripAndBeatsHuffmanOnSkewedDataTest) {
+    // 95% one byte, the rest spread out: Huffman cannot go below 1 bit per byte
+    string skewed(60000, 'a');
+    unsigned int state = 17;
+    for (size_t i = 0; i < skewed.size(); i++) {
+        state = state * 1103515245u + 12345u;
+        if ((state >> 16) % 100 >= 95) skewed[i] = (char)('b' + (state >> 8) % 20);
+    }
+    string inputs[] = {skewed, "ab", randomBytes(3000, 4), string(5000, 'x') + "yz", randomBytes(100000, 8).substr(0, 9)};
+
+    BlockEncodeOptions fse;
+    fse.coder = CODER_FSE;
+    for (const string& input : inputs) {
+        string payload;
+        encodeBlock((const unsigned char*)input.data(), input.size(), payload, fse);
+        string decoded;
+        ASSERT_TRUE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded)) << input.size();
+        EXPECT_EQ(decoded, input);
+    }
+
+    string huffmanPayload;
+    string fsePayload;
+    string autoPayload;
+    BlockEncodeOptions automatic;
+    automatic.coder = CODER_AUTO;
+    encodeBlock((const unsigned char*)skewed.data(), skewed.size(), huffmanPayload);
+    encodeBlock((const unsigned char*)skewed.data(), skewed.size(), fsePayload, fse);
+    encodeBlock((const unsigned char*)skewed.data(), skewed.size(), autoPayload, automatic);
+    EXPECT_EQ((unsigned char)fsePayload[0], BLOCK_FSE);
+    EXPECT_EQ((unsigned char)autoPayload[0], BLOCK_FSE);
+    EXPECT_LT(fsePayload.size() * 10, huffmanPayload.size() * 7);
+
+    // Symbols can cost 0 bits, so only the caller's block size bounds the length
+    string decodedBounded;
+    EXPECT_FALSE(decodeBlock((const unsigned char*)fsePayload.data(), fsePayload.size(), decodedBounded, nullptr,
+                             skewed.size() - 1));
+    ASSERT_TRUE(decodeBlock((const unsigned char*)fsePayload.data(), fsePayload.size(), decodedBounded, nullptr,
+                            skewed.size()));
+    string inflated = fsePayload;
+    for (int i = 1; i <= 4; i++) inflated[i] = '\xFF';
+    decodedBounded.clear();
+    EXPECT_FALSE(decodeBlock((const unsigned char*)inflated.data(), inflated.size(), decodedBounded));
+    EXPECT_TRUE(decodedBounded.empty());
+
+    // Damaged state bits are caught by the final state check
+    fsePayload[fsePayload.size() / 2] ^= 0x10;
+    string decoded;
+    EXPECT_FALSE(decodeBlock((const unsigned char*)fsePayload.data(), fsePayload.size(), decoded));
+}
+
+TEST_F(BlockArchiveTest, Order1ContextsBeatOrder0OnStructuredTextTest) {
+    // Log lines: what follows a byte depends strongly on that byte
+    string logs;
+    const char* levels[] = {"INFO", "WARN", "DEBUG"};
+    for (int i = 0; logs.size() < 120000; i++) {
+        logs += "2024-05-0" + to_string(1 + i % 9) + " " + levels[i % 3] + " [worker-" + to_string(i % 4)
+                + "] request " + to_string(i * 37 % 1000) + " done in " + to_string(i % 50) + "ms\n";
+    }
+
+    BlockEncodeOptions order1;
+    order1.coder = CODER_ORDER1;
+    string contextPayload;
+    string plainPayload;
+    encodeBlock((const unsigned char*)logs.data(), logs.size(), contextPayload, order1);
+    encodeBlock((const unsigned char*)logs.data(), logs.size(), plainPayload);
+    EXPECT_EQ((unsigned char)contextPayload[0], BLOCK_HUFFMAN_ORDER1);
+    EXPECT_LT(contextPayload.size() * 10, plainPayload.size() * 8);
+
+    string decoded;
+    ASSERT_TRUE(decodeBlock((const unsigned char*)contextPayload.data(), contextPayload.size(), decoded));
+    EXPECT_EQ(decoded, logs);
+
+    // A length the code bits cannot hold fails before the output is sized, whatever the caller's bound
+    string inflated = contextPayload;
+    for (int i = 1; i <= 4; i++) inflated[i] = '\xFF';
+    string rejected;
+    EXPECT_FALSE(decodeBlock((const unsigned char*)inflated.data(), inflated.size(), rejected, nullptr, SIZE_MAX));
+    EXPECT_TRUE(rejected.empty());
+
+    // Small and odd inputs still round-trip
+    string inputs[] = {"q", "abababababababab", randomBytes(2000, 6)};
+    for (const string& input : inputs) {
+        string payload;
+        encodeBlock((const unsigned char*)input.data(), input.size(), payload, order1);
+        string back;
+        ASSERT_TRUE(decodeBlock((const unsigned char*)payload.data(), payload.size(), back)) << input.size();
+        EXPECT_EQ(back, input);
+    }
+}
+
+TEST_F(BlockArchiveTest, SuffixArrayMatchesNaiveSortTest) {
+    string inputs[] = {"", "a", "banana", "mississippi", string(300, 'x'), "abababababababab"};
+    vector<string> all(begin(inputs), end(inputs));
+    for (unsigned int seed = 1; seed <= 20; seed++) {
+        string text = randomBytes(500 + seed * 37, seed);
+        for (char& c : text) c = (char)('a' + (unsigned char)c % (seed % 4 + 2)); // small alphabets repeat a lot
+        all.push_back(text);
+    }
+
+    for (size_t t = 0; t < all.size(); t++) {
+        const string& text = all[t];
+        int* suffixes = new int[text.size() + 1];
+        buildSuffixArray((const unsigned char*)text.data(), text.size(), suffixes);
+        EXPECT_EQ(suffixes[0], (int)text.size());
+        // A suffix that is a prefix of another sorts first, as with the end marker
+        for (size_t i = 1; i < text.size(); i++) {
+            EXPECT_LT(text.compare(suffixes[i], string::npos, text, suffixes[i + 1], string::npos), 0) << t;
+        }
+        delete[] suffixes;
+    }
+}
+
+TEST_F(BlockArchiveTest, BwtAndMoveToFrontRoundTripTest) {
+    // Rotations of "banana" + marker sorted: last column "annb$aa", marker in row 4
+    unsigned char transformed[6];
+    EXPECT_EQ(bwtEncode((const unsigned char*)"banana", 6, transformed), 4u);
+    EXPECT_EQ(string((const char*)transformed, 6), "annbaa");
+
+    string inputs[] = {"x", "banana", string(5000, 'z'), "abracadabra abracadabra", randomBytes(20000, 3)};
+    for (const string& input : inputs) {
+        const unsigned char* data = (const unsigned char*)input.data();
+        string bwt(input.size(), '\0');
+        unsigned int primary = bwtEncode(data, input.size(), (unsigned char*)&bwt[0]);
+        string back(input.size(), '\0');
+        ASSERT_TRUE(bwtDecode((const unsigned char*)bwt.data(), bwt.size(), primary, (unsigned char*)&back[0]));
+        EXPECT_EQ(back, input);
+        EXPECT_FALSE(bwtDecode((const unsigned char*)bwt.data(), bwt.size(), 0, (unsigned char*)&back[0]));
+
+        string symbols;
+        mtfZeroRunEncode(data, input.size(), symbols);
+        string restored(input.size(), '\0');
+        ASSERT_TRUE(mtfZeroRunDecode((const unsigned char*)symbols.data(), symbols.size(), input.size(),
+                                     (unsigned char*)&restored[0]));
+        EXPECT_EQ(restored, input);
+        EXPECT_FALSE(mtfZeroRunDecode((const unsigned char*)symbols.data(), symbols.size(), input.size() + 1,
+                                      (unsigned char*)&restored[0]));
+    }
+}
+
+TEST_F(BlockArchiveTest, BwtBlocksShrinkTextAndRoundTripTest) {
+    string text;
+    const char* words[] = {"compression ", "archive ", "block ", "transform ", "the ", "of ", "sorted ", "rotation "};
+    unsigned int state = 3;
+    while (text.size() < 200000) {
+        state = state * 1103515245u + 12345u;
+        text += words[(state >> 16) % 8];
+        if ((state >> 8) % 11 == 0) text += "\n";
+    }
+
+    BlockEncodeOptions bwt;
+    bwt.transform = TRANSFORM_BWT;
+    string transformedPayload;
+    string plainPayload;
+    encodeBlock((const unsigned char*)text.data(), text.size(), transformedPayload, bwt);
+    encodeBlock((const unsigned char*)text.data(), text.size(), plainPayload);
+    EXPECT_EQ((unsigned char)transformedPayload[0], BLOCK_BWT);
+    EXPECT_LT(transformedPayload.size() * 2, plainPayload.size());
+    string decoded;
+    ASSERT_TRUE(decodeBlock((const unsigned char*)transformedPayload.data(), transformedPayload.size(), decoded));
+    EXPECT_EQ(decoded, text);
+
+    // Corrupting the primary index is caught rather than decoded into garbage of the wrong size
+    string broken = transformedPayload;
+    broken[5] = broken[6] = broken[7] = broken[8] = '\xFF';
+    EXPECT_FALSE(decodeBlock((const unsigned char*)broken.data(), broken.size(), decoded));
+
+    // Whole archives with parallel encoders
+    createTestFile("archive_input.bin", text + randomBytes(50000, 2));
+    ArchiveOptions options;
+    options.transform = TRANSFORM_BWT;
+    options.blockSize = 32 * 1024;
+    options.threads = 3;
+    ArchiveStats transformed;
+    ArchiveStats plain;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options, &transformed));
+    ASSERT_TRUE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), readFile("archive_input.bin"));
+    options.transform = TRANSFORM_NONE;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options, &plain));
+    EXPECT_LT(transformed.bytesOut, plain.bytesOut);
+}
+
+TEST_F(BlockArchiveTest, TransposedRecordsBeatPlainCodingTest) {
+    // Telemetry records: 8-byte timestamp, 4-byte counter, 4-byte float reading
+    string records;
+    unsigned long long timestamp = 1700000000000ULL;
+    unsigned int counter = 0;
+    unsigned int state = 17;
+    for (int i = 0; i < 12000; i++) {
+        state = state * 1103515245u + 12345u;
+        timestamp += 1000 + (state >> 28);
+        counter += (state >> 20) % 3;
+        float reading = 20.0f + (float)((state >> 12) % 500) / 100.0f;
+        records.append((const char*)&timestamp, 8);
+        records.append((const char*)&counter, 4);
+        records.append((const char*)&reading, 4);
+    }
+    const unsigned char* data = (const unsigned char*)records.data();
+    EXPECT_EQ(detectRecordStride(data, records.size()), 16u);
+    EXPECT_EQ(detectRecordStride((const unsigned char*)randomBytes(5000, 4).data(), 5000), 1u);
+
+    BlockEncodeOptions transpose;
+    transpose.transform = TRANSFORM_TRANSPOSE;
+    string transposedPayload;
+    string plainPayload;
+    encodeBlock(data, records.size(), transposedPayload, transpose);
+    encodeBlock(data, records.size(), plainPayload);
+    EXPECT_EQ((unsigned char)transposedPayload[0], BLOCK_TRANSPOSED);
+    EXPECT_LT(transposedPayload.size() * 10, plainPayload.size() * 6);
+    string decoded;
+    ASSERT_TRUE(decodeBlock((const unsigned char*)transposedPayload.data(), transposedPayload.size(), decoded));
+    EXPECT_EQ(decoded, records);
+
+    // The lanes' code bits must cover the raw length before anything is allocated
+    string inflated = transposedPayload;
+    for (int i = 1; i <= 4; i++) inflated[i] = '\xFF';
+    string rejected;
+    EXPECT_FALSE(decodeBlock((const unsigned char*)inflated.data(), inflated.size(), rejected, nullptr, SIZE_MAX));
+    EXPECT_TRUE(rejected.empty());
+
+    // A given stride is used as is, also when the block does not end on a record boundary
+    transpose.recordStride = 16;
+    string partial = records.substr(0, 16 * 1000 + 5);
+    string payload;
+    encodeBlock((const unsigned char*)partial.data(), partial.size(), payload, transpose);
+    EXPECT_EQ((unsigned char)payload[0], BLOCK_TRANSPOSED);
+    decoded.clear();
+    ASSERT_TRUE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded));
+    EXPECT_EQ(decoded, partial);
+    payload.pop_back();
+    EXPECT_FALSE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded));
+
+    createTestFile("archive_input.bin", records);
+    ArchiveOptions options;
+    options.transform = TRANSFORM_TRANSPOSE;
+    options.blockSize = 64 * 1024;
+    ArchiveStats stats;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options, &stats));
+    EXPECT_LT(stats.bytesOut * 10, records.size() * 6);
+    ASSERT_TRUE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), records);
+}
+
+TEST_F(BlockArchiveTest, ChunkerBoundariesFollowContentTest) {
+    ContentChunker chunker(4096);
+    string data = randomBytes(200000, 1);
+    string shifted = "inserted prefix" + data;
+
+    // Collect boundaries (as offsets into data) for both versions
+    auto cuts = [&](const string& input, size_t base) {
+        DynamicArray<unsigned long long> result;
+        size_t pos = 0;
+        while (pos < input.size()) {
+            size_t length = chunker.nextChunkLength((const unsigned char*)input.data() + pos, input.size() - pos);
+            EXPECT_LE(length, chunker.getMaxSize());
+            pos += length;
+            if (pos >= base) result.pushBack(pos - base);
+        }
+        return result;
+    };
+    DynamicArray<unsigned long long> original = cuts(data, 0);
+    DynamicArray<unsigned long long> moved = cuts(shifted, 15);
+
+    // After the first couple of chunks the boundaries line up again
+    int shared = 0;
+    for (size_t i = 0; i < original.getSize(); i++) {
+        for (size_t j = 0; j < moved.getSize(); j++) {
+            if (original[i] == moved[j]) shared++;
+        }
+    }
+    EXPECT_GE(shared, (int)original.getSize() - 3);
+}
+
+TEST_F(BlockArchiveTest, FixedBlockRoundTripTest) {
+    string content = string(40000, 'q') + randomBytes(3000, 3) + "tail text";
+    createTestFile("archive_input.bin", content);
+
+    ArchiveOptions options;
+    options.blockSize = 4096;
+    ArchiveStats stats;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options, &stats));
+    EXPECT_EQ(stats.bytesIn, content.size());
+    EXPECT_EQ(stats.blockCount, (content.size() + 4095) / 4096);
+
+    ASSERT_TRUE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), content);
+}
+
+TEST_F(BlockArchiveTest, EmptyFileRoundTripTest) {
+    createTestFile("archive_input.bin", "");
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza"));
+    ASSERT_TRUE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), "");
+}
+
+TEST_F(BlockArchiveTest, DedupStoresRepeatedChunksOnceTest) {
+    // Three "backup versions" of the same data, the last one slightly edited
+    string version = randomBytes(100000, 42);
+    string edited = version;
+    edited.replace(50000, 10, "EDITEDTEXT");
+    string content = version + version + edited;
+    createTestFile("archive_input.bin", content);
+
+    ArchiveOptions options;
+    options.dedup = true;
+    options.blockSize = 4096;
+    ArchiveStats stats;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options, &stats));
+    EXPECT_GT(stats.duplicateBlocks, stats.blockCount / 2);
+    EXPECT_LT(stats.bytesOut, content.size() / 2);
+
+    ArchiveInfo info;
+    ASSERT_TRUE(readArchiveInfo("archive_output.hza", info));
+    EXPECT_EQ(info.flags & ARCHIVE_FLAG_CONTENT_DEFINED, ARCHIVE_FLAG_CONTENT_DEFINED);
+    EXPECT_EQ(info.originalSize, content.size());
+
+    ASSERT_TRUE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), content);
+}
+
+TEST_F(BlockArchiveTest, CorruptPayloadIsDetectedTest) {
+    createTestFile("archive_input.bin", string(5000, 'A') + "BCDEFGH" + string(5000, 'Z'));
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza"));
+
+    // Flip a byte inside the first payload
+    fstream file("archive_output.hza", ios::in | ios::out | ios::binary);
+    file.seekp(30, ios::beg);
+    file.put('\x5A');
+    file.close();
+
+    EXPECT_FALSE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_FALSE(ifstream("archive_roundtrip.bin").good());
+
+    // Damage in the last block, after earlier blocks were written: nothing is left
+    // of the output file, and a memory sink gets back its old contents
+    string content = randomBytes(20000, 4);
+    createTestFile("archive_input.bin", content);
+    ArchiveOptions options;
+    options.blockSize = 4096;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+    ArchiveInfo info;
+    ASSERT_TRUE(readArchiveInfo("archive_output.hza", info));
+    string archive = readFile("archive_output.hza");
+    archive[info.indexOffset - 10] ^= 0x40;
+    createTestFile("archive_output.hza", archive);
+
+    EXPECT_FALSE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_FALSE(ifstream("archive_roundtrip.bin").good());
+    string buffer = "kept";
+    EXPECT_FALSE(decompressArchive(ArchiveEndpoint::file("archive_output.hza"), ArchiveEndpoint::memory(buffer)));
+    EXPECT_EQ(buffer, "kept");
+}
+
+TEST_F(BlockArchiveTest, OversizedIndexEntryIsRejectedTest) {
+    createTestFile("archive_input.bin", string(5000, 'A') + "BCDEFGH");
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza"));
+    ArchiveInfo info;
+    ASSERT_TRUE(readArchiveInfo("archive_output.hza", info));
+    ASSERT_EQ(info.blocks.getSize(), 1u);
+
+    // One block claiming 4 GiB, with the trailer's total to match: the index
+    // must not be believed, since readers size their buffers from it
+    string archive = readFile("archive_output.hza");
+    for (int i = 0; i < 4; i++) archive[info.indexOffset + 12 + i] = '\xFF';
+    size_t originalSize = archive.size() - 28 + 16;
+    for (int i = 0; i < 8; i++) archive[originalSize + i] = i < 4 ? '\0' : '\xFF';
+    createTestFile("archive_output.hza", archive);
+    EXPECT_FALSE(readArchiveInfo("archive_output.hza", info));
+    EXPECT_FALSE(decompressArchive("archive_output.hza", "archive_roundtrip.bin"));
+    EXPECT_FALSE(verifyArchive("archive_output.hza"));
+}
+
+TEST_F(BlockArchiveTest, UpdateReencodesOnlyAppendedBlocksTest) {
+    string content = randomBytes(64 * 1024, 5);
+    createTestFile("archive_input.bin", content);
+    ArchiveOptions options;
+    options.blockSize = 8192;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+
+    // Append-mostly change: 8 full blocks stay identical
+    string grown = content + randomBytes(10000, 6);
+    createTestFile("archive_input.bin", grown);
+    ArchiveStats stats;
+    ASSERT_TRUE(updateArchive("archive_output.hza", "archive_input.bin", "archive_updated.hza", ArchiveOptions(),
+                              &stats));
+    EXPECT_EQ(stats.copiedBlocks, 8u);
+    EXPECT_EQ(stats.blockCount, 10u);
+
+    ASSERT_TRUE(decompressArchive("archive_updated.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), grown);
+}
+
+TEST_F(BlockArchiveTest, UpdateContentDefinedSurvivesInsertionTest) {
+    string content = randomBytes(300000, 8);
+    createTestFile("archive_input.bin", content);
+    ArchiveOptions options;
+    options.dedup = true;
+    options.blockSize = 4096;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+
+    string edited = content;
+    edited.insert(150000, "a few inserted bytes");
+    createTestFile("archive_input.bin", edited);
+    ArchiveStats stats;
+    ASSERT_TRUE(updateArchive("archive_output.hza", "archive_input.bin", "archive_updated.hza", ArchiveOptions(),
+                              &stats));
+    EXPECT_GE(stats.copiedBlocks + 3, stats.blockCount);
+
+    ASSERT_TRUE(decompressArchive("archive_updated.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), edited);
+}
+
+TEST_F(BlockArchiveTest, UpdateCopiesOnlyBlocksThatDecodeToSameBytesTest) {
+    string content = randomBytes(8192, 1);
+    createTestFile("archive_input.bin", content);
+    ArchiveOptions options;
+    options.blockSize = 8192;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+
+    // The old index claims the new block's hash and length for different bytes
+    string changed = randomBytes(8192, 2);
+    ArchiveInfo info;
+    ASSERT_TRUE(readArchiveInfo("archive_output.hza", info));
+    string archive = readFile("archive_output.hza");
+    unsigned long long forged = hash64((const unsigned char*)changed.data(), changed.size());
+    for (int i = 0; i < 8; i++) archive[info.indexOffset + 16 + i] = (char)(forged >> (56 - 8 * i));
+    createTestFile("archive_output.hza", archive);
+
+    createTestFile("archive_input.bin", changed);
+    ArchiveStats stats;
+    ASSERT_TRUE(updateArchive("archive_output.hza", "archive_input.bin", "archive_updated.hza", options, &stats));
+    EXPECT_EQ(stats.copiedBlocks, 0u);
+    ASSERT_TRUE(decompressArchive("archive_updated.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), changed);
+}
+
+TEST_F(BlockArchiveTest, UpdateEncodesChangedBlocksWithGivenOptionsTest) {
+    string content;
+    for (int i = 0; i < 3000; i++) {
+        content += "id=" + to_string(i) + " level=info msg=\"request served\" ms=" + to_string(i % 97) + "\n";
+    }
+    createTestFile("archive_input.bin", content);
+    ArchiveOptions options;
+    options.blockSize = 16 * 1024;
+    options.coder = CODER_ORDER1;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+
+    // Updated with the options the archive was written with, it matches a fresh compression
+    string grown = content + content.substr(0, 20000);
+    createTestFile("archive_input.bin", grown);
+    ArchiveStats stats;
+    ASSERT_TRUE(updateArchive("archive_output.hza", "archive_input.bin", "archive_updated.hza", options, &stats));
+    EXPECT_GT(stats.copiedBlocks, 0u);
+    EXPECT_LT(stats.copiedBlocks, stats.blockCount);
+    string updated = readFile("archive_updated.hza");
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+    EXPECT_EQ(updated, readFile("archive_output.hza"));
+
+    ASSERT_TRUE(decompressArchive("archive_updated.hza", "archive_roundtrip.bin"));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), grown);
+}
+
+TEST_F(BlockArchiveTest, UpdateRefusesToOverwriteSourceTest) {
+    createTestFile("archive_input.bin", "some data");
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza"));
+    EXPECT_FALSE(updateArchive("archive_output.hza", "archive_input.bin", "archive_output.hza"));
+}
+
+TEST_F(BlockArchiveTest, PipelineMatchesSequentialOutputTest) {
+    string content = randomBytes(50000, 9) + string(70000, 'r') + randomBytes(50000, 9);
+    createTestFile("archive_input.bin", content);
+
+    for (int dedup = 0; dedup < 2; dedup++) {
+        ArchiveOptions options;
+        options.blockSize = 4096;
+        options.dedup = dedup == 1;
+        ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+        string sequential = readFile("archive_output.hza");
+
+        options.threads = 3;
+        ArchiveStats stats;
+        ASSERT_TRUE(compressArchive("archive_input.bin", "archive_updated.hza", options, &stats));
+        EXPECT_EQ(readFile("archive_updated.hza"), sequential);
+        if (options.dedup) {
+            EXPECT_GT(stats.duplicateBlocks, 0u);
+        }
+
+        ASSERT_TRUE(decompressArchive("archive_updated.hza", "archive_roundtrip.bin"));
+        EXPECT_EQ(readFile("archive_roundtrip.bin"), content);
+    }
+}
+
+TEST_F(BlockArchiveTest, MemoryLimitShrinksJobAndBoundsPeakTest) {
+    string input;
+    for (int i = 0; i < 400; i++) {
+        input += "record " + to_string(i * 37) + " status=ok bytes=" + to_string(i * i) + "\n";
+    }
+    input += randomBytes(600 * 1024, 11);
+    createTestFile("archive_input.bin", input);
+
+    ArchiveOptions unlimited;
+    unlimited.threads = 4;
+    ArchiveStats freeStats;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", unlimited, &freeStats));
+    EXPECT_GT(freeStats.estimatedPeakMemory, 0u);
+
+    // 4 threads x 256 KiB blocks plus 1 MiB I/O buffers cannot fit in 2 MiB
+    ArchiveOptions limited = unlimited;
+    limited.memoryLimit = 2 * 1024 * 1024;
+    ArchiveStats stats;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", limited, &stats));
+    EXPECT_LE(stats.estimatedPeakMemory, limited.memoryLimit);
+    EXPECT_LT(stats.estimatedPeakMemory, freeStats.estimatedPeakMemory);
+    EXPECT_GE(stats.peakResidentMemory, input.size()); // measured, and the test holds the input itself
+
+    // An update keeps the old block size, so only its I/O buffers shrink
+    ArchiveStats updateStats;
+    ASSERT_TRUE(updateArchive("archive_output.hza", "archive_input.bin", "archive_updated.hza", limited,
+                              &updateStats));
+    EXPECT_EQ(updateStats.copiedBlocks, updateStats.blockCount);
+    EXPECT_LE(updateStats.estimatedPeakMemory, limited.memoryLimit);
+
+    ExtractOptions extract;
+    extract.memoryLimit = limited.memoryLimit;
+    ArchiveStats extractStats;
+    ASSERT_TRUE(decompressArchive("archive_output.hza", "archive_roundtrip.bin", extract, &extractStats));
+    EXPECT_EQ(readFile("archive_roundtrip.bin"), input);
+    EXPECT_LE(extractStats.estimatedPeakMemory, extract.memoryLimit);
+}
+
+TEST_F(BlockArchiveTest, MemoryLimitTooSmallFailsTest) {
+    createTestFile("archive_input.bin", randomBytes(100000, 3));
+
+    ArchiveOptions options;
+    options.memoryLimit = 64 * 1024;
+    EXPECT_FALSE(compressArchive("archive_input.bin", "archive_output.hza", options));
+
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza"));
+    ExtractOptions extract;
+    extract.memoryLimit = 64 * 1024;
+    EXPECT_FALSE(decompressArchive("archive_output.hza", "archive_roundtrip.bin", extract));
+    EXPECT_FALSE(updateArchive("archive_output.hza", "archive_input.bin", "archive_updated.hza", options));
+    EXPECT_FALSE(ifstream("archive_updated.hza").good());
+}
+
+TEST_F(BlockArchiveTest, VerifyChecksBlocksWithoutWritingTest) {
+    string version = randomBytes(60000, 9);
+    string content = version + string(40000, 'q') + version;
+    createTestFile("archive_input.bin", content);
+    ArchiveOptions options;
+    options.dedup = true;
+    options.blockSize = 4096;
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+
+    WorkStealingPool pool(2);
+    VerifyStats stats;
+    ASSERT_TRUE(verifyArchive("archive_output.hza", &pool, &stats));
+    EXPECT_EQ(stats.corruptBlocks, 0u);
+    EXPECT_LT(stats.payloadBytesRead, stats.archiveBytes); // repeated chunks are read and decoded once
+    EXPECT_GE(stats.bytesDecoded, version.size());
+    EXPECT_LT(stats.bytesDecoded, content.size());
+    EXPECT_FALSE(ifstream("archive_roundtrip.bin").good());
+
+    // A reference entry whose hash does not match the block it points at is caught
+    ArchiveInfo info;
+    ASSERT_TRUE(readArchiveInfo("archive_output.hza", info));
+    size_t reference = info.blocks.getSize();
+    for (size_t i = 1; i < info.blocks.getSize() && reference == info.blocks.getSize(); i++) {
+        if (info.blocks[i].payloadOffset < info.blocks[i - 1].payloadOffset) reference = i;
+    }
+    ASSERT_LT(reference, info.blocks.getSize());
+    string archive = readFile("archive_output.hza");
+    archive[info.indexOffset + reference * 24 + 16] ^= 0x01;   // first hash byte of that index entry
+    createTestFile("archive_tampered.hza", archive);
+    EXPECT_FALSE(verifyArchive("archive_tampered.hza", nullptr, &stats));
+    EXPECT_EQ(stats.corruptBlocks, 1u);
+    EXPECT_FALSE(verifyArchive("archive_tampered.hza", &pool));
+    remove("archive_tampered.hza");
+
+    // Flip a byte inside the first payload; sequential and parallel checks agree
+    fstream file("archive_output.hza", ios::in | ios::out | ios::binary);
+    file.seekp(30, ios::beg);
+    file.put('\x5A');
+    file.close();
+    EXPECT_FALSE(verifyArchive("archive_output.hza", nullptr, &stats));
+    EXPECT_GE(stats.corruptBlocks, 1u);
+    EXPECT_FALSE(verifyArchive("archive_output.hza", &pool));
+}
+
+TEST_F(BlockArchiveTest, ProgressCountsEveryBlockTest) {
+    string content = randomBytes(300000, 4) + string(200000, 'z');
+    createTestFile("archive_input.bin", content);
+
+    for (unsigned int threads : {0u, 3u}) {
+        std::mutex lock;
+        DynamicArray<unsigned long long> done;
+        bool finished = false;
+        JobControl control;
+        control.reportInterval = 0;
+        control.onProgress = [&](const JobProgress& progress) {
+            std::lock_guard<std::mutex> guard(lock);
+            done.pushBack(progress.bytesDone);
+            finished = progress.finished;
+        };
+        ArchiveOptions options;
+        options.blockSize = 16 * 1024;
+        options.threads = threads;
+        options.control = &control;
+        ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza", options));
+
+        ASSERT_GE(done.getSize(), content.size() / options.blockSize);
+        for (size_t i = 1; i < done.getSize(); i++) {
+            EXPECT_GE(done[i], done[i - 1]);
+        }
+        EXPECT_EQ(done[done.getSize() - 1], content.size());
+        EXPECT_TRUE(finished);
+    }
+}
+
+TEST_F(BlockArchiveTest, CancelledArchiveJobsLeaveNoOutputTest) {
+    string content = randomBytes(400000, 6);
+    createTestFile("archive_input.bin", content);
+
+    for (unsigned int threads : {0u, 2u}) {
+        CancellationToken token;
+        JobControl control;
+        control.reportInterval = 0;
+        control.cancel = &token;
+        control.onProgress = [&](const JobProgress& progress) {
+            if (progress.bytesDone >= 64 * 1024) token.cancel();
+        };
+        ArchiveOptions options;
+        options.blockSize = 16 * 1024;
+        options.threads = threads;
+        options.control = &control;
+        EXPECT_FALSE(compressArchive("archive_input.bin", "archive_output.hza", options));
+        EXPECT_FALSE(ifstream("archive_output.hza").good());
+
+        // Memory output is cut back to what the caller had in it
+        string buffer = "kept";
+        token.reset();
+        EXPECT_FALSE(compressArchive(ArchiveEndpoint::file("archive_input.bin"), ArchiveEndpoint::memory(buffer),
+                                     options));
+        EXPECT_EQ(buffer, "kept");
+    }
+
+    ASSERT_TRUE(compressArchive("archive_input.bin", "archive_output.hza"));
+    CancellationToken token;
+    token.cancel();
+    ExtractOptions extract;
+    JobControl control;
+    control.cancel = &token;
+    extract.control = &control;
+    EXPECT_FALSE(decompressArchive("archive_output.hza", "archive_roundtrip.bin", extract));
+    EXPECT_FALSE(ifstream("archive_roundtrip.bin").good());
+}
@@ -0,0 +1,151 @@
+#include "CompressionDaemon.h"
+#include <gtest/gtest.h>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+// Test fixture for the compression daemon: one daemon per test on a local socket
+class CompressionDaemonTest : public ::testing::Test {
+protected:
+    const string socketPath = "daemon_test.sock";
+
+    void TearDown() override {
+        remove("daemon_input.bin");
+        remove("daemon_output.hza");
+        remove("daemon_roundtrip.bin");
+    }
+
+    void createTestFile(const string& filename, const string& content) {
+        ofstream file(filename, ios::binary);
+        file << content;
+        file.close();
+    }
+
+    string readFile(const string& filename) {
+        ifstream file(filename, ios::binary);
+        string content((istreambuf_iterator<char>(file)),
+                       istreambuf_iterator<char>());
+        file.close();
+        return content;
+    }
+
+    string sampleLog(size_t lines) {
+        string text;
+        for (size_t i = 0; i < lines; i++) {
+            text += "GET /api/items/" + to_string(i % 97) + " 200 " + to_string(i * 13 % 1000) + "ms\n";
+        }
+        return text;
+    }
+};
+
+TEST_F(CompressionDaemonTest, InlineRoundTripReportsStatsTest) {
+    DaemonOptions options;
+    options.socketPath = socketPath;
+    options.workers = 2;
+    CompressionDaemon daemon(options);
+    ASSERT_TRUE(daemon.start());
+
+    int socket = connectDaemon(socketPath);
+    ASSERT_GE(socket, 0);
+    string content = sampleLog(2000);
+
+    DaemonRequest compress;
+    compress.inputKind = DAEMON_DATA_INLINE;
+    compress.outputKind = DAEMON_DATA_INLINE;
+    compress.input = content;
+    DaemonResponse packed;
+    ASSERT_TRUE(sendDaemonRequest(socket, compress, packed));
+    ASSERT_TRUE(packed.ok) << packed.error;
+    EXPECT_EQ(packed.stats.bytesIn, content.size());
+    EXPECT_EQ(packed.stats.bytesOut, packed.output.size());
+    EXPECT_LT(packed.output.size(), content.size());
+
+    // Same connection, next request
+    DaemonRequest decompress;
+    decompress.op = DAEMON_DECOMPRESS;
+    decompress.inputKind = DAEMON_DATA_INLINE;
+    decompress.outputKind = DAEMON_DATA_INLINE;
+    decompress.input = packed.output;
+    DaemonResponse unpacked;
+    ASSERT_TRUE(sendDaemonRequest(socket, decompress, unpacked));
+    ASSERT_TRUE(unpacked.ok) << unpacked.error;
+    EXPECT_EQ(unpacked.output, content);
+
+    close(socket);
+    daemon.stop();
+    DaemonStats stats = daemon.stats();
+    EXPECT_EQ(stats.requests, 2u);
+    EXPECT_EQ(stats.failures, 0u);
+}
+
+TEST_F(CompressionDaemonTest, PathsAndPassedDescriptorsTest) {
+    DaemonOptions options;
+    options.socketPath = socketPath;
+    options.workers = 1;
+    CompressionDaemon daemon(options);
+    ASSERT_TRUE(daemon.start());
+    string content = sampleLog(5000);
+    createTestFile("daemon_input.bin", content);
+
+    int socket = connectDaemon(socketPath);
+    ASSERT_GE(socket, 0);
+    DaemonRequest compress;
+    compress.input = "daemon_input.bin";
+    compress.outputPath = "daemon_output.hza";
+    DaemonResponse response;
+    ASSERT_TRUE(sendDaemonRequest(socket, compress, response));
+    ASSERT_TRUE(response.ok) << response.error;
+
+    // Decompress through descriptors the client opened
+    int archiveFd = open("daemon_output.hza", O_RDONLY);
+    int outputFd = open("daemon_roundtrip.bin", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(archiveFd, 0);
+    ASSERT_GE(outputFd, 0);
+    DaemonRequest decompress;
+    decompress.op = DAEMON_DECOMPRESS;
+    decompress.inputKind = DAEMON_DATA_FD;
+    decompress.outputKind = DAEMON_DATA_FD;
+    decompress.inputFd = archiveFd;
+    decompress.outputFd = outputFd;
+    ASSERT_TRUE(sendDaemonRequest(socket, decompress, response));
+    ASSERT_TRUE(response.ok) << response.error;
+    close(archiveFd);
+    close(outputFd);
+    EXPECT_EQ(readFile("daemon_roundtrip.bin"), content);
+
+    close(socket);
+}
+
+TEST_F(CompressionDaemonTest, FailedRequestKeepsConnectionTest) {
+    DaemonOptions options;
+    options.socketPath = socketPath;
+    options.workers = 1;
+    CompressionDaemon daemon(options);
+    ASSERT_TRUE(daemon.start());
+
+    int socket = connectDaemon(socketPath);
+    ASSERT_GE(socket, 0);
+    DaemonRequest bad;
+    bad.op = DAEMON_DECOMPRESS;
+    bad.inputKind = DAEMON_DATA_INLINE;
+    bad.outputKind = DAEMON_DATA_INLINE;
+    bad.input = "definitely not an archive, but long enough to have a trailer";
+    DaemonResponse response;
+    ASSERT_TRUE(sendDaemonRequest(socket, bad, response));
+    EXPECT_FALSE(response.ok);
+    EXPECT_FALSE(response.error.empty());
+
+    DaemonRequest good;
+    good.inputKind = DAEMON_DATA_INLINE;
+    good.outputKind = DAEMON_DATA_INLINE;
+    good.input = "hello hello hello";
+    ASSERT_TRUE(sendDaemonRequest(socket, good, response));
+    EXPECT_TRUE(response.ok);
+
+    close(socket);
+    daemon.stop();
+    EXPECT_EQ(daemon.stats().failures, 1u);
+}
@@ -0,0 +1,226 @@
+#include "HuffmanContext.h"
+#include "BlockCodec.h"
+#include "ByteOrder.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Counting global allocator: heap allocations on this thread while
+// countingAllocations is set, so allocation-free code can be checked for real
+static thread_local bool countingAllocations = false;
+static thread_local unsigned long long heapAllocations = 0;
+
+void* operator new(size_t size) {
+    if (countingAllocations) heapAllocations++;
+    void* block = malloc(size == 0 ? 1 : size);
+    if (block == nullptr) throw bad_alloc();
+    return block;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+    free(block);
+}
+
+// Test fixture for reusable coding contexts and segmented payloads
+class HuffmanContextTest : public ::testing::Test {
+protected:
+    // Repetitive English-like text
+    string sampleText(size_t length) {
+        const string words[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog. "};
+        string text;
+        unsigned int state = 11;
+        while (text.size() < length) {
+            state = state * 1103515245u + 12345u;
+            text += words[(state >> 16) % 8];
+        }
+        text.resize(length);
+        return text;
+    }
+
+    string randomBytesLike(size_t length) {
+        string data(length, '\0');
+        unsigned int state = 5;
+        for (size_t i = 0; i < length; i++) {
+            state = state * 1103515245u + 12345u;
+            data[i] = (char)(state >> 24);
+        }
+        return data;
+    }
+};
+
+TEST_F(HuffmanContextTest, ReusedContextStopsAllocatingTest) {
+    // Message sizes and contents vary but stay within the preallocated size
+    vector<string> messages;
+    vector<string> payloads;
+    for (int i = 0; i < 200; i++) {
+        string message = sampleText(100 + (size_t)(i * 37) % 900);
+        if (i % 50 == 7) message = randomBytesLike(700);    // stored raw
+        if (i % 50 == 9) message = string(300, 'x');        // a single symbol
+        if (i % 50 == 11) message.clear();
+        messages.push_back(message);
+        payloads.push_back(string());
+    }
+
+    HuffmanContext context(1024);
+    EXPECT_EQ(context.stats().allocations, 1u);
+    string decoded;
+    for (size_t i = 0; i < messages.size(); i++) {
+        const string& message = messages[i];
+        ASSERT_TRUE(context.compress((const unsigned char*)message.data(), message.size()));
+        payloads[i].assign((const char*)context.output(), context.outputSize());
+        EXPECT_LE(payloads[i].size(), message.size() + 7);
+
+        // Same payload format as the block codec, both ways
+        decoded.clear();
+        ASSERT_TRUE(decodeBlock((const unsigned char*)payloads[i].data(), payloads[i].size(), decoded));
+        EXPECT_EQ(decoded, message);
+        ASSERT_TRUE(context.decompress((const unsigned char*)payloads[i].data(), payloads[i].size()));
+        EXPECT_EQ(string((const char*)context.output(), context.outputSize()), message);
+    }
+
+    // Steady state: the same calls again, counting every heap allocation the
+    // process makes on this thread; results are checked after counting stops
+    size_t failures = 0;
+    heapAllocations = 0;
+    countingAllocations = true;
+    for (size_t i = 0; i < messages.size(); i++) {
+        const string& message = messages[i];
+        const string& payload = payloads[i];
+        if (!context.compress((const unsigned char*)message.data(), message.size()) ||
+            context.outputSize() != payload.size() ||
+            memcmp(context.output(), payload.data(), payload.size()) != 0) failures++;
+        if (!context.decompress((const unsigned char*)payload.data(), payload.size()) ||
+            context.outputSize() != message.size() ||
+            memcmp(context.output(), message.data(), message.size()) != 0) failures++;
+    }
+    countingAllocations = false;
+    EXPECT_EQ(failures, 0u);
+    EXPECT_EQ(heapAllocations, 0u);
+    EXPECT_EQ(context.stats().allocations, 1u);
+    EXPECT_EQ(context.stats().calls, 800u);
+
+    // A larger payload grows the buffer once, then the context is quiet again
+    string large = sampleText(100000);
+    ASSERT_TRUE(context.compress((const unsigned char*)large.data(), large.size()));
+    EXPECT_EQ(context.lastCallAllocations(), 1u);
+    heapAllocations = 0;
+    countingAllocations = true;
+    bool compressed = context.compress((const unsigned char*)large.data(), large.size());
+    countingAllocations = false;
+    EXPECT_TRUE(compressed);
+    EXPECT_EQ(heapAllocations, 0u);
+}
+
+TEST_F(HuffmanContextTest, ContextDecodesCodecPayloadsAndRejectsDamageTest) {
+    HuffmanContext context;
+    string text = sampleText(50000);
+    string payload;
+    encodeBlock((const unsigned char*)text.data(), text.size(), payload);
+    ASSERT_EQ((unsigned char)payload[0], BLOCK_HUFFMAN);
+
+    // The same tree twice: the decode table is built once
+    ASSERT_TRUE(context.decompress((const unsigned char*)payload.data(), payload.size()));
+    ASSERT_TRUE(context.decompress((const unsigned char*)payload.data(), payload.size()));
+    EXPECT_EQ(string((const char*)context.output(), context.outputSize()), text);
+    EXPECT_EQ(context.stats().tableRebuilds, 1u);
+
+    EXPECT_FALSE(context.decompress((const unsigned char*)payload.data(), payload.size() - 10));
+    string badTree = payload;
+    badTree[5] = (char)0xFF; // tree length past the payload
+    EXPECT_FALSE(context.decompress((const unsigned char*)badTree.data(), badTree.size()));
+
+    // A claimed size the bits cannot hold is refused before any allocation
+    string inflated = payload.substr(0, 7 + readU16((const unsigned char*)payload.data() + 5) + 4);
+    inflated[1] = inflated[2] = inflated[3] = inflated[4] = (char)0xFF;
+    size_t bufferBefore = context.stats().bufferBytes;
+    EXPECT_FALSE(context.decompress((const unsigned char*)inflated.data(), inflated.size()));
+    ByteSegment inflatedSegment = {(const unsigned char*)inflated.data(), inflated.size()};
+    unsigned char target[16];
+    MutableSegment targetSegment = {target, sizeof(target)};
+    size_t written;
+    EXPECT_FALSE(context.decompress(&inflatedSegment, 1, &targetSegment, 1, written));
+    EXPECT_EQ(context.stats().bufferBytes, bufferBefore);
+    EXPECT_EQ(context.lastCallAllocations(), 0u);
+
+    string runs(5000, 'a');
+    string rle;
+    encodeBlock((const unsigned char*)runs.data(), runs.size(), rle);
+    ASSERT_EQ((unsigned char)rle[0], BLOCK_RLE);
+    EXPECT_FALSE(context.decompress((const unsigned char*)rle.data(), rle.size())); // not a context mode
+}
+
+TEST_F(HuffmanContextTest, ScatteredSegmentsMatchContiguousPayloadTest) {
+    HuffmanContext context(4096);
+    for (const string& message : {sampleText(3000), randomBytesLike(900), string()}) {
+        ASSERT_TRUE(context.compress((const unsigned char*)message.data(), message.size()));
+        string expected((const char*)context.output(), context.outputSize());
+
+        // Uneven input segments, including empty ones
+        vector<ByteSegment> input;
+        size_t cuts[] = {0, 1, 7, 7, 400, 1333, 3000};
+        for (size_t i = 0; i + 1 < sizeof(cuts) / sizeof(cuts[0]); i++) {
+            size_t from = min(cuts[i], message.size()), to = min(cuts[i + 1], message.size());
+            input.push_back({(const unsigned char*)message.data() + from, to - from});
+        }
+        ASSERT_TRUE(context.compress(input.data(), input.size()));
+        EXPECT_EQ(string((const char*)context.output(), context.outputSize()), expected);
+
+        // Output segments of 1 to 37 bytes, smaller than the packer's working room
+        string storage(expected.size() + 64, '\0');
+        vector<MutableSegment> output;
+        for (size_t at = 0, step = 1; at < storage.size(); at += step, step = step % 37 + 5) {
+            output.push_back({(unsigned char*)&storage[at], min(step, storage.size() - at)});
+        }
+        size_t written = 0;
+        ASSERT_TRUE(context.compress(input.data(), input.size(), output.data(), output.size(), written));
+        EXPECT_EQ(context.lastCallAllocations(), 0u);
+        ASSERT_EQ(written, expected.size());
+        EXPECT_EQ(storage.substr(0, written), expected);
+
+        // Decode the scattered payload into scattered output
+        vector<ByteSegment> payload;
+        for (size_t at = 0; at < written; at += 11) {
+            payload.push_back({(const unsigned char*)storage.data() + at, min((size_t)11, written - at)});
+        }
+        string decoded(message.size(), '\0');
+        vector<MutableSegment> pieces;
+        for (size_t at = 0; at < decoded.size(); at += 250) {
+            pieces.push_back({(unsigned char*)&decoded[at], min((size_t)250, decoded.size() - at)});
+        }
+        ASSERT_TRUE(context.decompress(payload.data(), payload.size(), pieces.data(), pieces.size(), written));
+        EXPECT_EQ(written, message.size());
+        EXPECT_EQ(decoded, message);
+        ASSERT_TRUE(context.decompress(payload.data(), payload.size()));
+        EXPECT_EQ(string((const char*)context.output(), context.outputSize()), message);
+    }
+
+    // Too little room fails instead of writing a partial payload
+    string message = sampleText(2000);
+    ByteSegment input = {(const unsigned char*)message.data(), message.size()};
+    unsigned char small[64];
+    MutableSegment output = {small, sizeof(small)};
+    size_t written = 1;
+    EXPECT_FALSE(context.compress(&input, 1, &output, 1, written));
+    EXPECT_EQ(written, 0u);
+}
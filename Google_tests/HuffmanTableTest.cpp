@@ -0,0 +1,365 @@
+#include "HuffmanTable.h"
+#include "HuffmanZipper.h"
+#include "BlockArchive.h"
+#include "BlockCodec.h"
+#include "TablePreset.h"
+#include "DecodeTableCache.h"
+#include "Checksum.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// Test fixture for shared tables and sampled frequencies
+class HuffmanTableTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        remove("table_input.bin");
+        remove("table_output.huf");
+        remove("table_output.hza");
+        remove("table_roundtrip.bin");
+    }
+
+    void createTestFile(const string& filename, const string& content) {
+        ofstream file(filename, ios::binary);
+        file << content;
+        file.close();
+    }
+
+    string readFile(const string& filename) {
+        ifstream file(filename, ios::binary);
+        string content((istreambuf_iterator<char>(file)),
+                       istreambuf_iterator<char>());
+        file.close();
+        return content;
+    }
+
+    // Repetitive English-like text
+    string sampleText(size_t length) {
+        const string words[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog. "};
+        string text;
+        unsigned int state = 11;
+        while (text.size() < length) {
+            state = state * 1103515245u + 12345u;
+            text += words[(state >> 16) % 8];
+        }
+        text.resize(length);
+        return text;
+    }
+
+    string randomBytesLike(size_t length) {
+        string data(length, '\0');
+        unsigned int state = 5;
+        for (size_t i = 0; i < length; i++) {
+            state = state * 1103515245u + 12345u;
+            data[i] = (char)(state >> 24);
+        }
+        return data;
+    }
+
+    SamplingOptions smallFileSampling() {
+        SamplingOptions options;
+        options.enabled = true;
+        options.fraction = 0.05;
+        options.windowSize = 1024;
+        options.minInputSize = 0;
+        return options;
+    }
+
+    // A fresh tree (for the cache to own) from serialized bits
+    HuffmanNode* treeFrom(const string& serialized) {
+        stringstream stream(serialized + string(1, '\0'), ios::in | ios::binary);
+        BitStream bs(&stream, false);
+        return deserializeTree(bs);
+    }
+
+    // Serialized tree over four symbols with the given counts
+    string fourSymbolTree(unsigned long long a, unsigned long long b, unsigned long long c, unsigned long long d) {
+        unsigned long long counts[256] = {0};
+        counts['a'] = a;
+        counts['b'] = b;
+        counts['c'] = c;
+        counts['d'] = d;
+        HuffmanTable table;
+        table.buildFromCounts(counts, false);
+        return table.getSerialized();
+    }
+};
+
+TEST_F(HuffmanTableTest, TableSerializesAndLoadsTest) {
+    unsigned long long counts[256] = {0};
+    counts['a'] = 50;
+    counts['b'] = 20;
+    counts['c'] = 5;
+    HuffmanTable table;
+    ASSERT_TRUE(table.buildFromCounts(counts, false));
+    EXPECT_TRUE(table.covers(counts));
+    EXPECT_EQ(table.codeLength('z'), 0);
+
+    HuffmanTable loaded;
+    const string& bytes = table.getSerialized();
+    ASSERT_TRUE(loaded.load((const unsigned char*)bytes.data(), bytes.size()));
+    for (int i = 0; i < 256; i++) {
+        EXPECT_EQ(loaded.codeLength((unsigned char)i), table.codeLength((unsigned char)i));
+    }
+
+    HuffmanTable everything;
+    ASSERT_TRUE(everything.buildFromCounts(counts, true));
+    EXPECT_GT(everything.codeLength('z'), 0);
+}
+
+TEST_F(HuffmanTableTest, SharedTableGuardFallsBackTest) {
+    string text = sampleText(20000);
+    unsigned long long counts[256];
+    countBytes((const unsigned char*)text.data(), text.size(), counts);
+    HuffmanTable shared;
+    ASSERT_TRUE(shared.buildFromCounts(counts, true));
+    BlockEncodeOptions options;
+    options.sharedTable = &shared;
+
+    // Similar data uses the shared table, very different data gets its own tree
+    string digits(4000, '0');
+    for (size_t i = 0; i < digits.size(); i++) {
+        digits[i] = (char)('0' + (i * 7919 + i / 3) % 10);
+    }
+    string blocks[] = {sampleText(4000), digits};
+    BlockMode expected[] = {BLOCK_HUFFMAN_SHARED, BLOCK_HUFFMAN};
+    for (int i = 0; i < 2; i++) {
+        string payload;
+        encodeBlock((const unsigned char*)blocks[i].data(), blocks[i].size(), payload, options);
+        EXPECT_EQ((unsigned char)payload[0], expected[i]);
+        string decoded;
+        ASSERT_TRUE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded, &shared));
+        EXPECT_EQ(decoded, blocks[i]);
+    }
+
+    // A shared payload cannot be decoded without its table
+    string payload;
+    encodeBlock((const unsigned char*)blocks[0].data(), blocks[0].size(), payload, options);
+    string decoded;
+    EXPECT_FALSE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded));
+}
+
+TEST_F(HuffmanTableTest, SampledArchiveRoundTripTest) {
+    string content = sampleText(300000);
+    createTestFile("table_input.bin", content);
+
+    ArchiveOptions options;
+    options.blockSize = 16 * 1024;
+    options.sampling = smallFileSampling();
+    ArchiveStats stats;
+    ASSERT_TRUE(compressArchive("table_input.bin", "table_output.hza", options, &stats));
+    EXPECT_GT(stats.sharedTableBlocks, stats.blockCount / 2);
+
+    ArchiveInfo info;
+    ASSERT_TRUE(readArchiveInfo("table_output.hza", info));
+    EXPECT_TRUE(info.flags & ARCHIVE_FLAG_SHARED_TABLE);
+    EXPECT_FALSE(info.sharedTable.empty());
+
+    ASSERT_TRUE(decompressArchive("table_output.hza", "table_roundtrip.bin"));
+    EXPECT_EQ(readFile("table_roundtrip.bin"), content);
+}
+
+TEST_F(HuffmanTableTest, SampledFileMatchesExactFormatTest) {
+    string content = sampleText(200000);
+    createTestFile("table_input.bin", content);
+
+    bool kept = false;
+    ASSERT_TRUE(compressFileSampled("table_input.bin", "table_output.huf", smallFileSampling(), &kept));
+    EXPECT_TRUE(kept);
+    decompressFile("table_output.huf", "table_roundtrip.bin");
+    EXPECT_EQ(readFile("table_roundtrip.bin"), content);
+}
+
+TEST_F(HuffmanTableTest, SampledFileGuardUsesExactCountsTest) {
+    // The sample only sees text, but most of the file is one repeated byte
+    string content = sampleText(20000) + string(400000, 'z');
+    createTestFile("table_input.bin", content);
+
+    SamplingOptions options = smallFileSampling();
+    options.fraction = 0.001; // a single window at the start of the file
+    options.windowSize = 512;
+    bool kept = true;
+    ASSERT_TRUE(compressFileSampled("table_input.bin", "table_output.huf", options, &kept));
+    EXPECT_FALSE(kept);
+    decompressFile("table_output.huf", "table_roundtrip.bin");
+    EXPECT_EQ(readFile("table_roundtrip.bin"), content);
+}
+
+TEST_F(HuffmanTableTest, PresetBeatsOwnTreeForSmallMessagesTest) {
+    string message = "The server accepted the request and returned the cached page to the client.";
+    string own;
+    encodeBlock((const unsigned char*)message.data(), message.size(), own);
+
+    BlockEncodeOptions options;
+    options.presetId = TABLE_ENGLISH_TEXT;
+    string preset;
+    encodeBlock((const unsigned char*)message.data(), message.size(), preset, options);
+    EXPECT_EQ((unsigned char)preset[0], BLOCK_HUFFMAN_PRESET);
+    EXPECT_LT(preset.size(), message.size());
+    EXPECT_LT(preset.size(), own.size());
+
+    string decoded;
+    ASSERT_TRUE(decodeBlock((const unsigned char*)preset.data(), preset.size(), decoded));
+    EXPECT_EQ(decoded, message);
+}
+
+TEST_F(HuffmanTableTest, AutoPresetPicksSmallestTableTest) {
+    string json = "{\"id\": 1042, \"name\": \"sensor\", \"values\": [3, 14, 15], \"ok\": true}";
+    BlockEncodeOptions options;
+    options.presetId = TABLE_AUTO;
+    string payload;
+    encodeBlock((const unsigned char*)json.data(), json.size(), payload, options);
+    ASSERT_EQ((unsigned char)payload[0], BLOCK_HUFFMAN_PRESET);
+
+    // Any byte can be coded by a preset, even ones it does not expect
+    string binary = randomBytesLike(300);
+    options.presetId = TABLE_JSON;
+    string odd;
+    encodeBlock((const unsigned char*)binary.data(), binary.size(), odd, options);
+    string decoded;
+    ASSERT_TRUE(decodeBlock((const unsigned char*)odd.data(), odd.size(), decoded));
+    EXPECT_EQ(decoded, binary);
+}
+
+TEST_F(HuffmanTableTest, BuiltInPresetsNeverChangeTest) {
+    // Payloads written with a preset ID must decode the same way forever
+    struct Golden {
+        unsigned char id;
+        size_t length;
+        unsigned long long hash;
+    };
+    const Golden golden[] = {
+        {TABLE_ENGLISH_TEXT, 320, 0xfcf3d9b81ea01bc6ULL},
+        {TABLE_JSON, 320, 0xa9fca45e56dc02f6ULL},
+        {TABLE_ASCII_LOG, 320, 0xc91f8b162ff7ddc8ULL},
+        {TABLE_BINARY, 320, 0x132c76ee92c535b8ULL},
+    };
+    for (const Golden& preset : golden) {
+        const HuffmanTable* table = findPresetTable(preset.id);
+        ASSERT_NE(table, nullptr) << (int)preset.id;
+        const string& tree = table->getSerialized();
+        EXPECT_EQ(tree.size(), preset.length) << (int)preset.id;
+        EXPECT_EQ(hash64((const unsigned char*)tree.data(), tree.size()), preset.hash) << (int)preset.id;
+        for (int i = 0; i < 256; i++) {
+            ASSERT_GT(table->codeLength((unsigned char)i), 0) << (int)preset.id << " " << i;
+        }
+    }
+    EXPECT_EQ(findPresetTable(TABLE_BINARY + 1), nullptr);
+}
+
+TEST_F(HuffmanTableTest, TrainedTableRegistersUnderCustomIdTest) {
+    TableTrainer trainer;
+    string corpus = "GET /index.html 200\nGET /style.css 200\nPOST /login 302\n";
+    trainer.addSample((const unsigned char*)corpus.data(), corpus.size());
+    HuffmanTable trained;
+    ASSERT_TRUE(trainer.build(trained));
+
+    EXPECT_FALSE(registerPresetTable(TABLE_JSON, trained.getSerialized()));
+    // Registrations last for the process, so a repeated run finds 200 taken
+    if (findPresetTable(200) == nullptr) {
+        ASSERT_TRUE(registerPresetTable(200, trained.getSerialized()));
+    }
+    EXPECT_FALSE(registerPresetTable(200, trained.getSerialized()));
+    ASSERT_NE(findPresetTable(200), nullptr);
+    EXPECT_EQ(findPresetTable(200)->getSerialized(), trained.getSerialized());
+
+    string message = "GET /about.html 200\n";
+    BlockEncodeOptions options;
+    options.presetId = 200;
+    string payload;
+    encodeBlock((const unsigned char*)message.data(), message.size(), payload, options);
+    EXPECT_EQ((unsigned char)payload[1], 200);
+    string decoded;
+    ASSERT_TRUE(decodeBlock((const unsigned char*)payload.data(), payload.size(), decoded));
+    EXPECT_EQ(decoded, message);
+}
+
+TEST_F(HuffmanTableTest, DecodeModesProduceSameFileTest) {
+    string content = sampleText(120000) + string(3000, '\n') + "end";
+    createTestFile("table_input.bin", content);
+    compressFile("table_input.bin", "table_output.huf");
+
+    decompressFile("table_output.huf", "table_roundtrip.bin", DECODE_TREE_WALK);
+    EXPECT_EQ(readFile("table_roundtrip.bin"), content);
+    decompressFile("table_output.huf", "table_roundtrip.bin", DECODE_MULTI_SYMBOL);
+    EXPECT_EQ(readFile("table_roundtrip.bin"), content);
+}
+
+TEST_F(HuffmanTableTest, RepeatedTreeComesFromDecodeCacheTest) {
+    // Same byte counts, different order: both files carry the same tree
+    string content = sampleText(50000);
+    string reversed(content.rbegin(), content.rend());
+    DecodeTableCache& cache = DecodeTableCache::global();
+    cache.clear();
+    unsigned long long hitsBefore = cache.hits();
+
+    createTestFile("table_input.bin", content);
+    compressFile("table_input.bin", "table_output.huf");
+    decompressFile("table_output.huf", "table_roundtrip.bin");
+    EXPECT_EQ(readFile("table_roundtrip.bin"), content);
+    EXPECT_EQ(cache.entryCount(), 1u);
+    EXPECT_EQ(cache.hits(), hitsBefore);
+
+    createTestFile("table_input.bin", reversed);
+    compressFile("table_input.bin", "table_output.huf");
+    decompressFile("table_output.huf", "table_roundtrip.bin", DECODE_TREE_WALK);
+    EXPECT_EQ(readFile("table_roundtrip.bin"), reversed);
+    EXPECT_EQ(cache.entryCount(), 1u);
+    EXPECT_EQ(cache.hits(), hitsBefore + 1);
+}
+
+TEST_F(HuffmanTableTest, DecodeCacheEvictsLeastRecentlyUsedTest) {
+    string treeA = fourSymbolTree(8, 4, 2, 1);
+    string treeB = fourSymbolTree(1, 8, 4, 2);
+    string treeC = fourSymbolTree(2, 1, 8, 4);
+    size_t bits = serializedTreeBits((const unsigned char*)treeA.data(), treeA.size());
+    EXPECT_EQ(bits, 4u * 9 + 3);
+    const unsigned char* a = (const unsigned char*)treeA.data();
+    const unsigned char* b = (const unsigned char*)treeB.data();
+    const unsigned char* c = (const unsigned char*)treeC.data();
+
+    DecodeTableCache cache;
+    cache.insert(a, bits, treeFrom(treeA));
+    size_t entryBytes = cache.bytesUsed();
+    cache.setCapacity(entryBytes * 2 + entryBytes / 2); // room for two tables
+
+    shared_ptr<const DecodeTableEntry> heldB = cache.insert(b, bits, treeFrom(treeB));
+    EXPECT_NE(cache.find(a, bits), nullptr); // A is now newer than B
+    cache.insert(c, bits, treeFrom(treeC));
+
+    EXPECT_EQ(cache.entryCount(), 2u);
+    EXPECT_EQ(cache.find(b, bits), nullptr);
+    EXPECT_NE(cache.find(a, bits), nullptr);
+    EXPECT_NE(cache.find(c, bits), nullptr);
+    // An evicted table stays usable for whoever still holds it
+    EXPECT_FALSE(heldB->getRoot()->isLeaf());
+    EXPECT_TRUE(heldB->matches(treeB, bits));
+}
+
+TEST_F(HuffmanTableTest, DecodeCacheServesConcurrentReadersTest) {
+    string trees[] = {fourSymbolTree(8, 4, 2, 1), fourSymbolTree(1, 8, 4, 2), fourSymbolTree(2, 1, 8, 4)};
+    size_t bits = serializedTreeBits((const unsigned char*)trees[0].data(), trees[0].size());
+    DecodeTableCache cache;
+
+    thread readers[4];
+    for (int t = 0; t < 4; t++) {
+        readers[t] = thread([&, t]() {
+            for (int i = 0; i < 300; i++) {
+                const string& tree = trees[(t + i) % 3];
+                const unsigned char* data = (const unsigned char*)tree.data();
+                shared_ptr<const DecodeTableEntry> entry = cache.find(data, bits);
+                if (!entry) entry = cache.insert(data, bits, treeFrom(tree));
+                ASSERT_TRUE(entry->matches(tree, bits));
+            }
+        });
+    }
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(cache.entryCount(), 3u);
+    EXPECT_GE(cache.hits(), 4u * 300 - 3 * 4);
+}
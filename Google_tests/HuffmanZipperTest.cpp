@@ -3,9 +3,13 @@
 #include "BitStream.h"
 #include "HashMap.h"
 #include "DynamicArray.h"
+#include "HuffmanZipper.h"
+#include "JobControl.h"
 #include <gtest/gtest.h>
 #include <fstream>
+#include <memory_resource>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -43,6 +47,19 @@ protected:
         file.close();
         return content;
     }
+
+    // Repetitive English-like text
+    string sampleText(size_t length) {
+        const string words[] = {"the ", "quick ", "brown ", "fox ", "jumps ", "over ", "lazy ", "dog. "};
+        string text;
+        unsigned int state = 11;
+        while (text.size() < length) {
+            state = state * 1103515245u + 12345u;
+            text += words[(state >> 16) % 8];
+        }
+        text.resize(length);
+        return text;
+    }
 };
 
 // Test HuffmanNode construction and properties
@@ -295,6 +312,115 @@ TEST_F(HuffmanZipperTest, LargeFileTest) {
     EXPECT_EQ(content.length(), 1000);
 }
 
+TEST_F(HuffmanZipperTest, VerifyFileDetectsTruncationTest) {
+    string content = sampleText(80000);
+    createTestFile("test_input.txt", content);
+    compressFile("test_input.txt", "test_compressed.huf");
+
+    unsigned long long decoded = 0;
+    EXPECT_TRUE(verifyFile("test_compressed.huf", &decoded));
+    EXPECT_EQ(decoded, content.size());
+
+    // Cut the last bytes off: the stored size no longer decodes
+    string packed = readFile("test_compressed.huf");
+    createTestFile("test_compressed.huf", packed.substr(0, packed.size() - 20));
+    EXPECT_FALSE(verifyFile("test_compressed.huf", &decoded));
+    EXPECT_LT(decoded, content.size());
+
+    // Trailing garbage after the data is caught too
+    createTestFile("test_compressed.huf", packed + "extra");
+    EXPECT_FALSE(verifyFile("test_compressed.huf"));
+}
+
+TEST_F(HuffmanZipperTest, TruncatedFileFailsDecompressionTest) {
+    string content = sampleText(80000);
+    createTestFile("test_input.txt", content);
+    compressFile("test_input.txt", "test_compressed.huf");
+    string packed = readFile("test_compressed.huf");
+    createTestFile("test_compressed.huf", packed.substr(0, packed.size() - 20));
+
+    // Both decoders fail and leave no short output file
+    for (DecodeMode mode : {DECODE_MULTI_SYMBOL, DECODE_TREE_WALK}) {
+        EXPECT_FALSE(decompressFile("test_compressed.huf", "test_decompressed.txt", JobControl(), mode));
+        EXPECT_FALSE(ifstream("test_decompressed.txt").good());
+    }
+}
+
+TEST_F(HuffmanZipperTest, ProgressReportsGrowToFileSizeTest) {
+    string content = sampleText(3 * 1024 * 1024 + 17);
+    createTestFile("test_input.txt", content);
+
+    vector<JobProgress> reports;
+    JobControl control;
+    control.reportInterval = 0; // every boundary reports
+    control.onProgress = [&](const JobProgress& progress) { reports.push_back(progress); };
+    ASSERT_TRUE(compressFile("test_input.txt", "test_compressed.huf", control));
+
+    ASSERT_GE(reports.size(), 3u);
+    for (size_t i = 1; i < reports.size(); i++) {
+        EXPECT_GE(reports[i].bytesDone, reports[i - 1].bytesDone);
+    }
+    EXPECT_TRUE(reports.back().finished);
+    EXPECT_EQ(reports.back().bytesDone, 2 * content.size()); // counting pass + encoding pass
+    EXPECT_EQ(reports.back().bytesTotal, 2 * content.size());
+    EXPECT_EQ(reports.back().etaSeconds, 0);
+
+    reports.clear();
+    ASSERT_TRUE(decompressFile("test_compressed.huf", "test_decompressed.txt", control));
+    EXPECT_EQ(readFile("test_decompressed.txt"), content);
+    EXPECT_EQ(reports.back().bytesDone, content.size());
+    EXPECT_TRUE(reports.back().finished);
+}
+
+TEST_F(HuffmanZipperTest, CancelledJobRemovesPartialOutputTest) {
+    string content = sampleText(3 * 1024 * 1024);
+    createTestFile("test_input.txt", content);
+
+    // Cancel once the encoding pass is under way
+    CancellationToken token;
+    JobControl control;
+    control.reportInterval = 0;
+    control.cancel = &token;
+    control.onProgress = [&](const JobProgress& progress) {
+        if (progress.bytesDone > content.size()) token.cancel();
+    };
+    EXPECT_FALSE(compressFile("test_input.txt", "test_compressed.huf", control));
+    EXPECT_FALSE(ifstream("test_compressed.huf").good());
+
+    compressFile("test_input.txt", "test_compressed.huf");
+    CancellationToken early;
+    early.cancel();
+    JobControl stop;
+    stop.cancel = &early;
+    EXPECT_FALSE(decompressFile("test_compressed.huf", "test_decompressed.txt", stop));
+    EXPECT_FALSE(ifstream("test_decompressed.txt").good());
+}
+
+TEST_F(HuffmanZipperTest, MemoryLimitBoundsFileJobsTest) {
+    string content = sampleText(200000);
+    createTestFile("test_input.txt", content);
+    std::pmr::memory_resource* heap = std::pmr::get_default_resource();
+
+    // The default I/O buffers alone take 8 MiB; smaller ones fit in 4
+    size_t limit = 4 * 1024 * 1024;
+    ASSERT_TRUE(compressFile("test_input.txt", "test_compressed.huf", JobControl(), heap, limit));
+    ASSERT_TRUE(decompressFile("test_compressed.huf", "test_decompressed.txt", JobControl(), DECODE_MULTI_SYMBOL, limit));
+    EXPECT_EQ(readFile("test_decompressed.txt"), content);
+    remove("test_decompressed.txt");
+
+    // Exactly the smallest planned footprint: the decode table, or the frequency map, goes over
+    size_t smallest = 2 * 64 * 1024 + 1024 * 1024;
+    EXPECT_FALSE(decompressFile("test_compressed.huf", "test_decompressed.txt", JobControl(), DECODE_MULTI_SYMBOL,
+                                smallest));
+    EXPECT_FALSE(ifstream("test_decompressed.txt").good());
+    EXPECT_FALSE(compressFile("test_input.txt", "test_compressed.huf", JobControl(), heap, smallest + 128 * 1024));
+    EXPECT_FALSE(ifstream("test_compressed.huf").good());
+
+    // Below it the job fails before opening anything
+    EXPECT_FALSE(compressFile("test_input.txt", "test_compressed.huf", JobControl(), heap, 512 * 1024));
+    EXPECT_FALSE(ifstream("test_compressed.huf").good());
+}
+
 // Main function to run all tests
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
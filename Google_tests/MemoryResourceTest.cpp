@@ -0,0 +1,153 @@
+#include "MemoryResource.h"
+#include "DynamicArray.h"
+#include "MiniHeap.h"
+#include "HashMap.h"
+#include "HuffmanZipper.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+using namespace std;
+
+// Test ArenaResource allocation and O(1) reset
+TEST(MemoryResourceTest, ArenaAllocatesAlignedAndResets) {
+    ArenaResource arena(256);
+
+    void* a = arena.allocate(3, 1);
+    void* b = arena.allocate(64, 16);
+    EXPECT_NE(a, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 16, 0u);
+    EXPECT_EQ(arena.bytesAllocated(), 67u);
+
+    // Force a second chunk, then reset back to a single chunk
+    void* big = arena.allocate(4096, 8);
+    EXPECT_NE(big, nullptr);
+    size_t reservedBefore = arena.bytesReserved();
+    arena.reset();
+    EXPECT_EQ(arena.bytesAllocated(), 0u);
+    EXPECT_LT(arena.bytesReserved(), reservedBefore);
+}
+
+TEST(MemoryResourceTest, ContainersUseGivenResource) {
+    ArenaResource arena;
+
+    DynamicArray<int> arr(2, &arena);
+    for (int i = 0; i < 100; i++) {
+        arr.pushBack(i);
+    }
+    EXPECT_EQ(arr.getResource(), &arena);
+    EXPECT_EQ(arr[99], 99);
+
+    HashMap map(256, &arena);
+    map.insert('A', 7);
+    int value = 0;
+    EXPECT_TRUE(map.find('A', value));
+    EXPECT_EQ(value, 7);
+
+    MinHeap heap(&arena);
+    HuffmanNode a('A', 3), b('B', 1);
+    heap.insert(&a);
+    heap.insert(&b);
+    EXPECT_EQ(heap.extractMin(), &b);
+
+    // Everything above came out of the arena
+    EXPECT_GE(arena.bytesAllocated(), 100 * sizeof(int) + 256 * sizeof(HashNode));
+}
+
+TEST(MemoryResourceTest, MoveBetweenResourcesCopiesElements) {
+    ArenaResource arena;
+    DynamicArray<int> source(4, &arena);
+    source.pushBack(1);
+    source.pushBack(2);
+
+    DynamicArray<int> target; // default resource
+    target = std::move(source);
+    EXPECT_EQ(target.getResource(), std::pmr::get_default_resource());
+    EXPECT_EQ(target.getSize(), 2u);
+    EXPECT_EQ(target[1], 2);
+
+    // Construction takes the source's resource, copy assignment keeps the target's
+    DynamicArray<int> copied(target);
+    EXPECT_EQ(copied.getResource(), std::pmr::get_default_resource());
+    DynamicArray<int> inArena(4, &arena);
+    inArena = target;
+    EXPECT_EQ(inArena.getResource(), &arena);
+    EXPECT_EQ(inArena[1], 2);
+
+    // Only the move constructor never allocates
+    static_assert(std::is_nothrow_move_constructible<DynamicArray<int>>::value, "move construction steals");
+    static_assert(!std::is_nothrow_move_assignable<DynamicArray<int>>::value, "move assignment may copy");
+}
+
+TEST(MemoryResourceTest, PerThreadPoolServesEachThread) {
+    PerThreadPoolResource* pool = PerThreadPoolResource::instance();
+    std::pmr::memory_resource* mainPool = PerThreadPoolResource::localPool();
+    std::pmr::memory_resource* otherPool = nullptr;
+
+    std::thread worker([&]() {
+        otherPool = PerThreadPoolResource::localPool();
+        DynamicArray<int> arr(8, pool);
+        for (int i = 0; i < 1000; i++) {
+            arr.pushBack(i);
+        }
+        EXPECT_EQ(arr[999], 999);
+    });
+    worker.join();
+
+    EXPECT_NE(mainPool, otherPool);
+}
+
+TEST(MemoryResourceTest, CompressionJobRunsOutOfArena) {
+    {
+        ofstream file("arena_input.txt", ios::binary);
+        file << "ABRACADABRA ABRACADABRA";
+    }
+
+    ArenaResource arena;
+    for (int job = 0; job < 3; job++) {
+        compressFile("arena_input.txt", "arena_output.huf", &arena);
+        EXPECT_GT(arena.bytesAllocated(), 0u);
+        arena.reset(); // the same arena is reused for the next job
+    }
+
+    decompressFile("arena_output.huf", "arena_roundtrip.txt");
+    ifstream in("arena_roundtrip.txt", ios::binary);
+    string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    EXPECT_EQ(content, "ABRACADABRA ABRACADABRA");
+
+    remove("arena_input.txt");
+    remove("arena_output.huf");
+    remove("arena_roundtrip.txt");
+}
+
+TEST(MemoryResourceTest, BudgetTracksCurrentAndPeak) {
+    MemoryBudget budget(1000);
+    EXPECT_TRUE(budget.fits(1000));
+    EXPECT_FALSE(budget.fits(1001));
+
+    EXPECT_TRUE(budget.charge(600));
+    EXPECT_TRUE(budget.charge(300));
+    budget.release(600);
+    EXPECT_TRUE(budget.charge(200));
+    EXPECT_EQ(budget.current(), 500u);
+    EXPECT_EQ(budget.peak(), 900u);
+    EXPECT_FALSE(budget.exceeded());
+
+    // Containers on a BudgetResource charge their storage and give it back
+    BudgetResource resource(budget);
+    {
+        DynamicArray<unsigned long long> arr(100, &resource);
+        EXPECT_EQ(budget.current(), 500u + 100 * sizeof(unsigned long long));
+    }
+    EXPECT_EQ(budget.current(), 500u);
+
+    // Going over the limit still counts and stays marked after the release
+    EXPECT_TRUE(budget.exceeded());
+    EXPECT_EQ(budget.peak(), 500u + 100 * sizeof(unsigned long long));
+    EXPECT_FALSE(budget.charge(501));
+    budget.release(501);
+    EXPECT_TRUE(budget.exceeded());
+    EXPECT_GT(peakResidentBytes(), 0u);
+}
@@ -0,0 +1,71 @@
+#include "RingBuffer.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+
+TEST(RingBufferTest, SpscIsBoundedAndOrdered) {
+    SpscRing<int> ring(4);
+    for (int i = 0; i < 4; i++) {
+        EXPECT_TRUE(ring.tryPush(i));
+    }
+    EXPECT_FALSE(ring.tryPush(99)); // full
+
+    int value = -1;
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(ring.tryPop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.tryPop(value)); // empty
+}
+
+TEST(RingBufferTest, SpscAcrossThreads) {
+    SpscRing<int> ring(8);
+    const int count = 100000;
+    long long sum = 0;
+    thread consumer([&]() {
+        int value;
+        for (int i = 0; i < count; i++) {
+            ring.pop(value);
+            EXPECT_EQ(value, i);
+            sum += value;
+        }
+    });
+    for (int i = 0; i < count; i++) {
+        ring.push(i);
+    }
+    consumer.join();
+    EXPECT_EQ(sum, (long long)count * (count - 1) / 2);
+}
+
+TEST(RingBufferTest, MpmcDeliversEveryItemOnce) {
+    MpmcRing<int> ring(16);
+    const int producers = 3, perProducer = 20000;
+    atomic<long long> sum(0);
+
+    // Each consumer takes a fixed share with the blocking pop, which backs off
+    // instead of spinning, so the test stays quick on a single CPU
+    const int consumerCount = 2;
+    thread consumers[consumerCount];
+    for (thread& consumer : consumers) {
+        consumer = thread([&]() {
+            int value;
+            for (int i = 0; i < producers * perProducer / consumerCount; i++) {
+                ring.pop(value);
+                sum.fetch_add(value);
+            }
+        });
+    }
+    thread workers[producers];
+    for (int p = 0; p < producers; p++) {
+        workers[p] = thread([&, p]() {
+            for (int i = 0; i < perProducer; i++) ring.push(p * perProducer + i);
+        });
+    }
+    for (thread& worker : workers) worker.join();
+    for (thread& consumer : consumers) consumer.join();
+
+    long long n = (long long)producers * perProducer;
+    EXPECT_EQ(sum.load(), n * (n - 1) / 2);
+}
@@ -0,0 +1,158 @@
+#include "WorkStealingPool.h"
+#include "BlockArchive.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+TEST(WorkStealingPoolTest, DequeOwnerIsLifoThiefIsFifo) {
+    WorkStealingDeque deque(2); // small so push has to grow the ring
+    TaskGroup* noGroup = nullptr;
+    PoolTask tasks[5];
+    for (int i = 0; i < 5; i++) {
+        tasks[i].group = noGroup;
+        deque.push(&tasks[i]);
+    }
+
+    EXPECT_EQ(deque.steal(), &tasks[0]);
+    EXPECT_EQ(deque.pop(), &tasks[4]);
+    EXPECT_EQ(deque.pop(), &tasks[3]);
+    EXPECT_EQ(deque.steal(), &tasks[1]);
+    EXPECT_EQ(deque.pop(), &tasks[2]);
+    EXPECT_EQ(deque.pop(), nullptr);
+    EXPECT_TRUE(deque.empty());
+}
+
+TEST(WorkStealingPoolTest, DequeConcurrentStealsTakeEachTaskOnce) {
+    const int count = 20000;
+    WorkStealingDeque deque;
+    PoolTask* tasks = new PoolTask[count];
+    atomic<int> taken(0);
+    atomic<bool> done(false);
+
+    auto thief = [&]() {
+        while (!done.load() || !deque.empty()) {
+            if (deque.steal()) taken.fetch_add(1);
+        }
+    };
+    thread a(thief), b(thief);
+
+    for (int i = 0; i < count; i++) {
+        deque.push(&tasks[i]);
+        if (i % 3 == 0 && deque.pop()) taken.fetch_add(1);
+    }
+    while (deque.pop()) taken.fetch_add(1);
+    done.store(true);
+    a.join();
+    b.join();
+
+    EXPECT_EQ(taken.load(), count);
+    delete[] tasks;
+}
+
+TEST(WorkStealingPoolTest, TaskGroupRunsAllTasks) {
+    WorkStealingPool pool(4);
+    atomic<int> sum(0);
+    TaskGroup group(pool);
+    for (int i = 1; i <= 1000; i++) {
+        group.run([&sum, i]() { sum.fetch_add(i); });
+    }
+    group.wait();
+    EXPECT_EQ(sum.load(), 500500);
+}
+
+TEST(WorkStealingPoolTest, NestedTasksAndParallelFor) {
+    WorkStealingPool pool(3);
+    const size_t n = 100000;
+    atomic<long long> total(0);
+
+    parallelFor(pool, 0, n, 256, [&](size_t from, size_t to) {
+        long long local = 0;
+        for (size_t i = from; i < to; i++) local += (long long)i;
+        total.fetch_add(local);
+    });
+    EXPECT_EQ(total.load(), (long long)n * (n - 1) / 2);
+
+    // Tasks that spawn and wait on their own subgroups must not deadlock
+    atomic<int> leaves(0);
+    TaskGroup outer(pool);
+    for (int i = 0; i < 8; i++) {
+        outer.run([&]() {
+            TaskGroup inner(pool);
+            for (int j = 0; j < 8; j++) inner.run([&]() { leaves.fetch_add(1); });
+            inner.wait();
+        });
+    }
+    outer.wait();
+    EXPECT_EQ(leaves.load(), 64);
+}
+
+TEST(WorkStealingPoolTest, WaitRethrowsTaskException) {
+    WorkStealingPool pool(2);
+    TaskGroup group(pool);
+    group.run([]() { throw runtime_error("task failed"); });
+    group.run([]() {});
+    EXPECT_THROW(group.wait(), runtime_error);
+}
+
+TEST(WorkStealingPoolTest, ParallelForThrowingBodyWaitsForQueuedRanges) {
+    WorkStealingPool pool(2);
+    const size_t n = 4096;
+    atomic<size_t> done(0);
+    // The calling thread keeps the lowest range, so the throw happens there
+    // while the upper halves are still queued or running
+    EXPECT_THROW(parallelFor(pool, 0, n, 64, [&](size_t from, size_t to) {
+        if (from == 0) throw runtime_error("body failed");
+        done.fetch_add(to - from);
+    }), runtime_error);
+    EXPECT_EQ(done.load(), n - 64);
+}
+
+TEST(WorkStealingPoolTest, CompressDirectoryTree) {
+    namespace fs = std::filesystem;
+    fs::remove_all("pool_tree");
+    fs::remove_all("pool_tree_out");
+    fs::create_directories("pool_tree/sub/deeper");
+    string contents[3] = {string(100000, 'a') + "end", "tiny", "medium sized file contents"};
+    string names[3] = {"pool_tree/big.bin", "pool_tree/sub/small.txt", "pool_tree/sub/deeper/mid.txt"};
+    for (int i = 0; i < 3; i++) {
+        ofstream(names[i], ios::binary) << contents[i];
+    }
+
+    WorkStealingPool pool(2);
+    ArchiveStats stats;
+    ASSERT_TRUE(compressDirectory("pool_tree", "pool_tree_out", pool, ArchiveOptions(), &stats));
+    EXPECT_EQ(stats.bytesIn, contents[0].size() + contents[1].size() + contents[2].size());
+
+    ASSERT_TRUE(decompressArchive("pool_tree_out/sub/deeper/mid.txt.hza", "pool_tree_check.txt"));
+    ifstream check("pool_tree_check.txt", ios::binary);
+    string roundTrip((istreambuf_iterator<char>(check)), istreambuf_iterator<char>());
+    EXPECT_EQ(roundTrip, contents[2]);
+
+    check.close();
+    remove("pool_tree_check.txt");
+
+    // The limit covers the whole run: 1 MiB fits one file job, but not half of it per worker
+    ArchiveOptions limited;
+    limited.memoryLimit = 1024 * 1024;
+    ASSERT_TRUE(compressArchive("pool_tree/big.bin", "pool_tree_check.hza", limited));
+    remove("pool_tree_check.hza");
+    EXPECT_FALSE(compressDirectory("pool_tree", "pool_tree_out", pool, limited, &stats));
+    limited.memoryLimit *= 2;
+    EXPECT_TRUE(compressDirectory("pool_tree", "pool_tree_out", pool, limited, &stats));
+
+    // An output folder that cannot be created fails the run; the other files are still written
+    fs::remove_all("pool_tree_out");
+    fs::create_directories("pool_tree_out");
+    ofstream("pool_tree_out/sub", ios::binary) << "in the way";
+    EXPECT_FALSE(compressDirectory("pool_tree", "pool_tree_out", pool, ArchiveOptions(), &stats));
+    EXPECT_EQ(stats.bytesIn, contents[0].size());
+    EXPECT_TRUE(fs::exists("pool_tree_out/big.bin.hza"));
+
+    fs::remove_all("pool_tree");
+    fs::remove_all("pool_tree_out");
+}
@@ -1,18 +1,69 @@
 #include "HuffmanZipper.h"
+#include "BlockArchive.h"
 #include "HuffmanNode.h"
 #include "MiniHeap.h"
 #include "BitStream.h"
 #include "HashMap.h"
 #include "DynamicArray.h"
+#include "CompressionDaemon.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <cstring>
+#include <thread>
+#include <csignal>
 
 
 using namespace std;
 
-int main() {
+/**
+ * Serve compression requests on a Unix socket until SIGINT or SIGTERM
+ */
+static int runDaemon(const string& socketPath) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr); // every thread started below inherits the mask
+
+    DaemonOptions options;
+    options.socketPath = socketPath;
+    CompressionDaemon daemon(options);
+    if (!daemon.start()) {
+        return 1;
+    }
+    cout << "Listening on " << socketPath << endl;
+
+    int received;
+    sigwait(&signals, &received);
+    daemon.stop();
+    DaemonStats stats = daemon.stats();
+    cout << "Served " << stats.requests << " requests (" << stats.failures << " failed), "
+         << stats.bytesIn << " bytes in, " << stats.bytesOut << " bytes out" << endl;
+    return 0;
+}
+
+/**
+ * Progress line for long jobs, redrawn in place on stderr
+ */
+static JobControl consoleProgress() {
+    JobControl control;
+    control.onProgress = [](const JobProgress& progress) {
+        cerr << "\r  " << progress.bytesDone / (1024 * 1024) << " MiB";
+        if (progress.bytesTotal > 0) cerr << " (" << progress.bytesDone * 100 / progress.bytesTotal << "%)";
+        cerr << ", " << (int)progress.megabytesPerSecond << " MB/s";
+        if (progress.etaSeconds >= 0) cerr << ", " << (int)progress.etaSeconds << " s left";
+        cerr << "    ";
+        if (progress.finished) cerr << endl;
+    };
+    return control;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && strcmp(argv[1], "--daemon") == 0) {
+        return runDaemon(argv[2]);
+    }
+
     int choice;
     string inputFile, outputFile;
 
@@ -27,7 +78,7 @@ int main() {
             getline(cin, inputFile);
             cout << "Enter output file name: ";
             getline(cin, outputFile);
-            compressFile(inputFile, outputFile);
+            compressFile(inputFile, outputFile, consoleProgress());
             break;
 
         case 2:
@@ -38,7 +89,88 @@ int main() {
             decompressFile(inputFile, outputFile);
             break;
 
-        case 3:
+        case 3: {
+            cout << "Enter input file name: ";
+            getline(cin, inputFile);
+            cout << "Enter output file name: ";
+            getline(cin, outputFile);
+            ArchiveOptions options;
+            options.dedup = true;
+            options.threads = thread::hardware_concurrency(); // pipelined read/encode/write
+            JobControl progress = consoleProgress();
+            options.control = &progress;
+            ArchiveStats stats;
+            if (compressArchive(inputFile, outputFile, options, &stats)) {
+                cout << "Compression complete! " << stats.blockCount << " chunks, "
+                     << stats.duplicateBlocks << " duplicates, " << stats.bytesOut << " bytes written" << endl;
+            }
+            break;
+        }
+
+        case 4:
+            cout << "Enter archive file name: ";
+            getline(cin, inputFile);
+            cout << "Enter output file name: ";
+            getline(cin, outputFile);
+            if (decompressArchive(inputFile, outputFile)) {
+                cout << "Decompression complete! Output: " << outputFile << endl;
+            }
+            break;
+
+        case 5: {
+            string oldArchive;
+            cout << "Enter existing archive file name: ";
+            getline(cin, oldArchive);
+            cout << "Enter new input file name: ";
+            getline(cin, inputFile);
+            cout << "Enter output file name: ";
+            getline(cin, outputFile);
+            ArchiveStats stats;
+            if (updateArchive(oldArchive, inputFile, outputFile, ArchiveOptions(), &stats)) {
+                cout << "Update complete! " << stats.copiedBlocks << " of " << stats.blockCount
+                     << " blocks reused" << endl;
+            }
+            break;
+        }
+
+        case 6: {
+            cout << "Enter input directory: ";
+            getline(cin, inputFile);
+            cout << "Enter output directory: ";
+            getline(cin, outputFile);
+            WorkStealingPool pool;
+            ArchiveStats stats;
+            if (compressDirectory(inputFile, outputFile, pool, ArchiveOptions(), &stats)) {
+                cout << "Compression complete! " << stats.bytesIn << " bytes in, "
+                     << stats.bytesOut << " bytes out on " << pool.threadCount() << " threads" << endl;
+            }
+            break;
+        }
+
+        case 7: {
+            cout << "Enter compressed file name: ";
+            getline(cin, inputFile);
+            char magic[4] = {0};
+            ifstream probe(inputFile, ios::binary);
+            probe.read(magic, 4);
+            probe.close();
+            if (memcmp(magic, "HZA1", 4) == 0) {
+                WorkStealingPool pool; // independent blocks: check them on every core
+                VerifyStats stats;
+                if (verifyArchive(inputFile, &pool, &stats)) {
+                    cout << "Archive OK: " << stats.blockCount << " blocks, " << stats.bytesDecoded
+                         << " bytes checked at " << stats.megabytesPerSecond() << " MB/s" << endl;
+                }
+            } else {
+                unsigned long long decoded = 0;
+                if (verifyFile(inputFile, &decoded)) {
+                    cout << "File OK: " << decoded << " bytes decoded" << endl;
+                }
+            }
+            break;
+        }
+
+        case 8:
             cout << "Exiting program. Goodbye!" << endl;
             return 0;
 